@@ -0,0 +1,53 @@
+#!/bin/sh
+# Time two loops over the same array, one whose accesses are bounds-checked
+# on every iteration and one whose bounds are checked once:
+#
+#   checked  the index is a second variable counting alongside i, so each
+#            a[j] compares j with the array's length
+#   proven   'pakati (i = 0, urefu(a))' indexes with i itself; the check is
+#            hoisted out of the loop and the loop can be vectorized
+#
+#   benchmarks/arrays.sh path/to/tino [length] [passes]
+
+TINO=${1:?usage: $0 path/to/tino [length] [passes]}
+LENGTH=${2:-10000000}
+PASSES=${3:-20}
+DIR=$(mktemp -d /tmp/arrays.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/checked.tn" <<TN
+zita n = $LENGTH
+
+basa scale(a: [double], passes) {
+    pakati (p = 0, passes) {
+        zita j = 0
+        pakati (i = 0, urefu(a)) {
+            a[j] = a[j] * 0.5 + 1
+            j = j + 1
+        }
+    }
+    dzosa a[0]
+}
+
+nyora(scale(new [double](n), $PASSES))
+TN
+
+cat > "$DIR/proven.tn" <<TN
+zita n = $LENGTH
+
+basa scale(a: [double], passes) {
+    pakati (p = 0, passes) {
+        pakati (i = 0, urefu(a)) {
+            a[i] = a[i] * 0.5 + 1
+        }
+    }
+    dzosa a[0]
+}
+
+nyora(scale(new [double](n), $PASSES))
+TN
+
+for CASE in checked proven; do
+  echo "== $CASE"
+  /usr/bin/time -f "%e s" "$TINO" -O3 "$DIR/$CASE.tn"
+done
@@ -0,0 +1,208 @@
+#!/bin/sh
+# Channel throughput, in messages (numbers) per second as nguva() measures
+# them:
+#
+#   channelSpsc   one producer task and one consumer task
+#   channel       1, 2 and 4 producers and as many consumers
+#
+# each sending a number at a time and in batches of 256 with
+# channelSendBatch / channelReceiveBatch; then a reader -> N workers ->
+# in-order writer pipeline over a file of numbers, like
+# src/Release/examples/pipeline.tn, for N = 1, 2, 4, ... up to the
+# machine's cores.
+#
+#   benchmarks/channels.sh path/to/tino [messages] [pipeline-numbers]
+
+TINO=${1:?usage: $0 path/to/tino [messages] [pipeline-numbers]}
+MESSAGES=${2:-20000000}
+NUMBERS=${3:-2000000}
+DIR=$(mktemp -d /tmp/channels.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+# $1 is the name, $2 the builtin making the channel, $3 the producers (and
+# consumers), $4 the batch size. Each producer sends a whole number of
+# batches.
+channel_script() {
+  cat > "$DIR/$1.tn" <<TN
+basa send(c: Channel, n, batch) {
+    kana (batch < 2) {
+        pakati (i = 0, n) {
+            channelSend(c, i)
+        }
+        dzosa 0
+    }
+    zita buf = new [double](batch)
+    zita i = 0
+    kusvika (i < n) {
+        pakati (k = 0, batch) {
+            buf[k] = i + k
+        }
+        channelSendBatch(c, buf, 0, batch)
+        i = i + batch
+    }
+    dzosa 0
+}
+
+basa receive(c: Channel, batch) {
+    zita total = 0
+    kana (batch < 2) {
+        zita x = channelReceive(c, 0 - 1)
+        kusvika (x > 0 - 1) {
+            total = total + x
+            x = channelReceive(c, 0 - 1)
+        }
+        dzosa total
+    }
+    zita buf = new [double](batch)
+    zita got = channelReceiveBatch(c, buf, 0, batch)
+    kusvika (got > 0) {
+        pakati (k = 0, got) {
+            total = total + buf[k]
+        }
+        got = channelReceiveBatch(c, buf, 0, batch)
+    }
+    dzosa total
+}
+
+basa producers(p, c: Channel, n, batch) {
+    kana (p > 1) {
+        zita rest = tanga producers(p - 1, c, n, batch)
+        send(c, n, batch)
+        dzosa mirira(rest)
+    }
+    dzosa send(c, n, batch)
+}
+
+basa consumers(p, c: Channel, batch) {
+    kana (p > 1) {
+        zita rest = tanga consumers(p - 1, c, batch)
+        zita mine = receive(c, batch)
+        dzosa mine + mirira(rest)
+    }
+    dzosa receive(c, batch)
+}
+
+basa run(p, n, batch) {
+    zita c = $2(1024)
+    zita start = nguva()
+    zita received = tanga consumers(p, c, batch)
+    producers(p, c, n, batch)
+    channelClose(c)
+    zita total = mirira(received)
+    zita seconds = nguva() - start
+    zita expected = p * n * (n - 1) * 0.5
+    kana (total < expected) {
+        nyora("ZVAKARASIKA")
+    }
+    dzosa p * n * govana(1, seconds)
+}
+
+nyora(run($3, $((MESSAGES / $3 / 256 * 256)), $4))
+TN
+}
+
+# $1 is the number of workers.
+pipeline_script() {
+  cat > "$DIR/pipeline_$1.tn" <<TN
+basa reader(source: Faera, input: [double], work: Channel) {
+    zita i = 0
+    zita x = verengaNamba(source, 0 - 1)
+    kusvika (x > 0 - 1) {
+        input[i] = x
+        channelSend(work, i)
+        i = i + 1
+        x = verengaNamba(source, 0 - 1)
+    }
+    channelClose(work)
+    dzosa i
+}
+
+basa transform(input: [double], output: [double], work: Channel, done: Channel) {
+    zita i = channelReceive(work, 0 - 1)
+    kusvika (i > 0 - 1) {
+        output[i] = tsvagaMudzi(input[i]) + logarithm(input[i] + 1)
+        channelSend(done, i)
+        i = channelReceive(work, 0 - 1)
+    }
+    dzosa 0
+}
+
+basa transformOn(workers, input: [double], output: [double], work: Channel, done: Channel) {
+    kana (workers > 1) {
+        zita rest = tanga transformOn(workers - 1, input, output, work, done)
+        transform(input, output, work, done)
+        dzosa mirira(rest)
+    }
+    dzosa transform(input, output, work, done)
+}
+
+basa transformers(workers, input: [double], output: [double], work: Channel, done: Channel) {
+    transformOn(workers, input, output, work, done)
+    dzosa channelClose(done)
+}
+
+basa writer(sink: Faera, output: [double], arrived: [double], done: Channel) {
+    zita next = 0
+    zita i = channelReceive(done, 0 - 1)
+    kusvika (i > 0 - 1) {
+        arrived[i] = 1
+        kusvika (arrived[next] > 0) {
+            nyoraNamba(sink, output[next])
+            next = next + 1
+        }
+        i = channelReceive(done, 0 - 1)
+    }
+    dzosa next
+}
+
+basa pipeline(n, workers) {
+    zita input = new [double](n)
+    zita output = new [double](n)
+    zita arrived = new [double](n + 1)
+    zita work = channel(1024)
+    zita done = channel(1024)
+    zita source = vhuraFaeraKuverenga("$DIR/in.txt")
+    zita sink = vhuraFaeraKunyora("$DIR/out.txt")
+    zita start = nguva()
+    zita r = tanga reader(source, input, work)
+    zita t = tanga transformers(workers, input, output, work, done)
+    zita written = writer(sink, output, arrived, done)
+    mirira(r)
+    mirira(t)
+    vharaFaera(sink)
+    zita seconds = nguva() - start
+    kana (written < n) {
+        nyora("ZVAKARASIKA")
+    }
+    dzosa n * govana(1, seconds)
+}
+
+nyora(pipeline($NUMBERS, $1))
+TN
+}
+
+# $1 is the label, $2 the script; prints the script's messages per second.
+run() {
+  RATE=$("$TINO" -O3 "$DIR/$2.tn" | head -1)
+  echo "$1: $(awk "BEGIN { printf \"%.1f\", $RATE / 1000000 }") M messages/s"
+}
+
+echo "== channels"
+for BATCH in 1 256; do
+  channel_script spsc channelSpsc 1 $BATCH
+  run "channelSpsc 1x1, batch $BATCH" spsc
+  for P in 1 2 4; do
+    channel_script mpmc channel $P $BATCH
+    run "channel ${P}x$P, batch $BATCH" mpmc
+  done
+done
+
+echo "== pipeline, $NUMBERS numbers"
+awk "BEGIN { for (i = 0; i < $NUMBERS; i++) print (i * 7919) % 1000003 }" > "$DIR/in.txt"
+CORES=$(nproc)
+WORKERS=1
+while [ "$WORKERS" -le "$CORES" ]; do
+  pipeline_script $WORKERS
+  run "reader -> $WORKERS workers -> writer" pipeline_$WORKERS
+  WORKERS=$((WORKERS * 2))
+done
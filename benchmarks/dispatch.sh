@@ -0,0 +1,109 @@
+#!/bin/sh
+# Time the same loop of method calls dispatched three ways:
+#
+#   direct        a plain basa, no objects involved
+#   devirtualized a method no subclass overrides; with --whole-program class
+#                 hierarchy analysis turns the call into a direct one
+#   virtual       two subclasses overriding the method, alternating at the
+#                 same call site; its inline cache checks for both methods
+#                 and calls whichever matches directly
+#
+# and the virtual case once more with --profile-use, after a
+# --profile-generate run has counted which method each check hit.
+#
+#   benchmarks/dispatch.sh path/to/tino [iterations]
+
+TINO=${1:?usage: $0 path/to/tino [iterations]}
+ITERATIONS=${2:-100000000}
+DIR=$(mktemp -d /tmp/dispatch.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+# The count comes from a global so the loops aren't evaluated at compile time.
+cat > "$DIR/direct.tn" <<TN
+zita n = $ITERATIONS
+
+basa area(r) {
+    dzosa r * r * 3.14159
+}
+
+basa run(count) {
+    zita total = 0
+    pakati (i = 0, count) {
+        total = total + area(i)
+    }
+    dzosa total
+}
+
+nyora(run(n))
+TN
+
+cat > "$DIR/devirtualized.tn" <<TN
+zita n = $ITERATIONS
+
+kirasi Circle {
+    zita r = 0
+    basa area() {
+        dzosa this.r * this.r * 3.14159
+    }
+}
+
+basa run(c: Circle, count) {
+    zita total = 0
+    pakati (i = 0, count) {
+        c.r = i
+        total = total + c.area()
+    }
+    dzosa total
+}
+
+nyora(run(new Circle(), n))
+TN
+
+cat > "$DIR/virtual.tn" <<TN
+zita n = $ITERATIONS
+
+kirasi Shape {
+    zita r = 0
+    basa area() {
+        dzosa 0
+    }
+}
+
+kirasi Circle extends Shape {
+    basa area() {
+        dzosa this.r * this.r * 3.14159
+    }
+}
+
+kirasi Square extends Shape {
+    basa area() {
+        dzosa this.r * this.r
+    }
+}
+
+basa run(c: Shape, q: Shape, count) {
+    zita total = 0
+    zita s: Shape
+    pakati (i = 0, count) {
+        kana (nambaInosara(i, 2) < 1) {
+            s = c
+        } kanaKuti {
+            s = q
+        }
+        s.r = i
+        total = total + s.area()
+    }
+    dzosa total
+}
+
+nyora(run(new Circle(), new Square(), n))
+TN
+
+for CASE in direct devirtualized virtual; do
+  echo "== $CASE"
+  /usr/bin/time -f "%e s" "$TINO" -O3 --whole-program "$DIR/$CASE.tn"
+done
+
+echo "== virtual, --profile-use"
+"$TINO" -O3 --whole-program --profile-generate="$DIR/virtual.profile" "$DIR/virtual.tn" > /dev/null
+/usr/bin/time -f "%e s" "$TINO" -O3 --whole-program --profile-use="$DIR/virtual.profile" "$DIR/virtual.tn"
@@ -0,0 +1,147 @@
+#!/bin/sh
+# Fork-join with 'tanga' and 'mirira': the seconds (as nguva() measures
+# them) for
+#
+#   fib        doubly recursive Fibonacci, each call above the cutoff
+#              starting fib(n - 1) as a task and computing fib(n - 2) itself
+#   mergesort  a top-down merge sort of pseudo-random doubles, the left half
+#              of every range above the cutoff sorted as a task
+#
+# first with the cutoff above the problem size, so nothing is spawned, then
+# with tasks on 1, 2, 4, ... threads up to the machine's. The speedup is
+# over the serial run.
+#
+#   benchmarks/forkjoin.sh path/to/tino [fib-n] [sort-n]
+
+TINO=${1:?usage: $0 path/to/tino [fib-n] [sort-n]}
+FIB_N=${2:-34}
+SORT_N=${3:-4000000}
+DIR=$(mktemp -d /tmp/forkjoin.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+# $1 is the name, $2 the cutoff.
+fib_script() {
+  cat > "$DIR/$1.tn" <<TN
+basa fib(n) {
+    kana (n < 2) {
+        dzosa n
+    }
+    dzosa fib(n - 1) + fib(n - 2)
+}
+
+basa pfib(n, cutoff) {
+    kana (n < cutoff) {
+        dzosa fib(n)
+    }
+    zita a = tanga pfib(n - 1, cutoff)
+    zita b = pfib(n - 2, cutoff)
+    dzosa mirira(a) + b
+}
+
+zita start = 0
+start = nguva()
+zita result = 0
+result = pfib($FIB_N, $2)
+nyora(nguva() - start)
+TN
+}
+
+sort_script() {
+  cat > "$DIR/$1.tn" <<TN
+basa merge(a: [double], tmp: [double], lo, mid, hi) {
+    zita i = lo
+    zita j = mid
+    zita k = lo
+    kusvika (k < hi) {
+        zita left = 0
+        kana (i < mid) {
+            left = 1
+            kana (j < hi) {
+                kana (a[j] < a[i]) {
+                    left = 0
+                }
+            }
+        }
+        kana (left) {
+            tmp[k] = a[i]
+            i = i + 1
+        } kanaKuti {
+            tmp[k] = a[j]
+            j = j + 1
+        }
+        k = k + 1
+    }
+    pakati (m = lo, hi) {
+        a[m] = tmp[m]
+    }
+    dzosa 0
+}
+
+basa msort(a: [double], tmp: [double], lo, hi, cutoff) {
+    kana (hi - lo < 2) {
+        dzosa 0
+    }
+    zita n = hi - lo
+    zita mid = lo + (n - nambaInosara(n, 2)) * 0.5
+    kana (n > cutoff) {
+        zita left = tanga msort(a, tmp, lo, mid, cutoff)
+        msort(a, tmp, mid, hi, cutoff)
+        mirira(left)
+    } kanaKuti {
+        msort(a, tmp, lo, mid, cutoff)
+        msort(a, tmp, mid, hi, cutoff)
+    }
+    merge(a, tmp, lo, mid, hi)
+    dzosa 0
+}
+
+zita a = new [double]($SORT_N)
+zita tmp = new [double]($SORT_N)
+pakati (i = 0, urefu(a)) {
+    a[i] = saini(i * 12.9898) * 43758.5453
+}
+zita start = 0
+start = nguva()
+msort(a, tmp, 0, urefu(a), $2)
+nyora(nguva() - start)
+
+zita sorted = 1
+pakati (i = 1, urefu(a)) {
+    kana (a[i] < a[i - 1]) {
+        sorted = 0
+    }
+}
+kana (sorted < 1) {
+    nyora("HAINA KURONGEKA")
+}
+TN
+}
+
+fib_script fib_serial $((FIB_N + 1))
+fib_script fib_tasks 20
+sort_script sort_serial $((SORT_N + 1))
+sort_script sort_tasks 4096
+
+# $1 is the label, $2 the script, $3 the serial time (or nothing).
+run() {
+  SECONDS_TAKEN=$("$TINO" -O3 $THREADS_FLAG "$DIR/$2.tn" | head -1)
+  if [ -n "$3" ]; then
+    echo "$1: $SECONDS_TAKEN s, speedup $(awk "BEGIN { printf \"%.2f\", $3 / $SECONDS_TAKEN }")"
+  else
+    echo "$1: $SECONDS_TAKEN s"
+  fi
+}
+
+CORES=$(nproc)
+for BENCH in fib sort; do
+  echo "== $BENCH"
+  THREADS_FLAG=--threads=1
+  run serial ${BENCH}_serial
+  SERIAL=$SECONDS_TAKEN
+  THREADS=1
+  while [ "$THREADS" -le "$CORES" ]; do
+    THREADS_FLAG=--threads=$THREADS
+    run "tanga, $THREADS threads" ${BENCH}_tasks "$SERIAL"
+    THREADS=$((THREADS * 2))
+  done
+done
@@ -0,0 +1,62 @@
+#!/bin/sh
+# Time the same work written as a script loop and as one array builtin, with
+# the builtin's loops built for each instruction set in turn:
+#
+#   loop     'pakati' over the array, one saini call and one add per element
+#   builtin  arraySaini and arraySum, under --simd=scalar, sse2, avx2 and
+#            avx512 (sets this CPU lacks are reported and skipped)
+#
+#   benchmarks/kernels.sh path/to/tino [length] [passes]
+
+TINO=${1:?usage: $0 path/to/tino [length] [passes]}
+LENGTH=${2:-10000000}
+PASSES=${3:-10}
+DIR=$(mktemp -d /tmp/kernels.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/loop.tn" <<TN
+zita n = $LENGTH
+
+basa run(a: [double], passes) {
+    zita total = 0
+    pakati (p = 0, passes) {
+        pakati (i = 0, urefu(a)) {
+            a[i] = i * 0.000001 + p
+        }
+        pakati (i = 0, urefu(a)) {
+            a[i] = saini(a[i])
+        }
+        pakati (i = 0, urefu(a)) {
+            total = total + a[i]
+        }
+    }
+    dzosa total
+}
+
+nyora(run(new [double](n), $PASSES))
+TN
+
+cat > "$DIR/builtin.tn" <<TN
+zita n = $LENGTH
+
+basa run(a: [double], passes) {
+    zita total = 0
+    pakati (p = 0, passes) {
+        pakati (i = 0, urefu(a)) {
+            a[i] = i * 0.000001 + p
+        }
+        arraySaini(a)
+        total = total + arraySum(a)
+    }
+    dzosa total
+}
+
+nyora(run(new [double](n), $PASSES))
+TN
+
+echo "== loop"
+/usr/bin/time -f "%e s" "$TINO" -O3 "$DIR/loop.tn"
+for ISA in scalar sse2 avx2 avx512; do
+  echo "== builtin --simd=$ISA"
+  /usr/bin/time -f "%e s" "$TINO" -O3 --simd=$ISA "$DIR/builtin.tn"
+done
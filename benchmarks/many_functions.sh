@@ -0,0 +1,36 @@
+#!/bin/sh
+# Compare iTLB misses with and without --huge-pages on a script that calls
+# thousands of distinct JIT'd functions in a loop.
+#
+#   benchmarks/many_functions.sh path/to/tino [functions] [iterations]
+#
+# Needs Linux perf. -O0 keeps every function out of line, so the calls really
+# jump all over the JIT's code memory.
+
+TINO=${1:?usage: $0 path/to/tino [functions] [iterations]}
+FUNCTIONS=${2:-4000}
+ITERATIONS=${3:-2000}
+SCRIPT=$(mktemp /tmp/many_functions.XXXXXX.tn)
+trap 'rm -f "$SCRIPT"' EXIT
+
+i=0
+while [ $i -lt "$FUNCTIONS" ]; do
+  echo "basa f$i() { dzosa $i * 2 + 1 }" >> "$SCRIPT"
+  i=$((i + 1))
+done
+
+echo "zita total = 0" >> "$SCRIPT"
+echo "pakati (n = 0, $ITERATIONS) {" >> "$SCRIPT"
+i=0
+while [ $i -lt "$FUNCTIONS" ]; do
+  echo "  total = total + f$i()" >> "$SCRIPT"
+  i=$((i + 1))
+done
+echo "}" >> "$SCRIPT"
+echo "nyora(total)" >> "$SCRIPT"
+
+for FLAGS in "" "--huge-pages"; do
+  echo "== tino -O0 $FLAGS"
+  perf stat -e iTLB-loads,iTLB-load-misses,cycles "$TINO" -O0 $FLAGS "$SCRIPT" \
+    2>&1 >/dev/null | grep -E "iTLB|cycles|elapsed"
+done
@@ -0,0 +1,76 @@
+#!/bin/sh
+# Multiply two n x n matrices and report GFLOP/s (2 n^3 operations over the
+# time nguva() measures), written two ways:
+#
+#   loops      the triple loop of wedzeranisa calls over matrixGet/matrixSet
+#   matrixMul  the blocked, vectorized and threaded builtin, under each
+#              --simd instruction set (sets this CPU lacks are reported and
+#              skipped)
+#
+#   benchmarks/matrix.sh path/to/tino [n] [loop-n]
+
+TINO=${1:?usage: $0 path/to/tino [n] [loop-n]}
+N=${2:-1024}
+LOOP_N=${3:-200}
+DIR=$(mktemp -d /tmp/matrix.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+# Fill a and b with values that depend on i and j so nothing folds away. A
+# 'zita' at the top level starts out as a constant, so start is set apart.
+FILL='
+basa fill(m: Matrix, k) {
+    pakati (i = 0, matrixRows(m)) {
+        pakati (j = 0, matrixCols(m)) {
+            matrixSet(m, i, j, saini(i * k + j))
+        }
+    }
+    dzosa 0
+}
+'
+
+cat > "$DIR/loops.tn" <<TN
+zita n = $LOOP_N
+$FILL
+basa multiply(a: Matrix, b: Matrix, c: Matrix) {
+    pakati (i = 0, matrixRows(a)) {
+        pakati (j = 0, matrixCols(b)) {
+            zita total = 0
+            pakati (k = 0, matrixCols(a)) {
+                total = total + wedzeranisa(matrixGet(a, i, k), matrixGet(b, k, j))
+            }
+            matrixSet(c, i, j, total)
+        }
+    }
+    dzosa 0
+}
+
+zita a = matrix(n, n)
+zita b = matrix(n, n)
+zita c = matrix(n, n)
+fill(a, 3)
+fill(b, 7)
+zita start = 0
+start = nguva()
+multiply(a, b, c)
+nyora(govana(2 * n * n * n, (nguva() - start) * 1000000000))
+TN
+
+cat > "$DIR/builtin.tn" <<TN
+zita n = $N
+$FILL
+zita a = matrix(n, n)
+zita b = matrix(n, n)
+fill(a, 3)
+fill(b, 7)
+zita start = 0
+start = nguva()
+zita c = matrixMul(a, b)
+nyora(govana(2 * n * n * n, (nguva() - start) * 1000000000))
+TN
+
+echo "== loops, n = $LOOP_N (GFLOP/s)"
+"$TINO" -O3 "$DIR/loops.tn"
+for ISA in scalar sse2 avx2 avx512; do
+  echo "== matrixMul --simd=$ISA, n = $N (GFLOP/s)"
+  "$TINO" -O3 --simd=$ISA "$DIR/builtin.tn"
+done
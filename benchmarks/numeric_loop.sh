@@ -0,0 +1,36 @@
+#!/bin/sh
+# Time a floating-point reduction loop with each combination of
+# --march=native and --fast-math.
+#
+#   benchmarks/numeric_loop.sh path/to/tino [iterations]
+#
+# Without --fast-math the additions into 'total' must happen in order, so the
+# loop can't be vectorized; with it they may be reassociated into vector
+# partial sums, and --march=native lets those use the widest vectors (and FMA)
+# this CPU has.
+
+TINO=${1:?usage: $0 path/to/tino [iterations]}
+ITERATIONS=${2:-200000000}
+SCRIPT=$(mktemp /tmp/numeric_loop.XXXXXX.tn)
+trap 'rm -f "$SCRIPT"' EXIT
+
+# The count comes from a global so the loop isn't evaluated at compile time.
+cat > "$SCRIPT" <<TN
+zita n = $ITERATIONS
+
+basa hwerengedza(count) {
+    zita total = 0
+    pakati (i = 0, count) {
+        total = total + i * 0.5 + 1
+    }
+    dzosa total
+}
+
+nyora(hwerengedza(n))
+TN
+
+for FLAGS in "" "--march=native" "--fast-math" "--march=native --fast-math"; do
+  echo "== tino -O3 $FLAGS"
+  # shellcheck disable=SC2086
+  /usr/bin/time -f "%e s" "$TINO" -O3 $FLAGS "$SCRIPT"
+done
@@ -0,0 +1,59 @@
+#!/bin/sh
+# Time a CPU-bound loop written with 'pakati' and with 'pakati pamwe', the
+# parallel one on 1, 2, 4, ... threads up to the machine's:
+#
+#   each iteration sums saini over a short inner loop, so the work is all
+#   arithmetic and the iterations share nothing but the + reduction
+#
+#   benchmarks/parallel.sh path/to/tino [iterations] [inner]
+
+TINO=${1:?usage: $0 path/to/tino [iterations] [inner]}
+ITERATIONS=${2:-2000000}
+INNER=${3:-200}
+DIR=$(mktemp -d /tmp/parallel.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/serial.tn" <<TN
+basa run(n, m) {
+    zita total = 0
+    pakati (i = 0, n) {
+        pakati (j = 0, m) {
+            total = total + saini(i + j)
+        }
+    }
+    dzosa total
+}
+
+nyora(run($ITERATIONS, $INNER))
+TN
+
+cat > "$DIR/parallel.tn" <<TN
+basa run(n, m) {
+    zita total = 0
+    pakati pamwe (i = 0, n) (+: total) {
+        pakati (j = 0, m) {
+            total = total + saini(i + j)
+        }
+    }
+    dzosa total
+}
+
+nyora(run($ITERATIONS, $INNER))
+TN
+
+echo "== serial"
+/usr/bin/time -f "%e s" "$TINO" -O3 "$DIR/serial.tn"
+
+CORES=$(nproc)
+THREADS=1
+while [ "$THREADS" -le "$CORES" ]; do
+  echo "== pamwe, $THREADS threads"
+  /usr/bin/time -f "%e s" "$TINO" -O3 --threads="$THREADS" "$DIR/parallel.tn"
+  THREADS=$((THREADS * 2))
+done
+
+# The serial loop with nothing marked is parallelized automatically once
+# --fast-math allows the + reduction to be reordered.
+echo "== automatic, $CORES threads"
+"$TINO" -O3 --fast-math --report-parallel "$DIR/serial.tn" 2>&1 >/dev/null | head -2
+/usr/bin/time -f "%e s" "$TINO" -O3 --fast-math "$DIR/serial.tn"
@@ -0,0 +1,54 @@
+#!/bin/sh
+# Time a dot product written with numbers and with vec4 lanes:
+#
+#   scalar  one multiply-add per element into one total; without
+#           --fast-math the adds must stay in order, so it isn't vectorized
+#   vec4    four lanes per step with vload4 and vfma, combined by hsum
+#
+#   benchmarks/vectors.sh path/to/tino [length] [passes]
+
+TINO=${1:?usage: $0 path/to/tino [length] [passes]}
+LENGTH=${2:-1000000}
+PASSES=${3:-200}
+DIR=$(mktemp -d /tmp/vectors.XXXXXX)
+trap 'rm -rf "$DIR"' EXIT
+
+cat > "$DIR/scalar.tn" <<TN
+zita n = $LENGTH
+
+basa run(a: [double], passes) {
+    zita total = 0
+    pakati (p = 0, passes) {
+        pakati (i = 0, urefu(a)) {
+            total = total + a[i] * a[i]
+        }
+    }
+    dzosa total
+}
+
+nyora(run(new [double](n), $PASSES))
+TN
+
+cat > "$DIR/vec4.tn" <<TN
+zita n = $LENGTH
+
+basa run(a: [double], passes) {
+    zita acc: vec4
+    pakati (p = 0, passes) {
+        zita i = 0
+        kusvika (i + 3 < urefu(a)) {
+            zita x = vload4(a, i)
+            acc = vfma(x, x, acc)
+            i = i + 4
+        }
+    }
+    dzosa hsum(acc)
+}
+
+nyora(run(new [double](n), $PASSES))
+TN
+
+for CASE in scalar vec4; do
+  echo "== $CASE"
+  /usr/bin/time -f "%e s" "$TINO" -O3 "$DIR/$CASE.tn"
+done
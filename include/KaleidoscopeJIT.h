@@ -34,6 +34,8 @@ namespace orc {
 class KaleidoscopeJIT {
 private:
   std::unique_ptr<ExecutionSession> ES;
+  std::unique_ptr<SectionMemoryManager::MemoryMapper> MemMapper;
+  JITTargetMachineBuilder TMBuilder;
 
   DataLayout DL;
   MangleAndInterner Mangle;
@@ -45,17 +47,22 @@ private:
 
 public:
   KaleidoscopeJIT(std::unique_ptr<ExecutionSession> ES,
-                  JITTargetMachineBuilder JTMB, DataLayout DL)
-      : ES(std::move(ES)), DL(std::move(DL)), Mangle(*this->ES, this->DL),
+                  JITTargetMachineBuilder JTMB, DataLayout DL,
+                  std::unique_ptr<SectionMemoryManager::MemoryMapper> MemMapper = nullptr)
+      : ES(std::move(ES)), MemMapper(std::move(MemMapper)), TMBuilder(JTMB),
+        DL(std::move(DL)),
+        Mangle(*this->ES, this->DL),
         ObjectLayer(*this->ES,
-                    []() { return std::make_unique<SectionMemoryManager>(); }),
+                    [this]() {
+                      return std::make_unique<SectionMemoryManager>(this->MemMapper.get());
+                    }),
         CompileLayer(*this->ES, ObjectLayer,
                      std::make_unique<ConcurrentIRCompiler>(std::move(JTMB))),
         MainJD(this->ES->createBareJITDylib("<main>")) {
     MainJD.addGenerator(
         cantFail(DynamicLibrarySearchGenerator::GetForCurrentProcess(
             DL.getGlobalPrefix())));
-    if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
+    if (TMBuilder.getTargetTriple().isOSBinFormatCOFF()) {
       ObjectLayer.setOverrideObjectFlagsWithResponsibilityFlags(true);
       ObjectLayer.setAutoClaimResponsibilityForObjectSymbols(true);
     }
@@ -66,7 +73,14 @@ public:
       ES->reportError(std::move(Err));
   }
 
-  static Expected<std::unique_ptr<KaleidoscopeJIT>> Create() {
+  /// Create - Build the JIT. A MemMapper, if given, supplies the memory for
+  /// all code and data sections instead of the default page mapper. With
+  /// HostCPU, code is generated for the CPU we are running on (its name and
+  /// features from sys::getHostCPUName/getHostCPUFeatures) rather than the
+  /// baseline for the triple.
+  static Expected<std::unique_ptr<KaleidoscopeJIT>>
+  Create(std::unique_ptr<SectionMemoryManager::MemoryMapper> MemMapper = nullptr,
+         bool HostCPU = false) {
     auto EPC = SelfExecutorProcessControl::Create();
     if (!EPC)
       return EPC.takeError();
@@ -75,17 +89,33 @@ public:
 
     JITTargetMachineBuilder JTMB(
         ES->getExecutorProcessControl().getTargetTriple());
+    if (HostCPU) {
+      auto HostJTMB = JITTargetMachineBuilder::detectHost();
+      if (!HostJTMB)
+        return HostJTMB.takeError();
+      JTMB = std::move(*HostJTMB);
+    }
+
+    // Make fastcc tail calls real jumps at every optimization level, so
+    // recursion through 'dzosa' runs in constant stack space.
+    JTMB.getOptions().GuaranteedTailCallOpt = true;
 
     auto DL = JTMB.getDefaultDataLayoutForTarget();
     if (!DL)
       return DL.takeError();
 
     return std::make_unique<KaleidoscopeJIT>(std::move(ES), std::move(JTMB),
-                                             std::move(*DL));
+                                             std::move(*DL), std::move(MemMapper));
   }
 
   const DataLayout &getDataLayout() const { return DL; }
 
+  /// createTargetMachine - A target machine matching the code the JIT
+  /// generates, for the optimizer's cost models.
+  Expected<std::unique_ptr<TargetMachine>> createTargetMachine() {
+    return TMBuilder.createTargetMachine();
+  }
+
   JITDylib &getMainJITDylib() { return MainJD; }
 
   Error addModule(ThreadSafeModule TSM, ResourceTrackerSP RT = nullptr) {
@@ -0,0 +1,127 @@
+#include "ast.h"
+
+void ForEachBody(ProgramAST &Program,
+                 const std::function<void(std::vector<std::unique_ptr<ExprAST>> &)> &Fn)
+{
+  for (auto &Function : Program.Functions)
+    Fn(Function->getBody());
+  for (auto &Class : Program.Classes)
+    for (auto &Method : Class->getMethods())
+      Fn(Method->getBody());
+  Fn(Program.TopLevel);
+}
+
+/// The class (or array type) of an initializer that creates an object at
+/// run time, or "" for anything else.
+static std::string createdClass(ExprAST *Init)
+{
+  if (auto *New = dynamic_cast<NewExprAST *>(Init))
+    return New->getClassName();
+  if (auto *NewArray = dynamic_cast<NewArrayExprAST *>(Init))
+    return NewArray->getArrayType();
+  if (dynamic_cast<ArrayExprAST *>(Init))
+    return "[double]";
+  if (auto *Call = dynamic_cast<CallExprAST *>(Init))
+    return ReturnClassOf(Call->getCallee());
+  if (dynamic_cast<SpawnExprAST *>(Init))
+    return "Future";
+  return "";
+}
+
+std::vector<std::unique_ptr<ExprAST>> GlobalVarExprAST::takeRuntimeInitializers()
+{
+  std::vector<std::unique_ptr<ExprAST>> Assignments;
+  for (auto &[Name, Init] : VarNames)
+  {
+    std::string Class = Init ? createdClass(Init.get()) : "";
+    if (Class.empty())
+      continue;
+    auto Null = std::make_unique<NullObjectExprAST>(Class);
+    Assignments.push_back(std::make_unique<BinaryExprAST>(
+        '=', std::make_unique<VariableExprAST>(Name), std::move(Init)));
+    Init = std::move(Null);
+  }
+  return Assignments;
+}
+
+static void collectGlobalUses(ExprAST *E, std::set<std::string> &Declared,
+                              std::set<std::string> &Assigned)
+{
+  if (auto *Bin = dynamic_cast<BinaryExprAST *>(E))
+    if (Bin->getOp() == '=')
+      if (auto *Var = dynamic_cast<VariableExprAST *>(Bin->getLHS()))
+        Assigned.insert(Var->getName());
+
+  if (auto *Global = dynamic_cast<GlobalVarExprAST *>(E))
+    for (auto &Var : Global->getVars())
+      Declared.insert(Var.first);
+
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    collectGlobalUses(Child.get(), Declared, Assigned);
+  });
+}
+
+std::set<std::string> FindReadOnlyGlobals(ProgramAST &Program)
+{
+  std::set<std::string> Declared, Assigned;
+
+  for (auto &Class : Program.Classes)
+    for (auto &Member : Class->getMembers())
+      Declared.insert(Class->getName() + "." + Member.first);
+
+  ForEachBody(Program, [&](std::vector<std::unique_ptr<ExprAST>> &Body) {
+    for (auto &Stmt : Body)
+      collectGlobalUses(Stmt.get(), Declared, Assigned);
+  });
+
+  std::set<std::string> ReadOnly;
+  for (const std::string &Name : Declared)
+    if (!Assigned.count(Name))
+      ReadOnly.insert(Name);
+  return ReadOnly;
+}
+
+static bool isAssigned(ExprAST *E, const std::string &Name)
+{
+  if (auto *Bin = dynamic_cast<BinaryExprAST *>(E))
+    if (Bin->getOp() == '=')
+      if (auto *Var = dynamic_cast<VariableExprAST *>(Bin->getLHS()))
+        if (Var->getName() == Name)
+          return true;
+
+  bool Found = false;
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    Found = Found || isAssigned(Child.get(), Name);
+  });
+  return Found;
+}
+
+bool IsAssigned(const std::vector<std::unique_ptr<ExprAST>> &Body,
+                const std::string &Name)
+{
+  for (auto &Stmt : Body)
+    if (isAssigned(Stmt.get(), Name))
+      return true;
+  return false;
+}
+
+void CollectReferencedNames(ExprAST *E, std::set<std::string> &Names)
+{
+  if (auto *Var = dynamic_cast<VariableExprAST *>(E))
+    Names.insert(Var->getName());
+  else if (auto *Call = dynamic_cast<CallExprAST *>(E))
+    Names.insert(Call->getCallee());
+  else if (auto *Spawn = dynamic_cast<SpawnExprAST *>(E))
+    Names.insert(Spawn->getCallee());
+  else if (auto *New = dynamic_cast<NewExprAST *>(E))
+    Names.insert(New->getClassName() + ".gadzira");
+  else if (auto *Method = dynamic_cast<MethodCallExprAST *>(E))
+  {
+    if (!Method->getObject())
+      Names.insert(Method->getClassName() + "." + Method->getMethod());
+  }
+
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    CollectReferencedNames(Child.get(), Names);
+  });
+}
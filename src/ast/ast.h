@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <optional>
+#include <set>
 #include "../lexer/lexer.h"
 
 extern std::unique_ptr<IRBuilder<>> Builder;
@@ -15,6 +18,10 @@ public:
   virtual ~ExprAST() = default;
 
   virtual Value *codegen() = 0;
+
+  /// forEachChild - Call Fn on every direct sub-expression. Fn gets the owning
+  /// pointer so AST passes can replace a child in place.
+  virtual void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) {}
 };
 
 /// NumberExprAST - Expression class for numeric literals like "1.0".
@@ -25,6 +32,8 @@ class NumberExprAST : public ExprAST
 public:
   NumberExprAST(double Val) : Val(Val) {}
 
+  double getVal() const { return Val; }
+
   Value *codegen() override;
 };
 
@@ -61,6 +70,10 @@ public:
       : Opcode(Opcode), Operand(std::move(Operand)) {}
 
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Operand);
+  }
 };
 
 class WhileExprAST : public ExprAST
@@ -72,7 +85,16 @@ public:
   WhileExprAST(std::unique_ptr<ExprAST> Cond, std::vector<std::unique_ptr<ExprAST>> Body)
       : Cond(std::move(Cond)), Body(std::move(Body)) {}
 
+  ExprAST *getCond() const { return Cond.get(); }
+  const std::vector<std::unique_ptr<ExprAST>> &getBody() const { return Body; }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Cond);
+    for (auto &Stmt : Body)
+      Fn(Stmt);
+  }
 };
 
 /// BinaryExprAST - Expression class for a binary operator.
@@ -86,7 +108,16 @@ public:
                 std::unique_ptr<ExprAST> RHS)
       : Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
 
+  char getOp() const { return Op; }
+  ExprAST *getLHS() const { return LHS.get(); }
+  ExprAST *getRHS() const { return RHS.get(); }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(LHS);
+    Fn(RHS);
+  }
 };
 
 /// CallExprAST - Expression class for function calls.
@@ -100,7 +131,38 @@ public:
               std::vector<std::unique_ptr<ExprAST>> Args)
       : Callee(Callee), Args(std::move(Args)) {}
 
+  const std::string &getCallee() const { return Callee; }
+  const std::vector<std::unique_ptr<ExprAST>> &getArgs() const { return Args; }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Arg : Args)
+      Fn(Arg);
+  }
+};
+
+/// SpawnExprAST - 'tanga f(args)': the call f(args), run as a task on the
+/// thread pool (see runtime/parallel.h). The arguments are evaluated where
+/// 'tanga' is; its value is a Future, and 'mirira' on it waits for the call
+/// and gives what f returned, which must be a number.
+class SpawnExprAST : public ExprAST
+{
+  std::string Callee;
+  std::vector<std::unique_ptr<ExprAST>> Args;
+
+public:
+  SpawnExprAST(const std::string &Callee, std::vector<std::unique_ptr<ExprAST>> Args)
+      : Callee(Callee), Args(std::move(Args)) {}
+
+  const std::string &getCallee() const { return Callee; }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Arg : Args)
+      Fn(Arg);
+  }
 };
 
 /// IfExprAST - Expression class for if/then/else.
@@ -114,7 +176,19 @@ public:
   IfExprAST(std::unique_ptr<ExprAST> Cond, std::vector<std::unique_ptr<ExprAST>> ThenBody, std::vector<std::unique_ptr<ExprAST>> ElseBody)
       : Cond(std::move(Cond)), ThenBody(std::move(ThenBody)), ElseBody(std::move(ElseBody)) {}
 
+  ExprAST *getCond() const { return Cond.get(); }
+  const std::vector<std::unique_ptr<ExprAST>> &getThen() const { return ThenBody; }
+  const std::vector<std::unique_ptr<ExprAST>> &getElse() const { return ElseBody; }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Cond);
+    for (auto &Stmt : ThenBody)
+      Fn(Stmt);
+    for (auto &Stmt : ElseBody)
+      Fn(Stmt);
+  }
 };
 class BlockExprAST : public ExprAST
 {
@@ -131,13 +205,34 @@ public:
   }
 
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Stmt : Body)
+      Fn(Stmt);
+  }
+};
+/// LoopReduction - A variable a 'pakati pamwe' loop combines across its
+/// iterations, and the operator it combines them with.
+struct LoopReduction
+{
+  enum Kind { Add, Mul, Min, Max };
+  std::string Var;
+  Kind Op;
 };
+
+struct ParallelPlan;
+
 /// ForExprAST - Expression class for for/in.
 class ForExprAST : public ExprAST
 {
   std::string VarName;
   std::unique_ptr<ExprAST> Start, End, Step;
   std::unique_ptr<BlockExprAST> Body;
+  bool Parallel = false;                 // 'pakati pamwe'
+  std::vector<LoopReduction> Reductions; // Only for a parallel loop.
+  int Line = 0;                          // Where 'pakati' is, for reports.
+
+  Value *codegenParallel(const ParallelPlan *Auto = nullptr);
 
 public:
   ForExprAST(const std::string &VarName, std::unique_ptr<ExprAST> Start,
@@ -146,7 +241,35 @@ public:
       : VarName(VarName), Start(std::move(Start)), End(std::move(End)),
         Step(std::move(Step)), Body(std::move(Body)) {}
 
+  const std::string &getVarName() const { return VarName; }
+  ExprAST *getStart() const { return Start.get(); }
+  ExprAST *getEnd() const { return End.get(); }
+  ExprAST *getStep() const { return Step.get(); }
+  BlockExprAST *getBody() const { return Body.get(); }
+
+  /// Run the iterations on the runtime's thread pool (see
+  /// runtime/parallel.h), combining each of Reductions across them.
+  void setParallel(std::vector<LoopReduction> Reductions)
+  {
+    Parallel = true;
+    this->Reductions = std::move(Reductions);
+  }
+  bool isParallel() const { return Parallel; }
+  const std::vector<LoopReduction> &getReductions() const { return Reductions; }
+
+  void setLine(int L) { Line = L; }
+  int getLine() const { return Line; }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Start);
+    Fn(End);
+    if (Step)
+      Fn(Step);
+    if (Body)
+      Body->forEachChild(Fn);
+  }
 };
 /// VarExprAST - Expression class for var/in
 /// VarExprAST - Expression class for var/in
@@ -161,7 +284,18 @@ public:
       std::unique_ptr<ExprAST> Body)
       : VarNames(std::move(VarNames)), Body(std::move(Body)) {}
 
+  const auto &getVars() const { return VarNames; }
+  ExprAST *getBody() const { return Body.get(); }
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Var : VarNames)
+      if (Var.second)
+        Fn(Var.second);
+    if (Body)
+      Fn(Body);
+  }
 };
 
 class GlobalVarExprAST : public ExprAST
@@ -174,8 +308,19 @@ public:
       : VarNames(std::move(VarNames)) {}
 
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Var : VarNames)
+      if (Var.second)
+        Fn(Var.second);
+  }
 
   const auto &getVars() const { return VarNames; }
+
+  /// takeRuntimeInitializers - Replace every 'new' initializer with a null
+  /// object and return the assignments that give the variables their real
+  /// values; a global's initializer must be a constant.
+  std::vector<std::unique_ptr<ExprAST>> takeRuntimeInitializers();
 };
 
 class ReturnExprAST : public ExprAST
@@ -186,7 +331,202 @@ public:
   ReturnExprAST(std::unique_ptr<ExprAST> RetVal)
       : RetVal(std::move(RetVal)) {}
 
+  ExprAST *getRetVal() const { return RetVal.get(); }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(RetVal);
+  }
+};
+
+/// NewExprAST - 'new Class(args)'. The arguments go to the class's
+/// 'gadzira' method, if it has one.
+class NewExprAST : public ExprAST
+{
+  std::string ClassName;
+  std::vector<std::unique_ptr<ExprAST>> Args;
+
+public:
+  NewExprAST(const std::string &ClassName,
+             std::vector<std::unique_ptr<ExprAST>> Args)
+      : ClassName(ClassName), Args(std::move(Args)) {}
+
+  const std::string &getClassName() const { return ClassName; }
+  const std::vector<std::unique_ptr<ExprAST>> &getArgs() const { return Args; }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Arg : Args)
+      Fn(Arg);
+  }
+};
+
+/// ThisExprAST - 'this' inside a method.
+class ThisExprAST : public ExprAST
+{
+public:
+  Value *codegen() override;
+};
+
+/// NullObjectExprAST - The value of a 'zita name: Class' declared without
+/// an initializer: no object yet.
+class NullObjectExprAST : public ExprAST
+{
+  std::string ClassName;
+
+public:
+  NullObjectExprAST(const std::string &ClassName) : ClassName(ClassName) {}
+
+  const std::string &getClassName() const { return ClassName; }
+
+  Value *codegen() override;
+};
+
+/// MemberExprAST - 'object.field' on an instance.
+class MemberExprAST : public ExprAST
+{
+  std::unique_ptr<ExprAST> Object;
+  std::string Field;
+
+public:
+  MemberExprAST(std::unique_ptr<ExprAST> Object, const std::string &Field)
+      : Object(std::move(Object)), Field(Field) {}
+
+  ExprAST *getObject() const { return Object.get(); }
+  const std::string &getField() const { return Field; }
+
+  /// codegenAddress - The field's address, and its type in FieldTy.
+  Value *codegenAddress(Type *&FieldTy);
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Object);
+  }
+};
+
+/// MethodCallExprAST - 'object.method(args)', or 'Class.method(args)' with
+/// no object, in which case the method gets a null 'this'.
+class MethodCallExprAST : public ExprAST
+{
+  std::unique_ptr<ExprAST> Object;
+  std::string ClassName; // Set for a call through the class name.
+  std::string Method;
+  std::vector<std::unique_ptr<ExprAST>> Args;
+
+public:
+  MethodCallExprAST(std::unique_ptr<ExprAST> Object, const std::string &ClassName,
+                    const std::string &Method,
+                    std::vector<std::unique_ptr<ExprAST>> Args)
+      : Object(std::move(Object)), ClassName(ClassName), Method(Method),
+        Args(std::move(Args)) {}
+
+  ExprAST *getObject() const { return Object.get(); }
+  const std::string &getClassName() const { return ClassName; }
+  const std::string &getMethod() const { return Method; }
+  const std::vector<std::unique_ptr<ExprAST>> &getArgs() const { return Args; }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    if (Object)
+      Fn(Object);
+    for (auto &Arg : Args)
+      Fn(Arg);
+  }
+};
+
+/// ArrayExprAST - An array literal, '[1, 2, 3]'. Always a [double].
+class ArrayExprAST : public ExprAST
+{
+  std::vector<std::unique_ptr<ExprAST>> Elements;
+
+public:
+  ArrayExprAST(std::vector<std::unique_ptr<ExprAST>> Elements)
+      : Elements(std::move(Elements)) {}
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    for (auto &Element : Elements)
+      Fn(Element);
+  }
+};
+
+/// NewArrayExprAST - 'new [double](n)' or 'new [int](n)': n zeros.
+class NewArrayExprAST : public ExprAST
+{
+  std::string ArrayType; // "[double]" or "[int]"
+  std::unique_ptr<ExprAST> Length;
+
+public:
+  NewArrayExprAST(const std::string &ArrayType, std::unique_ptr<ExprAST> Length)
+      : ArrayType(ArrayType), Length(std::move(Length)) {}
+
+  const std::string &getArrayType() const { return ArrayType; }
+  ExprAST *getLength() const { return Length.get(); }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Length);
+  }
+};
+
+/// IndexExprAST - 'array[index]'.
+class IndexExprAST : public ExprAST
+{
+  std::unique_ptr<ExprAST> Array, Index;
+
+public:
+  IndexExprAST(std::unique_ptr<ExprAST> Array, std::unique_ptr<ExprAST> Index)
+      : Array(std::move(Array)), Index(std::move(Index)) {}
+
+  ExprAST *getArray() const { return Array.get(); }
+  ExprAST *getIndex() const { return Index.get(); }
+
+  /// codegenIndex - The index as an i64, after the bounds check, and the
+  /// collection's data (its elements, or its columns for records) in Data.
+  Value *codegenIndex(Value *&Data);
+
+  /// codegenAddress - The element's address, after the bounds check, and
+  /// its type in ElemTy.
+  Value *codegenAddress(Type *&ElemTy);
+
   Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Array);
+    Fn(Index);
+  }
+};
+
+/// ForInExprAST - 'pakati (x mu array) { ... }': the body once per element,
+/// in order, with x holding the element.
+class ForInExprAST : public ExprAST
+{
+  std::string VarName;
+  std::unique_ptr<ExprAST> Array;
+  std::vector<std::unique_ptr<ExprAST>> Body;
+
+public:
+  ForInExprAST(const std::string &VarName, std::unique_ptr<ExprAST> Array,
+               std::vector<std::unique_ptr<ExprAST>> Body)
+      : VarName(VarName), Array(std::move(Array)), Body(std::move(Body)) {}
+
+  const std::string &getVarName() const { return VarName; }
+  ExprAST *getArray() const { return Array.get(); }
+  const std::vector<std::unique_ptr<ExprAST>> &getBody() const { return Body; }
+
+  Value *codegen() override;
+  void forEachChild(const std::function<void(std::unique_ptr<ExprAST> &)> &Fn) override
+  {
+    Fn(Array);
+    for (auto &Stmt : Body)
+      Fn(Stmt);
+  }
 };
 
 /// FileOpenAST - Represents opening a file.
@@ -263,12 +603,29 @@ public:
 
   Value *codegen() override;
 };
+/// FunctionAttr - What a prototype promises about the function behind it,
+/// turned into LLVM attributes when the function is declared.
+enum FunctionAttr : unsigned
+{
+  FA_None = 0,
+  FA_NoMemory = 1 << 0,         // memory(none): reads and writes no memory
+  FA_ReadOnly = 1 << 1,         // memory(read): reads but never writes
+  FA_InaccessibleMem = 1 << 2,  // only touches state the script can't see
+  FA_NoUnwind = 1 << 3,
+  FA_WillReturn = 1 << 4,
+  FA_NoFree = 1 << 5,
+};
+
 class PrototypeAST
 {
   std::string Name;
   std::vector<std::string> Args;
+  std::vector<std::string> ArgClasses; // Class of each object argument, or "".
   bool IsOperator;
   unsigned Precedence; // Precedence if a binary op.
+  bool Internal = false; // A 'basa' only ever called from JIT'd code.
+  unsigned Attrs = FA_None; // FunctionAttr flags.
+  std::string ReturnClass; // Class of the object returned, or "" for a number.
 
 public:
   PrototypeAST(const std::string &Name, std::vector<std::string> Args,
@@ -276,15 +633,39 @@ public:
       : Name(Name), Args(std::move(Args)), IsOperator(IsOperator),
         Precedence(Prec) {}
 
-  Function *codegen();
+  Function *codegen(const std::string &NameOverride = "");
   const std::vector<std::string>& getArgs() const { return Args; }
   std::vector<std::string> getArgsCopy() const { return Args; }
   bool isOperator() const { return IsOperator; }
   const std::string &getName() const { return Name; }
   std::unique_ptr<PrototypeAST> clone() const {
-    return std::make_unique<PrototypeAST>(Name, Args, IsOperator, Precedence);
+    auto Copy = std::make_unique<PrototypeAST>(Name, Args, IsOperator, Precedence);
+    Copy->ArgClasses = ArgClasses;
+    Copy->Internal = Internal;
+    Copy->Attrs = Attrs;
+    Copy->ReturnClass = ReturnClass;
+    return Copy;
 }
 
+  /// Internal functions use the fast calling convention; externs, builtins
+  /// and the entry points the driver calls keep the C one.
+  void setInternal(bool I = true) { Internal = I; }
+  bool isInternal() const { return Internal; }
+
+  /// Arguments declared 'name: Class' hold objects rather than numbers.
+  void setArgClasses(std::vector<std::string> Classes) { ArgClasses = std::move(Classes); }
+  std::string getArgClass(unsigned i) const
+  {
+    return i < ArgClasses.size() ? ArgClasses[i] : std::string();
+  }
+
+  /// Builtins with a return class return a new object of that class.
+  void setReturnClass(const std::string &Class) { ReturnClass = Class; }
+  const std::string &getReturnClass() const { return ReturnClass; }
+
+  void addAttrs(unsigned A) { Attrs |= A; }
+  unsigned getAttrs() const { return Attrs; }
+
   bool isUnaryOp() const { return IsOperator && Args.size() == 1; }
   bool isBinaryOp() const { return IsOperator && Args.size() == 2; }
 
@@ -320,16 +701,31 @@ public:
 
 class ClassAST {
   std::string Name;
+  std::string Base; // The class this one extends, or "".
   std::vector<std::unique_ptr<FunctionAST>> Methods;
   std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> Members;
+  std::set<std::string> PrivateNames; // Members and methods declared 'private'.
 
 public:
   ClassAST(std::string name,
            std::vector<std::unique_ptr<FunctionAST>> methods,
-           std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> members)
-      : Name(std::move(name)), Methods(std::move(methods)), Members(std::move(members)) {}
+           std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> members,
+           std::string base = "", std::set<std::string> privateNames = {})
+      : Name(std::move(name)), Base(std::move(base)), Methods(std::move(methods)),
+        Members(std::move(members)), PrivateNames(std::move(privateNames)) {}
 
   Value *codegen();
+  /// declare - Lay out the instances, create the class's members and vtable
+  /// and declare its methods, without generating any method body.
+  bool declare();
+  /// codegenMethods - Generate the method bodies of a declared class.
+  bool codegenMethods();
+
+  const std::string &getName() const { return Name; }
+  const std::string &getBase() const { return Base; }
+  bool isPrivate(const std::string &name) const { return PrivateNames.count(name) != 0; }
+  std::vector<std::unique_ptr<FunctionAST>> &getMethods() { return Methods; }
+  auto &getMembers() { return Members; }
   ExprAST *getMember(const std::string &name) const {
       for (const auto &m : Members) {
           if (m.first == name) return m.second.get();
@@ -339,5 +735,63 @@ public:
 };
 
 
+/// ProgramAST - A whole script, split into the pieces that are compiled
+/// separately in --whole-program mode. TopLevel keeps the top-level
+/// statements (including 'zita' declarations) in source order.
+struct ProgramAST
+{
+  std::vector<std::unique_ptr<PrototypeAST>> Externs;
+  std::vector<std::unique_ptr<FunctionAST>> Functions;
+  std::vector<std::unique_ptr<ClassAST>> Classes;
+  std::vector<std::unique_ptr<ExprAST>> TopLevel;
+};
+
+/// ForEachBody - Call Fn on every statement list of a program: function and
+/// method bodies, then the top-level statements.
+void ForEachBody(ProgramAST &Program,
+                 const std::function<void(std::vector<std::unique_ptr<ExprAST>> &)> &Fn);
+
+/// FindReadOnlyGlobals - Names of the program's 'zita' variables (including
+/// class members) that are never assigned after their declaration.
+std::set<std::string> FindReadOnlyGlobals(ProgramAST &Program);
+
+/// IsAssigned - Whether any statement of Body (at any depth) assigns to the
+/// variable Name.
+bool IsAssigned(const std::vector<std::unique_ptr<ExprAST>> &Body,
+                const std::string &Name);
+
+/// CollectReferencedNames - Add every variable and function name E uses.
+void CollectReferencedNames(ExprAST *E, std::set<std::string> &Names);
+
+/// ReturnClassOf - The class of the object a call to Callee returns, or "" if
+/// it returns a number (codegen.cpp).
+std::string ReturnClassOf(const std::string &Callee);
+
+/// Partial evaluation (evaluate.cpp). Before codegen, FoldConstants replaces
+/// every expression it can compute at compile time with its value: arithmetic
+/// on constants, calls to pure builtins and calls to user functions that turn
+/// out to be pure for the given arguments. Anything with a side effect, or
+/// that doesn't finish within a fixed step budget, is left alone.
+using BuiltinEvaluator =
+    std::function<std::optional<double>(const std::vector<double> &)>;
+
+/// AddPureBuiltin - Let the evaluator run builtin Name. Fn may return nullopt
+/// for arguments whose result must be left to run time.
+void AddPureBuiltin(const std::string &Name, unsigned NumArgs, BuiltinEvaluator Fn);
+
+/// ForgetPureBuiltin - Stop running builtin Name at compile time: the script
+/// defines a 'basa' of its own by that name, and calls go to that instead.
+void ForgetPureBuiltin(const std::string &Name);
+
+/// AddEvaluableFunction - Make a 'basa' available to the evaluator, in place
+/// of any builtin of the same name. Fn must outlive every later
+/// FoldConstants call.
+void AddEvaluableFunction(FunctionAST *Fn);
+
+/// AddConstantGlobal - Record a 'zita' whose value never changes.
+void AddConstantGlobal(const std::string &Name, double Val);
+
+void FoldConstants(std::unique_ptr<ExprAST> &E);
+void FoldConstants(std::vector<std::unique_ptr<ExprAST>> &Body);
 
 #endif
\ No newline at end of file
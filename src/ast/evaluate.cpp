@@ -0,0 +1,343 @@
+#include "ast.h"
+#include <cmath>
+#include <map>
+
+// An expression evaluated at compile time must not take longer than this many
+// AST nodes, counting every node visited in the functions it calls.
+static const unsigned EvalStepBudget = 1000000;
+// Deepest chain of user function calls the evaluator follows.
+static const unsigned EvalCallDepth = 256;
+
+static std::map<std::string, std::pair<unsigned, BuiltinEvaluator>> PureBuiltins;
+static std::map<std::string, FunctionAST *> EvaluableFunctions;
+static std::map<std::string, double> ConstantGlobals;
+
+void AddPureBuiltin(const std::string &Name, unsigned NumArgs, BuiltinEvaluator Fn)
+{
+  PureBuiltins[Name] = {NumArgs, std::move(Fn)};
+}
+
+void ForgetPureBuiltin(const std::string &Name)
+{
+  PureBuiltins.erase(Name);
+}
+
+void AddEvaluableFunction(FunctionAST *Fn)
+{
+  ForgetPureBuiltin(Fn->getName());
+  // A redefinition gets a new name in the module and calls keep going to
+  // the first one, so the first one is what the evaluator must run too.
+  EvaluableFunctions.emplace(Fn->getName(), Fn);
+}
+
+void AddConstantGlobal(const std::string &Name, double Val)
+{
+  ConstantGlobals[Name] = Val;
+}
+
+namespace {
+
+/// Evaluator - A small interpreter for the side-effect-free subset of the
+/// language. It follows the semantics of the generated code exactly (ULT/UGT
+/// comparisons, ONE for conditions, loops that test at the bottom) so a folded
+/// value is the value the program would have computed.
+class Evaluator
+{
+  enum Status
+  {
+    Ok,       // Val holds the expression's value.
+    Returned, // A 'dzosa' ran; Val holds the returned value.
+    Failed    // Not evaluable at compile time.
+  };
+
+  // Innermost body last, mirroring LocalScope in codegen.
+  using Scopes = std::vector<std::map<std::string, double>>;
+
+  unsigned Steps = 0;
+  unsigned Depth = 0;
+
+  static double *lookup(Scopes &Vars, const std::string &Name)
+  {
+    for (auto It = Vars.rbegin(); It != Vars.rend(); ++It)
+    {
+      auto Found = It->find(Name);
+      if (Found != It->end())
+        return &Found->second;
+    }
+    return nullptr;
+  }
+
+  static bool isTrue(double V) { return !std::isnan(V) && V != 0.0; }
+
+  Status runBody(const std::vector<std::unique_ptr<ExprAST>> &Body, Scopes &Vars,
+                 double &Val)
+  {
+    Vars.emplace_back();
+    Status S = Ok;
+    for (auto &Stmt : Body)
+      if ((S = run(Stmt.get(), Vars, Val)) != Ok)
+        break;
+    Vars.pop_back();
+    return S;
+  }
+
+  Status call(const CallExprAST *Call, Scopes &Vars, double &Val)
+  {
+    std::vector<double> Args;
+    for (auto &Arg : Call->getArgs())
+    {
+      if (run(Arg.get(), Vars, Val) != Ok)
+        return Failed;
+      Args.push_back(Val);
+    }
+
+    auto Builtin = PureBuiltins.find(Call->getCallee());
+    if (Builtin != PureBuiltins.end())
+    {
+      if (Builtin->second.first != Args.size())
+        return Failed;
+      std::optional<double> Result = Builtin->second.second(Args);
+      if (!Result)
+        return Failed;
+      Val = *Result;
+      return Ok;
+    }
+
+    auto User = EvaluableFunctions.find(Call->getCallee());
+    if (User == EvaluableFunctions.end() || Depth == EvalCallDepth)
+      return Failed;
+    FunctionAST *Fn = User->second;
+    const std::vector<std::string> &Params = Fn->getProto()->getArgs();
+    if (Params.size() != Args.size())
+      return Failed;
+
+    Scopes Frame(1);
+    for (size_t i = 0; i != Args.size(); ++i)
+      Frame[0][Params[i]] = Args[i];
+
+    ++Depth;
+    Status S = runBody(Fn->getBody(), Frame, Val);
+    --Depth;
+    if (S == Failed)
+      return Failed;
+    // Falling off the end of a basa returns 0.
+    if (S == Ok)
+      Val = 0.0;
+    return Ok;
+  }
+
+  Status run(const ExprAST *E, Scopes &Vars, double &Val)
+  {
+    if (++Steps > EvalStepBudget)
+      return Failed;
+
+    if (auto *Num = dynamic_cast<const NumberExprAST *>(E))
+    {
+      Val = Num->getVal();
+      return Ok;
+    }
+
+    if (auto *Var = dynamic_cast<const VariableExprAST *>(E))
+    {
+      if (double *Local = lookup(Vars, Var->getName()))
+      {
+        Val = *Local;
+        return Ok;
+      }
+      auto Global = ConstantGlobals.find(Var->getName());
+      if (Global == ConstantGlobals.end())
+        return Failed;
+      Val = Global->second;
+      return Ok;
+    }
+
+    if (auto *Bin = dynamic_cast<const BinaryExprAST *>(E))
+    {
+      if (Bin->getOp() == '=')
+      {
+        // Only assignments to the evaluator's own locals are side-effect free.
+        auto *Target = dynamic_cast<const VariableExprAST *>(Bin->getLHS());
+        double *Slot = Target ? lookup(Vars, Target->getName()) : nullptr;
+        if (!Slot || run(Bin->getRHS(), Vars, Val) != Ok)
+          return Failed;
+        *Slot = Val;
+        return Ok;
+      }
+
+      double L, R;
+      if (run(Bin->getLHS(), Vars, L) != Ok || run(Bin->getRHS(), Vars, R) != Ok)
+        return Failed;
+      switch (Bin->getOp())
+      {
+      case '+': Val = L + R; return Ok;
+      case '-': Val = L - R; return Ok;
+      case '*': Val = L * R; return Ok;
+      case '<': Val = !(L >= R) ? 1.0 : 0.0; return Ok; // fcmp ult
+      case '>': Val = !(L <= R) ? 1.0 : 0.0; return Ok; // fcmp ugt
+      default: return Failed;
+      }
+    }
+
+    if (auto *Call = dynamic_cast<const CallExprAST *>(E))
+      return call(Call, Vars, Val);
+
+    if (auto *Ret = dynamic_cast<const ReturnExprAST *>(E))
+      return run(Ret->getRetVal(), Vars, Val) == Ok ? Returned : Failed;
+
+    if (auto *If = dynamic_cast<const IfExprAST *>(E))
+    {
+      double Cond;
+      if (run(If->getCond(), Vars, Cond) != Ok)
+        return Failed;
+      Status S = runBody(isTrue(Cond) ? If->getThen() : If->getElse(), Vars, Val);
+      if (S == Ok)
+        Val = 0.0;
+      return S;
+    }
+
+    if (auto *While = dynamic_cast<const WhileExprAST *>(E))
+    {
+      for (;;)
+      {
+        double Cond;
+        if (run(While->getCond(), Vars, Cond) != Ok)
+          return Failed;
+        if (!isTrue(Cond))
+          break;
+        Status S = runBody(While->getBody(), Vars, Val);
+        if (S != Ok)
+          return S;
+      }
+      Val = 0.0;
+      return Ok;
+    }
+
+    if (auto *For = dynamic_cast<const ForExprAST *>(E))
+    {
+      // A parallel loop's iterations are counted and its reductions combined
+      // by the runtime; it is always left to run.
+      if (For->isParallel())
+        return Failed;
+
+      double Start;
+      if (run(For->getStart(), Vars, Start) != Ok)
+        return Failed;
+      Vars.emplace_back();
+      Vars.back()[For->getVarName()] = Start;
+
+      // The body runs once before the end condition is first tested.
+      Status S = Ok;
+      for (;;)
+      {
+        if (For->getBody() &&
+            (S = runBody(For->getBody()->getBody(), Vars, Val)) != Ok)
+          break;
+        double StepVal = 1.0, End;
+        if (For->getStep() && run(For->getStep(), Vars, StepVal) != Ok)
+        {
+          S = Failed;
+          break;
+        }
+        double &Cur = Vars.back()[For->getVarName()];
+        Cur = Cur + StepVal;
+        double Next = Cur;
+        if (run(For->getEnd(), Vars, End) != Ok)
+        {
+          S = Failed;
+          break;
+        }
+        if (Next >= End) // fcmp ult keeps looping on NaN
+          break;
+      }
+      Vars.pop_back();
+      if (S == Ok)
+        Val = 0.0;
+      return S;
+    }
+
+    if (auto *Block = dynamic_cast<const BlockExprAST *>(E))
+    {
+      for (auto &Stmt : Block->getBody())
+      {
+        Status S = run(Stmt.get(), Vars, Val);
+        if (S != Ok)
+          return S;
+      }
+      return Ok;
+    }
+
+    // 'zita' inside a body: a new local in the innermost scope. The
+    // initializers are evaluated before any of the names are visible.
+    if (auto *Decl = dynamic_cast<const VarExprAST *>(E))
+    {
+      if (Decl->getBody() || Vars.empty())
+        return Failed;
+      std::vector<double> Inits;
+      for (auto &[Name, Init] : Decl->getVars())
+      {
+        double InitVal = 0.0;
+        if (Init && run(Init.get(), Vars, InitVal) != Ok)
+          return Failed;
+        Inits.push_back(InitVal);
+      }
+      for (size_t i = 0; i != Inits.size(); ++i)
+        Vars.back()[Decl->getVars()[i].first] = Inits[i];
+      Val = 0.0;
+      return Ok;
+    }
+
+    // Strings, printing, files, globals, user operators...
+    return Failed;
+  }
+
+public:
+  std::optional<double> evaluate(const ExprAST *E)
+  {
+    Scopes Vars;
+    double Val;
+    if (run(E, Vars, Val) != Ok)
+      return std::nullopt;
+    return Val;
+  }
+};
+
+} // end anonymous namespace
+
+/// Expressions whose value is what gets used; statements ('kana', loops,
+/// 'dzosa', declarations) are never replaced, only what's inside them.
+static bool isFoldable(const ExprAST *E)
+{
+  if (auto *Bin = dynamic_cast<const BinaryExprAST *>(E))
+    return Bin->getOp() != '=';
+  return dynamic_cast<const CallExprAST *>(E) != nullptr;
+}
+
+void FoldConstants(std::unique_ptr<ExprAST> &E)
+{
+  if (!E)
+    return;
+
+  // Children first, so a failed attempt at the whole expression still leaves
+  // its constant parts folded.
+  E->forEachChild([](std::unique_ptr<ExprAST> &Child) { FoldConstants(Child); });
+
+  if (!isFoldable(E.get()))
+    return;
+  // Only expressions whose operands are all constants now; anything else
+  // would need a variable and cannot be folded.
+  bool AllConstant = true;
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    AllConstant &= dynamic_cast<NumberExprAST *>(Child.get()) != nullptr;
+  });
+  if (!AllConstant)
+    return;
+
+  if (auto Val = Evaluator().evaluate(E.get()))
+    E = std::make_unique<NumberExprAST>(*Val);
+}
+
+void FoldConstants(std::vector<std::unique_ptr<ExprAST>> &Body)
+{
+  for (auto &Stmt : Body)
+    FoldConstants(Stmt);
+}
@@ -0,0 +1,18 @@
+# Writes the bytes of INPUT to OUTPUT as a C++ array named SYMBOL, along with
+# SYMBOL##Size holding its length.
+#
+#   cmake -DINPUT=file.bin -DOUTPUT=file.cpp -DSYMBOL=Name -P EmbedFile.cmake
+
+file(READ "${INPUT}" HEX_CONTENTS HEX)
+string(LENGTH "${HEX_CONTENTS}" HEX_LENGTH)
+math(EXPR SIZE "${HEX_LENGTH} / 2")
+
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX_CONTENTS}")
+# Break the initializer into lines of 16 bytes.
+string(REGEX REPLACE "((0x[0-9a-f][0-9a-f],){16})" "\\1\n  " BYTES "${BYTES}")
+
+file(WRITE "${OUTPUT}"
+  "// Generated from ${INPUT}; do not edit.\n"
+  "#include <cstddef>\n\n"
+  "extern const unsigned char ${SYMBOL}[] = {\n  ${BYTES}\n};\n"
+  "extern const size_t ${SYMBOL}Size = ${SIZE};\n")
@@ -1,4 +1,12 @@
 #include "codegen.h"
+#include "escape.h"
+#include "profile.h"
+#include "runtimelink.h"
+#include "../runtime/parallel.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/Transforms/Scalar/SROA.h"
 
 std::unique_ptr<LLVMContext> TheContext;
 std::unique_ptr<Module> TheModule;
@@ -14,7 +22,14 @@ std::unique_ptr<PassInstrumentationCallbacks> ThePIC;
 std::unique_ptr<StandardInstrumentations> TheSI;
 std::map<std::string, std::unique_ptr<PrototypeAST>> FunctionProtos;
 ExitOnError ExitOnErr;
+TinoOptions CompileOptions;
 static std::map<std::string, GlobalVariable*> GlobalNamedValues;
+// Globals that are never assigned after their declaration (whole-program mode).
+static std::set<std::string> ReadOnlyGlobals;
+
+// Definitions kept alive for the partial evaluator after their code is
+// generated (see HandleDefinition).
+static std::vector<std::unique_ptr<FunctionAST>> EvaluableDefinitions;
 static bool ModuleInitialized = false;
 static std::mutex global_var_mutex;
 
@@ -53,11 +68,369 @@ Function *getFunction(std::string Name)
 /// CreateEntryBlockAlloca - Create an alloca instruction in the entry block of
 /// the function.  This is used for mutable variables etc.
 static AllocaInst *CreateEntryBlockAlloca(Function *TheFunction,
-                                          StringRef VarName)
+                                          StringRef VarName,
+                                          Type *Ty = nullptr)
 {
   IRBuilder<> TmpB(&TheFunction->getEntryBlock(),
                    TheFunction->getEntryBlock().begin());
-  return TmpB.CreateAlloca(Type::getDoubleTy(*TheContext), nullptr, VarName);
+  return TmpB.CreateAlloca(Ty ? Ty : Type::getDoubleTy(*TheContext), nullptr,
+                           VarName);
+}
+
+// Bindings shadowed by the locals declared in each open body, innermost last.
+static std::vector<std::vector<std::pair<std::string, AllocaInst *>>> ScopeStack;
+
+/// LocalScope - Opens a body for 'zita' declarations. When it closes, every
+/// name declared in it gets its previous binding (or none) back.
+struct LocalScope
+{
+  LocalScope() { ScopeStack.emplace_back(); }
+  ~LocalScope()
+  {
+    auto &Shadowed = ScopeStack.back();
+    for (auto It = Shadowed.rbegin(); It != Shadowed.rend(); ++It)
+    {
+      if (It->second)
+        NamedValues[It->first] = It->second;
+      else
+        NamedValues.erase(It->first);
+    }
+    ScopeStack.pop_back();
+  }
+};
+
+/// ClassInfo - The layout of a class's instances and its vtable. An instance
+/// starts with a pointer to its class's vtable, followed by one field per
+/// member (the base class's first); members declared 'zita x: Class' hold
+/// objects.
+struct ClassInfo
+{
+  StructType *Type = nullptr;
+  std::string Base;
+  std::vector<std::string> Subclasses;   // Direct subclasses.
+  std::vector<std::string> Fields;
+  std::vector<std::string> FieldClasses; // "" for numbers.
+  std::vector<Constant *> Defaults;      // What 'new' stores in each field.
+  std::vector<std::string> Methods;      // Method name of each vtable slot.
+  std::vector<std::string> Impls;        // "Class.method" run for each slot.
+  std::map<std::string, std::string> PrivateMembers; // Name -> declaring class.
+
+  int fieldIndex(const std::string &Field) const
+  {
+    auto It = std::find(Fields.begin(), Fields.end(), Field);
+    return It == Fields.end() ? -1 : int(It - Fields.begin());
+  }
+  int methodSlot(const std::string &Method) const
+  {
+    auto It = std::find(Methods.begin(), Methods.end(), Method);
+    return It == Methods.end() ? -1 : int(It - Methods.begin());
+  }
+};
+static std::map<std::string, ClassInfo> ClassInfos;
+
+/// Arrays are objects of the classes "[double]" and "[int]"; variables and
+/// parameters holding one are tagged like any other object.
+static bool IsArrayClass(const std::string &Class)
+{
+  return Class == "[double]" || Class == "[int]";
+}
+
+/// A collection of records of class Point has class "[Point]". It shares
+/// an array's header, but its data is a table of columns, one per member.
+static std::string RecordClassOf(const std::string &Class)
+{
+  if (Class.size() < 3 || Class.front() != '[' || IsArrayClass(Class))
+    return "";
+  std::string Record = Class.substr(1, Class.size() - 2);
+  return ClassInfos.count(Record) ? Record : "";
+}
+
+static bool IsCollectionClass(const std::string &Class)
+{
+  return IsArrayClass(Class) || !RecordClassOf(Class).empty();
+}
+
+/// vec2, vec4 and vec8 are vectors of 2, 4 and 8 doubles, held as LLVM
+/// vectors. They're values, not objects: 'v: vec4' only gives v its type,
+/// and no variable is tagged with them.
+static unsigned VectorWidthOf(const std::string &Class)
+{
+  if (Class == "vec2")
+    return 2;
+  if (Class == "vec4")
+    return 4;
+  if (Class == "vec8")
+    return 8;
+  return 0;
+}
+
+/// TypeOfClass - The LLVM type of a value of Class: a double for a number
+/// (""), a vector, or a pointer to an object.
+static Type *TypeOfClass(const std::string &Class)
+{
+  if (Class.empty())
+    return Type::getDoubleTy(*TheContext);
+  if (unsigned N = VectorWidthOf(Class))
+    return FixedVectorType::get(Type::getDoubleTy(*TheContext), N);
+  return PointerType::getUnqual(*TheContext);
+}
+
+static unsigned LanesOf(Value *V)
+{
+  auto *VT = dyn_cast<FixedVectorType>(V->getType());
+  return VT ? VT->getNumElements() : 0;
+}
+
+/// MatchLanes - Give numbers mixed with vectors the vectors' width, by
+/// repeating them in every lane. False if the vectors' widths differ or a
+/// value is neither a number nor a vector.
+static bool MatchLanes(std::vector<Value *> &Vals)
+{
+  unsigned N = 0;
+  for (Value *V : Vals)
+  {
+    unsigned Lanes = LanesOf(V);
+    if (!Lanes && !V->getType()->isDoubleTy())
+      return false;
+    if (Lanes && N && Lanes != N)
+      return false;
+    N = Lanes ? Lanes : N;
+  }
+  if (N)
+    for (Value *&V : Vals)
+      if (!LanesOf(V))
+        V = Builder->CreateVectorSplat(N, V, "splat");
+  return true;
+}
+
+static bool MatchLanes(Value *&L, Value *&R)
+{
+  std::vector<Value *> Vals = {L, R};
+  if (!MatchLanes(Vals))
+    return false;
+  L = Vals[0];
+  R = Vals[1];
+  return true;
+}
+
+/// Builtins expanded in place into vector instructions (see VectorBuiltin),
+/// and the numeric builtins that also take vectors (see LanewiseMath).
+static const std::set<std::string> VectorBuiltins = {
+    "vec2", "vec4",    "vec8",    "vload2",   "vload4", "vload8", "vstore",
+    "lane", "setLane", "shuffle", "shuffle2", "hsum",   "hmin",   "hmax",
+    "vmin", "vmax",    "vabs",    "vfma"};
+
+/// IsVectorBuiltin - Whether a call to Callee is expanded as a vector
+/// builtin. A basa or extern of the script's own with one of these names
+/// comes first, so scripts written before vectors keep calling theirs.
+static bool IsVectorBuiltin(const std::string &Callee)
+{
+  return VectorBuiltins.count(Callee) && !FunctionProtos.count(Callee);
+}
+static const std::set<std::string> LanewiseBuiltins = {
+    "wedzera", "bvisaNamba", "wedzeranisa", "govana", "simba",
+    "tsvagaMudzi", "logarithm", "expo", "saini", "cosi"};
+
+/// Variables holding objects carry their class as "tino.class" metadata on
+/// their alloca or global.
+template <typename T> static void setVariableClass(T *Var, const std::string &Class)
+{
+  if (!Class.empty() && !VectorWidthOf(Class))
+    Var->setMetadata("tino.class",
+                     MDNode::get(*TheContext, MDString::get(*TheContext, Class)));
+}
+
+static std::string ClassOfVariable(const std::string &Name)
+{
+  MDNode *MD = nullptr;
+  auto Local = NamedValues.find(Name);
+  if (Local != NamedValues.end() && Local->second)
+    MD = Local->second->getMetadata("tino.class");
+  else if (GlobalVariable *GV = GlobalNamedValues.count(Name) ? GlobalNamedValues[Name] : nullptr)
+    MD = GV->getMetadata("tino.class");
+  return MD ? cast<MDString>(MD->getOperand(0))->getString().str() : "";
+}
+
+std::string ReturnClassOf(const std::string &Callee)
+{
+  auto It = FunctionProtos.find(Callee);
+  return It == FunctionProtos.end() ? "" : It->second->getReturnClass();
+}
+
+/// ClassOf - The class of the object E evaluates to, or "" if E is a number
+/// (or anything else that isn't an object).
+static std::string ClassOf(ExprAST *E)
+{
+  if (auto *New = dynamic_cast<NewExprAST *>(E))
+    return New->getClassName();
+  if (auto *Null = dynamic_cast<NullObjectExprAST *>(E))
+    return Null->getClassName();
+  if (auto *NewArray = dynamic_cast<NewArrayExprAST *>(E))
+    return NewArray->getArrayType();
+  if (dynamic_cast<ArrayExprAST *>(E))
+    return "[double]";
+  if (dynamic_cast<StringExprAST *>(E))
+    return "String";
+  if (auto *Index = dynamic_cast<IndexExprAST *>(E))
+    return RecordClassOf(ClassOf(Index->getArray()));
+  if (auto *Call = dynamic_cast<CallExprAST *>(E))
+    return ReturnClassOf(Call->getCallee());
+  if (dynamic_cast<SpawnExprAST *>(E))
+    return "Future";
+  if (dynamic_cast<ThisExprAST *>(E))
+    return ClassOfVariable("this");
+  if (auto *Var = dynamic_cast<VariableExprAST *>(E))
+    return ClassOfVariable(Var->getName());
+  if (auto *Member = dynamic_cast<MemberExprAST *>(E))
+  {
+    auto It = ClassInfos.find(ClassOf(Member->getObject()));
+    if (It == ClassInfos.end())
+      return "";
+    int Idx = It->second.fieldIndex(Member->getField());
+    return Idx < 0 ? "" : It->second.FieldClasses[Idx];
+  }
+  if (auto *Bin = dynamic_cast<BinaryExprAST *>(E))
+    if (Bin->getOp() == '=')
+      return ClassOf(Bin->getRHS());
+  return "";
+}
+
+/// IsSubclassOf - Whether objects of Class may be used as objects of Base.
+static bool IsSubclassOf(std::string Class, const std::string &Base)
+{
+  while (!Class.empty() && Class != Base)
+  {
+    auto It = ClassInfos.find(Class);
+    Class = It == ClassInfos.end() ? "" : It->second.Base;
+  }
+  return !Class.empty();
+}
+
+/// CheckArgTypes - Report an argument whose type (number or object) is not
+/// the one the callee's parameter has.
+static bool CheckArgTypes(Function *F, const std::vector<Value *> &ArgsV)
+{
+  for (unsigned i = 0, e = ArgsV.size(); i != e; ++i)
+    if (ArgsV[i]->getType() != F->getArg(i)->getType())
+    {
+      LogError(("Rudzi rwe argument " + std::to_string(i + 1) + " ya '" +
+                F->getName().str() + "' haruna kukodzera")
+                   .c_str());
+      return false;
+    }
+  return true;
+}
+
+/// CheckArgClasses - Report an object argument that isn't of its parameter's
+/// class or a subclass of it. Objects, arrays, records, futures and channels
+/// are all just pointers to LLVM, so CheckArgTypes can't tell them apart; an
+/// argument whose class isn't known can't be vouched for either. Args are
+/// the arguments after the callee's first Skip parameters ('this' for a
+/// method).
+static bool CheckArgClasses(const std::string &Callee,
+                            const std::vector<std::unique_ptr<ExprAST>> &Args,
+                            unsigned Skip)
+{
+  auto Proto = FunctionProtos.find(Callee);
+  if (Proto == FunctionProtos.end())
+    return true;
+  for (unsigned i = 0, e = Args.size(); i != e; ++i)
+  {
+    std::string ParamClass = Proto->second->getArgClass(i + Skip);
+    if (ParamClass.empty() || !TypeOfClass(ParamClass)->isPointerTy())
+      continue;
+    if (!IsSubclassOf(ClassOf(Args[i].get()), ParamClass))
+    {
+      LogError(("Rudzi rwe argument " + std::to_string(i + 1) + " ya '" + Callee +
+                "' haruna kukodzera: panotarisirwa " + ParamClass)
+                   .c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+/// getArrayHeaderType - An array's header, { data, length }. It must match
+/// TinoArray in runtime/arrays.h.
+static StructType *getArrayHeaderType()
+{
+  if (StructType *Ty = StructType::getTypeByName(*TheContext, "tino.array"))
+    return Ty;
+  return StructType::create(
+      *TheContext, {PointerType::getUnqual(*TheContext), Type::getInt64Ty(*TheContext)},
+      "tino.array");
+}
+
+/// LoadArrayParts - Load an array's data pointer and length. Neither ever
+/// changes after the array is created, so both loads are invariant and LLVM
+/// is free to hoist them out of loops; the data pointer is also known to be
+/// 64-byte aligned, which lets vectorized loops use aligned accesses.
+static std::pair<Value *, Value *> LoadArrayParts(Value *Arr)
+{
+  LLVMContext &C = *TheContext;
+  StructType *HeaderTy = getArrayHeaderType();
+  MDNode *Empty = MDNode::get(C, {});
+
+  LoadInst *Data = Builder->CreateLoad(
+      PointerType::getUnqual(C), Builder->CreateStructGEP(HeaderTy, Arr, 0), "data");
+  Data->setMetadata(LLVMContext::MD_invariant_load, Empty);
+  Data->setMetadata(LLVMContext::MD_nonnull, Empty);
+  Data->setMetadata(LLVMContext::MD_align,
+                    MDNode::get(C, ConstantAsMetadata::get(
+                                       ConstantInt::get(Type::getInt64Ty(C), 64))));
+
+  LoadInst *Length = Builder->CreateLoad(
+      Type::getInt64Ty(C), Builder->CreateStructGEP(HeaderTy, Arr, 1), "len");
+  Length->setMetadata(LLVMContext::MD_invariant_load, Empty);
+  Length->setMetadata(LLVMContext::MD_range,
+                      MDBuilder(C).createRange(APInt(64, 0), APInt::getSignedMaxValue(64)));
+  return {Data, Length};
+}
+
+/// ProvenIndex - In 'pakati (i = s, urefu(a)) { ... }', where i counts
+/// through whole numbers from s >= 0 and the body assigns neither i nor a,
+/// a[i] (or a[i].x) is in bounds on every iteration if it is on the first. Such a loop
+/// checks that once, as InBounds, and keeps i in Counter as an integer too;
+/// IndexExprAST indexes a with Counter and tests only InBounds, which is
+/// loop-invariant, so the test is unswitched out of the loop and the loop
+/// itself is left for the vectorizer.
+struct ProvenIndex
+{
+  AllocaInst *Var;     // i
+  AllocaInst *Array;   // a
+  AllocaInst *Counter; // i, as an i64
+  Value *InBounds;     // s < urefu(a)
+};
+static std::vector<ProvenIndex> ProvenIndexes;
+
+/// MatchArrayLoop - Whether a loop has the shape ProvenIndex describes;
+/// ArrayName receives the name of the array it walks.
+static bool MatchArrayLoop(const std::string &VarName, ExprAST *Start,
+                           ExprAST *End, ExprAST *Step,
+                           const std::vector<std::unique_ptr<ExprAST>> &Body,
+                           std::string &ArrayName)
+{
+  // Small enough that i converts to and from an i64 exactly.
+  auto IsWholeNumber = [](ExprAST *E, double Min) {
+    auto *Num = dynamic_cast<NumberExprAST *>(E);
+    return Num && Num->getVal() >= Min && Num->getVal() <= 9007199254740992.0 &&
+           Num->getVal() == std::floor(Num->getVal());
+  };
+  if (!IsWholeNumber(Start, 0) || (Step && !IsWholeNumber(Step, 1)))
+    return false;
+
+  auto *Length = dynamic_cast<CallExprAST *>(End);
+  if (!Length || Length->getCallee() != "urefu" || Length->getArgs().size() != 1)
+    return false;
+  auto *Array = dynamic_cast<VariableExprAST *>(Length->getArgs()[0].get());
+  if (!Array)
+    return false;
+  ArrayName = Array->getName();
+
+  auto Local = NamedValues.find(ArrayName);
+  return ArrayName != VarName && Local != NamedValues.end() && Local->second &&
+         IsCollectionClass(ClassOfVariable(ArrayName)) && !IsAssigned(Body, VarName) &&
+         !IsAssigned(Body, ArrayName);
 }
 
 Value *NumberExprAST::codegen()
@@ -68,7 +441,9 @@ Value *NumberExprAST::codegen()
 
 Value *StringExprAST::codegen()
 {
-  return Builder->CreateGlobalStringPtr(Val, "str");
+  // Pass the module explicitly: 'zita' initializers are generated outside of
+  // any function, where the builder has no block to find it from.
+  return Builder->CreateGlobalStringPtr(Val, "str", 0, TheModule.get());
 }
 
 Value *ReturnExprAST::codegen()
@@ -77,8 +452,33 @@ Value *ReturnExprAST::codegen()
   if (!RetValV)
     return nullptr;
 
+  Function *Caller = Builder->GetInsertBlock()->getParent();
+  if (RetValV->getType() != Caller->getReturnType())
+    return LogErrorV("'dzosa' inodzosa namba chete");
+
+  // 'dzosa f(...)' returns the call's result unchanged, so the call can reuse
+  // the caller's frame. When both sides have the same signature and calling
+  // convention the backend must do so (musttail); otherwise it's a hint.
+  auto *CI = dyn_cast<CallInst>(RetValV);
+  if (CI && &Builder->GetInsertBlock()->back() == CI &&
+      CI->getType() == Caller->getReturnType())
+  {
+    Function *Callee = CI->getCalledFunction();
+    if (Callee && Callee->getFunctionType() == Caller->getFunctionType() &&
+        Callee->getCallingConv() == Caller->getCallingConv() &&
+        !Callee->isVarArg())
+      CI->setTailCallKind(CallInst::TCK_MustTail);
+    else
+      CI->setTailCallKind(CallInst::TCK_Tail);
+  }
+
   // Create a return instruction
-  return Builder->CreateRet(RetValV);
+  Value *Ret = Builder->CreateRet(RetValV);
+
+  // Whatever follows 'dzosa' in the same body is unreachable; give it a block
+  // of its own so the enclosing construct can keep emitting its branches.
+  Builder->SetInsertPoint(BasicBlock::Create(*TheContext, "afterdzosa", Caller));
+  return Ret;
 }
 Value *UnaryExprAST::codegen()
 {
@@ -90,14 +490,51 @@ Value *UnaryExprAST::codegen()
   if (!F)
     return LogErrorV("Operator iyi haisi kuzivikanwa");
 
-  return Builder->CreateCall(F, OperandV, "unop");
+  CallInst *Call = Builder->CreateCall(F, OperandV, "unop");
+  Call->setCallingConv(F->getCallingConv());
+  return Call;
 }
 
 Value *BinaryExprAST::codegen()
 {
   if (Op == '=') {
+    // Assignment to a field of an object
+    if (auto *Member = dynamic_cast<MemberExprAST *>(LHS.get())) {
+      Value *Val = RHS->codegen();
+      if (!Val)
+        return nullptr;
+      Type *FieldTy = nullptr;
+      Value *Addr = Member->codegenAddress(FieldTy);
+      if (!Addr)
+        return nullptr;
+      std::string FieldClass = ClassOf(Member);
+      if (Val->getType() != FieldTy ||
+          (!FieldClass.empty() && !IsSubclassOf(ClassOf(RHS.get()), FieldClass)))
+        return LogErrorV(("'" + Member->getField() +
+                          "' haigone kuchengeta kukosha kwerudzi urwu").c_str());
+      Builder->CreateStore(Val, Addr);
+      return Val;
+    }
+
+    // Assignment to an element of an array
+    if (auto *Index = dynamic_cast<IndexExprAST *>(LHS.get())) {
+      Value *Val = RHS->codegen();
+      if (!Val)
+        return nullptr;
+      if (!Val->getType()->isDoubleTy())
+        return LogErrorV("Array inogona kuchengeta manhamba chete");
+      Type *ElemTy = nullptr;
+      Value *Addr = Index->codegenAddress(ElemTy);
+      if (!Addr)
+        return nullptr;
+      Builder->CreateStore(ElemTy->isIntegerTy() ? Builder->CreateFPToSI(Val, ElemTy)
+                                                 : Val,
+                           Addr);
+      return Val;
+    }
+
     // Handle assignment
-    VariableExprAST *LHSE = static_cast<VariableExprAST*>(LHS.get());
+    VariableExprAST *LHSE = dynamic_cast<VariableExprAST*>(LHS.get());
     if (!LHSE)
       return LogErrorV("Panotarisirwa 'zita' kumberi kwa '='");
       
@@ -120,6 +557,16 @@ Value *BinaryExprAST::codegen()
     if (!Variable)
       return LogErrorV(("'Zita iri harisi kuzivikanwa: " + LHSE->getName()).c_str());
 
+    // A number can't go where an object lives, nor an object of another class.
+    Type *VarTy = isa<AllocaInst>(Variable)
+                      ? cast<AllocaInst>(Variable)->getAllocatedType()
+                      : cast<GlobalVariable>(Variable)->getValueType();
+    std::string VarClass = ClassOfVariable(LHSE->getName());
+    if (Val->getType() != VarTy ||
+        (!VarClass.empty() && !IsSubclassOf(ClassOf(RHS.get()), VarClass)))
+      return LogErrorV(("'" + LHSE->getName() +
+                        "' haigone kuchengeta kukosha kwerudzi urwu").c_str());
+
     Builder->CreateStore(Val, Variable);
     return Val;
   }
@@ -130,6 +577,16 @@ Value *BinaryExprAST::codegen()
   if (!L || !R)
     return nullptr;
 
+  // Vectors are added, subtracted, multiplied and compared lane by lane; a
+  // number next to a vector is used in every lane.
+  if (L->getType()->isVectorTy() || R->getType()->isVectorTy())
+  {
+    if (!std::strchr("+-*<>", Op))
+      return LogErrorV((std::string("Opareta '") + Op + "' haishandi ne ma vector").c_str());
+    if (!MatchLanes(L, R))
+      return LogErrorV("Ma vector aya haana upamhi hwakaenzana");
+  }
+
   switch (Op)
   {
   case '+':
@@ -140,11 +597,11 @@ Value *BinaryExprAST::codegen()
     return Builder->CreateFMul(L, R, "multmp");
   case '<':
     L = Builder->CreateFCmpULT(L, R, "cmptmp");
-    // Convert bool 0/1 to double 0.0 or 1.0
-    return Builder->CreateUIToFP(L, Type::getDoubleTy(*TheContext), "booltmp");
+    // Convert bool 0/1 to double 0.0 or 1.0 (in each lane, for vectors)
+    return Builder->CreateUIToFP(L, R->getType(), "booltmp");
   case '>':
     L = Builder->CreateFCmpUGT(L, R, "cmptmp"); // Use unsigned greater than
-    return Builder->CreateUIToFP(L, Type::getDoubleTy(*TheContext), "booltmp");
+    return Builder->CreateUIToFP(L, R->getType(), "booltmp");
   default:
     break;
   }
@@ -155,7 +612,9 @@ Value *BinaryExprAST::codegen()
   assert(F && "binary operator not found!");
 
   Value *Ops[] = {L, R};
-  return Builder->CreateCall(F, Ops, "binop");
+  CallInst *Call = Builder->CreateCall(F, Ops, "binop");
+  Call->setCallingConv(F->getCallingConv());
+  return Call;
 }
 Value *WhileExprAST::codegen()
 {
@@ -171,12 +630,15 @@ Value *WhileExprAST::codegen()
   Value *CondV = Cond->codegen();
   if (!CondV)
     return nullptr;
+  if (!CondV->getType()->isDoubleTy())
+    return LogErrorV("Mamiriro e 'kusvika' anofanira kuva namba");
 
   CondV = Builder->CreateFCmpONE(CondV, ConstantFP::get(*TheContext, APFloat(0.0)), "whilecond");
   Builder->CreateCondBr(CondV, LoopBB, AfterBB);
 
   Builder->SetInsertPoint(LoopBB);
 
+  LocalScope Scope;
   for (auto &Stmt : Body)
   { // ✅ Iterate over multiple expressions
     if (!Stmt->codegen())
@@ -189,10 +651,13 @@ Value *WhileExprAST::codegen()
   return Constant::getNullValue(Type::getDoubleTy(*TheContext));
 }
 
+/// getPrintfFunction - 'nyora' prints through the runtime's tino_printf: plain
+/// printf, except that inside a parallel loop it keeps the output in
+/// iteration order (see runtime/parallel.h).
 Function *getPrintfFunction(Module *TheModule, LLVMContext &TheContext)
 {
   // Check if printf is already declared
-  if (Function *F = TheModule->getFunction("printf"))
+  if (Function *F = TheModule->getFunction("tino_printf"))
     return F;
 
   // Create printf function type: int printf(char*, ...)
@@ -204,13 +669,29 @@ Function *getPrintfFunction(Module *TheModule, LLVMContext &TheContext)
       FunctionType::get(Type::getInt32Ty(TheContext), printfArgs, true);
 
   Function *printfFunc =
-      Function::Create(printfType, Function::ExternalLinkage, "printf", TheModule);
+      Function::Create(printfType, Function::ExternalLinkage, "tino_printf", TheModule);
 
   return printfFunc;
 }
 
+static Value *VectorBuiltin(const std::string &Callee,
+                            const std::vector<std::unique_ptr<ExprAST>> &Args);
+static Value *LanewiseMath(const std::string &Callee, std::vector<Value *> Args);
+
 Value *CallExprAST::codegen()
 {
+  if (IsVectorBuiltin(Callee))
+    return VectorBuiltin(Callee, Args);
+
+  // 'urefu(a)' is the length of an array, read straight from its header.
+  if (Callee == "urefu" && Args.size() == 1 && IsCollectionClass(ClassOf(Args[0].get())))
+  {
+    Value *Arr = Args[0]->codegen();
+    if (!Arr)
+      return nullptr;
+    return Builder->CreateSIToFP(LoadArrayParts(Arr).second,
+                                 Type::getDoubleTy(*TheContext), "urefu");
+  }
 
   // Look up the function in the module.
   Function *CalleeF = getFunction(Callee);
@@ -225,15 +706,52 @@ Value *CallExprAST::codegen()
       return LogErrorV("'nyora' inotarisira kunyora chinhu chimwe chete");
 
     // Generate code for the argument.
+    std::string ArgClass = ClassOf(Args[0].get());
     Value *Arg = Args[0]->codegen();
     if (!Arg)
       return nullptr;
 
+    // Arrays are printed element by element by the runtime.
+    if (IsArrayClass(ArgClass))
+    {
+      LLVMContext &C = *TheContext;
+      FunctionCallee Print = TheModule->getOrInsertFunction(
+          "tino_array_print", Type::getVoidTy(C), PointerType::getUnqual(C),
+          Type::getInt64Ty(C));
+      Builder->CreateCall(Print, {Arg, ConstantInt::get(Type::getInt64Ty(C),
+                                                        ArgClass == "[int]")});
+      return ConstantFP::get(C, APFloat(0.0));
+    }
+
+    // So are matrices, a row per line.
+    if (ArgClass == "Matrix")
+    {
+      LLVMContext &C = *TheContext;
+      FunctionCallee Print = TheModule->getOrInsertFunction(
+          "tino_matrix_print", Type::getVoidTy(C), PointerType::getUnqual(C));
+      Builder->CreateCall(Print, {Arg});
+      return ConstantFP::get(C, APFloat(0.0));
+    }
+
     // Retrieve printf function
     Function *printfFunc = getPrintfFunction(TheModule.get(), *TheContext);
     if (!printfFunc)
       return LogErrorV("Failed to declare printf function");
 
+    // Vectors print their lanes between '<' and '>'.
+    if (unsigned N = LanesOf(Arg))
+    {
+      std::string Format = "<";
+      std::vector<Value *> PrintArgs = {nullptr};
+      for (unsigned i = 0; i != N; ++i)
+      {
+        Format += i ? ", %.5f" : "%.5f";
+        PrintArgs.push_back(Builder->CreateExtractElement(Arg, i));
+      }
+      PrintArgs[0] = Builder->CreateGlobalStringPtr(Format + ">\n", "fmt");
+      return Builder->CreateCall(printfFunc, PrintArgs, "printfcall");
+    }
+
     // Check if the argument is a double or integer
     if (Arg->getType()->isDoubleTy())
     {
@@ -247,9 +765,10 @@ Value *CallExprAST::codegen()
       Value *formatStr = Builder->CreateGlobalStringPtr("%d\n", "fmt"); // Format for integers
       return Builder->CreateCall(printfFunc, {formatStr, Arg}, "printfcall");
     }
-    else if (Arg->getType()->isPointerTy())
+    else if (Arg->getType()->isPointerTy() && ArgClass == "String")
     {
-
+      // Only a string is text; objects, records, futures, channels and
+      // files are pointers too, but not to anything printf can read.
       Value *formatStr = Builder->CreateGlobalStringPtr("%s\n", "fmt"); // Use %s for strings
       return Builder->CreateCall(printfFunc, {formatStr, Arg}, "printfcall");
     }
@@ -272,7 +791,17 @@ Value *CallExprAST::codegen()
     ArgsV.push_back(ArgV);
   }
 
-  Value *Call = Builder->CreateCall(CalleeF, ArgsV, "calltmp");
+  // Given a vector, the math builtins work on each of its lanes.
+  if (LanewiseBuiltins.count(Callee) &&
+      std::any_of(ArgsV.begin(), ArgsV.end(),
+                  [](Value *V) { return V->getType()->isVectorTy(); }))
+    return LanewiseMath(Callee, ArgsV);
+
+  if (!CheckArgTypes(CalleeF, ArgsV) || !CheckArgClasses(Callee, Args, 0))
+    return nullptr;
+
+  CallInst *Call = Builder->CreateCall(CalleeF, ArgsV, "calltmp");
+  Call->setCallingConv(CalleeF->getCallingConv());
 
   // If the function returns void, return nullptr.
   if (CalleeF->getReturnType()->isVoidTy())
@@ -281,11 +810,97 @@ Value *CallExprAST::codegen()
   return Call;
 }
 
+Value *SpawnExprAST::codegen()
+{
+  LLVMContext &C = *TheContext;
+  Type *DoubleTy = Type::getDoubleTy(C);
+  Type *IdxTy = Type::getInt64Ty(C);
+  PointerType *PtrTy = PointerType::getUnqual(C);
+
+  // The arguments are evaluated here, and copied into the future.
+  std::vector<Value *> ArgVals;
+  std::vector<std::string> ArgClasses;
+  std::vector<Type *> EnvFields;
+  for (auto &Arg : Args)
+  {
+    ArgClasses.push_back(ClassOf(Arg.get()));
+    // 'mirira' runs other tasks while it waits (see parallel.h), so a task
+    // waiting on a future could end up underneath that future's own task.
+    if (ArgClasses.back() == "Future")
+      return LogErrorV(("'tanga' haigoni kupihwa future: " + Callee).c_str());
+    Value *V = Arg->codegen();
+    if (!V)
+      return nullptr;
+    ArgVals.push_back(V);
+    EnvFields.push_back(V->getType());
+  }
+  StructType *EnvTy = StructType::get(C, EnvFields);
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+
+  // double task(ptr Env): the call, on locals holding the copied arguments,
+  // so it is checked and generated like any other call.
+  Function *TaskF = Function::Create(FunctionType::get(DoubleTy, {PtrTy}, false),
+                                     Function::InternalLinkage,
+                                     TheFunction->getName() + ".tanga." + Callee,
+                                     TheModule.get());
+  TaskF->addFnAttr(Attribute::NoUnwind);
+
+  auto SavedIP = Builder->saveIP();
+  auto SavedValues = std::move(NamedValues);
+  auto SavedProven = std::move(ProvenIndexes);
+  NamedValues.clear();
+  ProvenIndexes.clear();
+
+  Builder->SetInsertPoint(BasicBlock::Create(C, "entry", TaskF));
+  std::vector<std::unique_ptr<ExprAST>> CallArgs;
+  for (unsigned i = 0, e = ArgVals.size(); i != e; ++i)
+  {
+    std::string Name = "tanga." + std::to_string(i);
+    AllocaInst *Var = CreateEntryBlockAlloca(TaskF, Name, EnvFields[i]);
+    setVariableClass(Var, ArgClasses[i]);
+    Builder->CreateStore(
+        Builder->CreateLoad(EnvFields[i], Builder->CreateStructGEP(EnvTy, TaskF->getArg(0), i),
+                            Name),
+        Var);
+    NamedValues[Name] = Var;
+    CallArgs.push_back(std::make_unique<VariableExprAST>(Name));
+  }
+  Value *Result = CallExprAST(Callee, std::move(CallArgs)).codegen();
+  bool Ok = Result && Result->getType()->isDoubleTy();
+  if (Ok)
+  {
+    Builder->CreateRet(Result);
+    verifyFunction(*TaskF);
+  }
+
+  NamedValues = std::move(SavedValues);
+  ProvenIndexes = std::move(SavedProven);
+  Builder->restoreIP(SavedIP);
+  if (!Ok)
+  {
+    TaskF->eraseFromParent();
+    return LogErrorV(("'tanga' inoda basa rinodzosa namba: " + Callee).c_str());
+  }
+
+  AllocaInst *Env = CreateEntryBlockAlloca(TheFunction, "tanga.env", EnvTy);
+  for (unsigned i = 0, e = ArgVals.size(); i != e; ++i)
+    Builder->CreateStore(ArgVals[i], Builder->CreateStructGEP(EnvTy, Env, i));
+
+  // tino_spawn(task, env, sizeof env)
+  FunctionCallee Spawn =
+      TheModule->getOrInsertFunction("tino_spawn", PtrTy, PtrTy, PtrTy, IdxTy);
+  uint64_t EnvSize = TheModule->getDataLayout().getTypeAllocSize(EnvTy);
+  return Builder->CreateCall(Spawn, {TaskF, Env, ConstantInt::get(IdxTy, EnvSize)},
+                             "future");
+}
+
 Value *IfExprAST::codegen()
 {
   Value *CondV = Cond->codegen();
   if (!CondV)
     return nullptr;
+  if (!CondV->getType()->isDoubleTy())
+    return LogErrorV("Mamiriro e 'kana' anofanira kuva namba");
 
   CondV = Builder->CreateFCmpONE(CondV, ConstantFP::get(*TheContext, APFloat(0.0)), "ifcond");
   Function *TheFunction = Builder->GetInsertBlock()->getParent();
@@ -298,20 +913,26 @@ Value *IfExprAST::codegen()
 
   // Emit 'then' block
   Builder->SetInsertPoint(ThenBB);
-  for (auto &Stmt : ThenBody)
   {
-    if (!Stmt->codegen())
-      return nullptr;
+    LocalScope Scope;
+    for (auto &Stmt : ThenBody)
+    {
+      if (!Stmt->codegen())
+        return nullptr;
+    }
   }
   Builder->CreateBr(MergeBB);
 
   TheFunction->insert(TheFunction->end(), ElseBB);
   Builder->SetInsertPoint(ElseBB);
 
-  for (auto &Stmt : ElseBody)
   {
-    if (!Stmt->codegen())
-      return nullptr;
+    LocalScope Scope;
+    for (auto &Stmt : ElseBody)
+    {
+      if (!Stmt->codegen())
+        return nullptr;
+    }
   }
   Builder->CreateBr(MergeBB);
 
@@ -354,326 +975,2519 @@ Value *BlockExprAST::codegen()
   return LastValue; // Return the last evaluated expression.
 }
 
-Value *ForExprAST::codegen()
+/// ParallelPlan - How to run a serial 'pakati' loop on the thread pool, as
+/// worked out by PlanParallelLoop, or (Reason) why it can't be.
+struct ParallelPlan
 {
-  Function *TheFunction = Builder->GetInsertBlock()->getParent();
-
-  // Create allocas for the loop variable
-  AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarName);
-
-  // Emit the start code first
-  Value *StartVal = Start->codegen();
-  if (!StartVal)
-    return nullptr;
+  std::string Reason;
+  std::vector<LoopReduction> Reductions;
+  // Arrays the loop writes at its own index, each paired with one it reads
+  // at some other index. Two variables may hold the same array, so the loop
+  // checks when it starts that the arrays of each pair are different ones.
+  std::vector<std::pair<std::string, std::string>> Disjoint;
+  // What the loop also checks when it starts, so that no iteration can end
+  // the script part way through, with the output of the iterations before
+  // it still held by the pool: the objects and arrays it uses are there
+  // ("this" among them), it indexes each of the arrays in OwnIndexes at
+  // i + n only inside it, and each of those in InnerStarts only in an inner
+  // 'pakati (j = s, urefu(a))', which needs s inside a.
+  std::vector<std::string> Present;
+  std::vector<std::pair<std::string, double>> OwnIndexes, InnerStarts;
+  int64_t MinIterations = 2; // Fewer aren't worth the pool.
+};
+
+// Roughly how many AST nodes a loop must run, over all its iterations, to
+// be worth running on the pool.
+static const double AutoParallelWork = 100000;
+
+// What a loop whose trip count isn't a constant is assumed to run.
+static const double UnknownTripCount = 16;
+
+// Loops being generated into the body of a parallel loop; they run within
+// one of its iterations.
+static unsigned ParallelBodyDepth = 0;
+
+static bool IsArithmetic(char Op) { return Op == '<' || Op == '>' || Op == '+' || Op == '-' || Op == '*'; }
+
+namespace {
+
+/// IterationAnalysis - Walks the body of a serial 'pakati (i = ...)' loop to
+/// prove that its iterations can run in any order, at the same time:
+///
+///  - it assigns only variables it declares itself, and reductions
+///    (s = s + e, s = s - e, s = s * e, s = vmin(s, e) or s = vmax(s, e),
+///    where nothing else in the body reads s);
+///  - it writes array elements only at its own index (i, or i plus or
+///    minus a whole number; the same one for every write to an array), and
+///    reads a written array only there;
+///  - it calls only builtins that touch no memory or only read it, and
+///    nyora, whose output the pool keeps in order;
+///  - nothing in it can end the script: it calls only builtins that always
+///    return, indexes arrays only where it can be checked once, when the
+///    loop starts, that the index is inside, and uses only objects that
+///    can be checked then to be there.
+///
+/// Arrays are known by the variables holding them. Whether two of those
+/// hold the same array is left to a check when the loop starts, as are the
+/// bounds and the objects.
+class IterationAnalysis
+{
+  struct Access
+  {
+    std::string Array; // "" for an array not held in a variable.
+    bool Own;          // At the loop's own index, i + Offset.
+    double Offset;
+    bool Write;
+  };
 
-  // Store the value into the alloca
-  Builder->CreateStore(StartVal, Alloca);
+  struct Declared
+  {
+    bool Fresh = false;  // Holds an array made in this iteration.
+    bool Object = false; // Might hold an object rather than a number.
+    double Length = -1;  // The fresh array's length, if it is a constant.
+  };
+
+  // An inner 'pakati (j = Start, urefu(Array))', whose j indexes Array
+  // inside it once Start is.
+  struct InnerLoop
+  {
+    std::string Var, Array;
+    size_t Scope; // Where j is declared.
+    double Start;
+  };
+
+  const std::string &LoopVar;
+  std::vector<std::map<std::string, Declared>> Scopes;
+  std::vector<InnerLoop> InnerLoops;
+  std::vector<Access> Accesses;
+  std::set<std::string> Present;
+  std::set<std::pair<std::string, double>> OwnIndexes, InnerStarts;
+  std::map<std::string, LoopReduction::Kind> Reductions;
+  std::set<std::string> Read; // Outer variables read outside a reduction.
+  double Weight = 1;          // Times the node being walked runs per iteration.
+
+public:
+  std::string Reason;
+  double Cost = 0; // Nodes run per iteration, roughly.
+
+  IterationAnalysis(const std::string &LoopVar) : LoopVar(LoopVar) {}
+
+  bool walkBody(const std::vector<std::unique_ptr<ExprAST>> &Body,
+                const std::string &Declares = "")
+  {
+    Scopes.emplace_back();
+    if (!Declares.empty())
+      Scopes.back()[Declares] = Declared();
+    bool Ok = true;
+    for (auto &Stmt : Body)
+      if (!(Ok = walk(Stmt.get())))
+        break;
+    Scopes.pop_back();
+    return Ok;
+  }
 
-  // Create the loop header block
-  BasicBlock *LoopBB = BasicBlock::Create(*TheContext, "loop", TheFunction);
-  Builder->CreateBr(LoopBB);
-  Builder->SetInsertPoint(LoopBB);
+  /// finish - Check what the walk found against the rules, and fill in P.
+  bool finish(ParallelPlan &P)
+  {
+    for (auto &R : Reductions)
+    {
+      if (Read.count(R.first))
+        return fail("'" + R.first + "' inoverengwa, kwete kungounganidzwa chete");
+      // Adding (or multiplying) in another order can change the last bits.
+      if ((R.second == LoopReduction::Add || R.second == LoopReduction::Mul) &&
+          !CompileOptions.FastMath)
+        return fail("kuunganidza '" + R.first +
+                    "' nerumwe rutevedzo kunochinja mhinduro; shandisa --fast-math kana "
+                    "'pakati pamwe'");
+      P.Reductions.push_back({R.first, R.second});
+    }
+    P.Present.assign(Present.begin(), Present.end());
+    P.OwnIndexes.assign(OwnIndexes.begin(), OwnIndexes.end());
+    P.InnerStarts.assign(InnerStarts.begin(), InnerStarts.end());
+
+    std::map<std::string, double> Written;
+    for (const Access &A : Accesses)
+      if (A.Write)
+      {
+        auto It = Written.find(A.Array);
+        if (It != Written.end() && It->second != A.Offset)
+          return fail("inonyora mu '" + A.Array + "' pa ma index akasiyana");
+        Written[A.Array] = A.Offset;
+      }
 
-  // Save the old variable (if it exists)
-  AllocaInst *OldVal = NamedValues[VarName];
-  NamedValues[VarName] = Alloca;
+    for (auto &W : Written)
+    {
+      if (!IsCollectionClass(ClassOfVariable(W.first)))
+        return fail("'" + W.first + "' haisi array inozivikanwa");
+      for (const Access &A : Accesses)
+      {
+        // The same index in every array belongs to this iteration alone.
+        if (A.Own && A.Offset == W.second)
+          continue;
+        if (A.Array.empty())
+          return fail("inoverenga array isina zita, ingangova '" + W.first + "'");
+        if (A.Array == W.first)
+          return fail("inoverenga '" + W.first + "' painonyorwa ne imwe iteration");
+        if (!IsCollectionClass(ClassOfVariable(A.Array)))
+          continue;
+        std::pair<std::string, std::string> Pair(W.first, A.Array);
+        if (std::find(P.Disjoint.begin(), P.Disjoint.end(), Pair) == P.Disjoint.end())
+          P.Disjoint.push_back(Pair);
+      }
+    }
+    return true;
+  }
 
-  // Generate loop body (handling multiple statements)
-  if (Body)
+  /// invariant - Whether E has the same value after every iteration: it
+  /// reads neither i nor a variable the body assigns, and calls only
+  /// builtins that just compute. It reads no field either: the parallel
+  /// loop works E out before the first iteration, and the serial one only
+  /// after it, so an object that isn't there would stop the script before
+  /// that iteration's output rather than after.
+  bool invariant(ExprAST *E) const
   {
-    for (auto &Stmt : Body->getBody())
-    { // Fixed to use getBody()
-      if (!Stmt->codegen())
-        return nullptr;
+    if (auto *Var = dynamic_cast<VariableExprAST *>(E))
+      return Var->getName() != LoopVar && !Reductions.count(Var->getName());
+    if (auto *Call = dynamic_cast<CallExprAST *>(E))
+    {
+      auto Proto = FunctionProtos.find(Call->getCallee());
+      bool Computes = Call->getCallee() == "urefu" ||
+                      (Proto != FunctionProtos.end() &&
+                       (Proto->second->getAttrs() & (FA_NoMemory | FA_InaccessibleMem)) &&
+                       Call->getCallee() != "nguva" && Call->getCallee() != "putchard");
+      if (!Computes)
+        return false;
+    }
+    else if (auto *Bin = dynamic_cast<BinaryExprAST *>(E))
+    {
+      if (!IsArithmetic(Bin->getOp()))
+        return false;
     }
+    else if (!dynamic_cast<NumberExprAST *>(E))
+      return false;
+
+    bool Ok = true;
+    E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+      Ok = Ok && invariant(Child.get());
+    });
+    return Ok;
   }
 
-  // Compute the step value
-  Value *StepVal = Step ? Step->codegen() : ConstantFP::get(*TheContext, APFloat(1.0));
-  if (!StepVal)
-    return nullptr;
-
-  // Load current loop variable
-  Value *CurVar = Builder->CreateLoad(Alloca->getAllocatedType(), Alloca, VarName.c_str());
-
-  // Compute NextVar = i + StepVal
-  Value *NextVar = Builder->CreateFAdd(CurVar, StepVal, "nextvar");
-  Builder->CreateStore(NextVar, Alloca);
+private:
+  bool fail(const std::string &Why)
+  {
+    if (Reason.empty())
+      Reason = Why;
+    return false;
+  }
 
-  // Compute the end condition
-  Value *EndCond = End->codegen();
-  if (!EndCond)
+  Declared *declared(const std::string &Name)
+  {
+    for (auto It = Scopes.rbegin(); It != Scopes.rend(); ++It)
+    {
+      auto D = It->find(Name);
+      if (D != It->end())
+        return &D->second;
+    }
     return nullptr;
+  }
 
-  // Compare NextVar to EndCond: NextVar < EndCond (strict comparison)
-  EndCond = Builder->CreateFCmpULT(NextVar, EndCond, "loopcond");
-
-  // Create the "after loop" block
-  BasicBlock *AfterBB = BasicBlock::Create(*TheContext, "afterloop", TheFunction);
-  Builder->CreateCondBr(EndCond, LoopBB, AfterBB);
-  Builder->SetInsertPoint(AfterBB);
-
-  // Restore the old variable (if it existed)
-  if (OldVal)
-    NamedValues[VarName] = OldVal;
-  else
-    NamedValues.erase(VarName);
+  /// present - The object or array E, which the body uses, must be there.
+  /// One an outer variable (or 'this') holds is checked when the loop
+  /// starts; one made in the iteration always is.
+  bool present(ExprAST *E)
+  {
+    if (dynamic_cast<ThisExprAST *>(E))
+    {
+      Present.insert("this");
+      return true;
+    }
+    if (auto *Var = dynamic_cast<VariableExprAST *>(E))
+    {
+      Declared *D = declared(Var->getName());
+      if (D && !D->Fresh)
+        return fail("inoshandisa '" + Var->getName() + "', ingangova isina chinhu");
+      if (!D)
+        Present.insert(Var->getName());
+      return true;
+    }
+    if (dynamic_cast<ArrayExprAST *>(E) || dynamic_cast<NewArrayExprAST *>(E))
+      return true;
+    return fail("inoshandisa object ingangova isipo");
+  }
 
-  // Return 0.0 (per Kaleidoscope convention)
-  return ConstantFP::get(*TheContext, APFloat(0.0));
-}
-Value* VariableExprAST::codegen() {
-  
-  // First check global variables
+  /// innerIndex - Whether E is the j of an inner loop over the indexes of
+  /// Array, and if so where that loop starts.
+  bool innerIndex(ExprAST *E, const std::string &Array, double &Start)
   {
-    std::lock_guard<std::mutex> lock(global_var_mutex);
-    if (GlobalNamedValues.count(Name)) {
-      GlobalVariable* GV = GlobalNamedValues[Name];
-      if (!GV) {
-        return LogErrorV("'Zita' iri harina kuwanikwa");
-      }
-      return Builder->CreateLoad(GV->getValueType(), GV, Name.c_str());
+    auto *Var = dynamic_cast<VariableExprAST *>(E);
+    if (!Var)
+      return false;
+    for (auto It = InnerLoops.rbegin(); It != InnerLoops.rend(); ++It)
+    {
+      if (It->Var != Var->getName())
+        continue;
+      // j must still be the loop's, not a 'zita j' inside it.
+      for (size_t S = Scopes.size(); S-- > It->Scope + 1;)
+        if (Scopes[S].count(It->Var))
+          return false;
+      Start = It->Start;
+      return It->Array == Array;
     }
+    return false;
   }
-  
-  // Then check local variables
-  AllocaInst* A = NamedValues[Name];
-  if (!A)
-    return LogErrorV(("'Zita' irir harina kuwanikwa: "+Name).c_str());
-  
-  return Builder->CreateLoad(A->getAllocatedType(), A, Name.c_str());
-}
-Value *VarExprAST::codegen()
-{
-  std::vector<AllocaInst *> OldBindings;
 
-  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  /// ownIndex - Whether E is i, i + n, n + i or i - n for a whole number n.
+  bool ownIndex(ExprAST *E, double &Offset)
+  {
+    auto IsLoopVar = [&](ExprAST *X) {
+      auto *Var = dynamic_cast<VariableExprAST *>(X);
+      return Var && Var->getName() == LoopVar && !declared(LoopVar);
+    };
+    auto IsWhole = [](ExprAST *X, double &N) {
+      auto *Num = dynamic_cast<NumberExprAST *>(X);
+      if (!Num || Num->getVal() != std::floor(Num->getVal()))
+        return false;
+      N = Num->getVal();
+      return true;
+    };
+
+    Offset = 0;
+    if (IsLoopVar(E))
+      return true;
+    auto *Bin = dynamic_cast<BinaryExprAST *>(E);
+    double N;
+    if (!Bin)
+      return false;
+    if (Bin->getOp() == '+' && IsLoopVar(Bin->getLHS()) && IsWhole(Bin->getRHS(), N))
+      Offset = N;
+    else if (Bin->getOp() == '+' && IsWhole(Bin->getLHS(), N) && IsLoopVar(Bin->getRHS()))
+      Offset = N;
+    else if (Bin->getOp() == '-' && IsLoopVar(Bin->getLHS()) && IsWhole(Bin->getRHS(), N))
+      Offset = -N;
+    else
+      return false;
+    return true;
+  }
 
-  // Register all variables and emit their initializer.
-  for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
+  static double tripCount(ForExprAST *For)
   {
-    const std::string &VarName = VarNames[i].first;
-    ExprAST *Init = VarNames[i].second.get();
+    auto *Start = dynamic_cast<NumberExprAST *>(For->getStart());
+    auto *End = dynamic_cast<NumberExprAST *>(For->getEnd());
+    auto *Step = dynamic_cast<NumberExprAST *>(For->getStep());
+    double StepVal = For->getStep() ? (Step ? Step->getVal() : 0) : 1;
+    if (!Start || !End || !(StepVal > 0))
+      return UnknownTripCount;
+    return std::max(1.0, std::ceil((End->getVal() - Start->getVal()) / StepVal));
+  }
 
-    // Emit the initializer before adding the variable to scope, this prevents
-    // the initializer from referencing the variable itself, and permits stuff
-    // like this:
-    //  var a = 1 in
-    //    var a = a in ...   # refers to outer 'a'.
-    Value *InitVal;
-    if (Init)
+  /// newArrayLength - The length of the array E makes, if it is a constant
+  /// the runtime can allocate; -1 if not.
+  static double newArrayLength(ExprAST *E)
+  {
+    if (auto *New = dynamic_cast<NewArrayExprAST *>(E))
     {
-      InitVal = Init->codegen();
-      if (!InitVal)
+      auto *Num = dynamic_cast<NumberExprAST *>(New->getLength());
+      if (!Num)
+        return -1;
+      // NaN and negative lengths make empty arrays.
+      if (!(Num->getVal() > 0))
+        return 0;
+      return Num->getVal() <= 0x1p32 ? std::floor(Num->getVal()) : -1;
+    }
+    if (dynamic_cast<ArrayExprAST *>(E))
+    {
+      double N = 0;
+      E->forEachChild([&](std::unique_ptr<ExprAST> &) { ++N; });
+      return N;
+    }
+    return -1;
+  }
+
+  /// reductionOperand - If 'Name = RHS' is a reduction, the operand it
+  /// combines into Name.
+  static ExprAST *reductionOperand(const std::string &Name, ExprAST *RHS,
+                                   LoopReduction::Kind &Kind)
+  {
+    auto IsName = [&](ExprAST *E) {
+      auto *Var = dynamic_cast<VariableExprAST *>(E);
+      return Var && Var->getName() == Name;
+    };
+    if (auto *Bin = dynamic_cast<BinaryExprAST *>(RHS))
+    {
+      char Op = Bin->getOp();
+      if (Op != '+' && Op != '-' && Op != '*')
+        return nullptr;
+      // s = s - e adds up the negated e's.
+      Kind = Op == '*' ? LoopReduction::Mul : LoopReduction::Add;
+      if (IsName(Bin->getLHS()))
+        return Bin->getRHS();
+      if (Op != '-' && IsName(Bin->getRHS()))
+        return Bin->getLHS();
+      return nullptr;
+    }
+    if (auto *Call = dynamic_cast<CallExprAST *>(RHS))
+    {
+      auto &Args = Call->getArgs();
+      if ((Call->getCallee() != "vmin" && Call->getCallee() != "vmax") ||
+          !IsVectorBuiltin(Call->getCallee()) || Args.size() != 2)
         return nullptr;
+      Kind = Call->getCallee() == "vmin" ? LoopReduction::Min : LoopReduction::Max;
+      if (IsName(Args[0].get()))
+        return Args[1].get();
+      if (IsName(Args[1].get()))
+        return Args[0].get();
+    }
+    return nullptr;
+  }
+
+  bool walkChildren(ExprAST *E)
+  {
+    bool Ok = true;
+    E->forEachChild([&](std::unique_ptr<ExprAST> &Child) { Ok = Ok && walk(Child.get()); });
+    return Ok;
+  }
+
+  bool walkRepeated(const std::vector<std::unique_ptr<ExprAST>> &Body, double Trips,
+                    const std::string &Declares = "")
+  {
+    double Saved = Weight;
+    Weight *= Trips;
+    bool Ok = walkBody(Body, Declares);
+    Weight = Saved;
+    return Ok;
+  }
+
+  bool walk(ExprAST *E)
+  {
+    Cost += Weight;
+    if (dynamic_cast<NumberExprAST *>(E) || dynamic_cast<StringExprAST *>(E) ||
+        dynamic_cast<NullObjectExprAST *>(E) || dynamic_cast<ThisExprAST *>(E))
+      return true;
+    if (auto *Var = dynamic_cast<VariableExprAST *>(E))
+    {
+      if (!declared(Var->getName()))
+        Read.insert(Var->getName());
+      return true;
+    }
+    if (auto *Bin = dynamic_cast<BinaryExprAST *>(E))
+    {
+      if (Bin->getOp() == '=')
+        return assign(Bin->getLHS(), Bin->getRHS());
+      if (!IsArithmetic(Bin->getOp()))
+        return fail(std::string("inoshandisa operator '") + Bin->getOp() +
+                    "' yakagadzirwa ne 'basa'");
+      return walk(Bin->getLHS()) && walk(Bin->getRHS());
+    }
+    if (auto *Call = dynamic_cast<CallExprAST *>(E))
+      return call(Call);
+    if (auto *Index = dynamic_cast<IndexExprAST *>(E))
+      return index(Index, false);
+    if (auto *Member = dynamic_cast<MemberExprAST *>(E))
+    {
+      // A record in a collection is there if its index is in bounds.
+      if (dynamic_cast<IndexExprAST *>(Member->getObject()))
+        return walk(Member->getObject());
+      return walk(Member->getObject()) && present(Member->getObject());
+    }
+    if (auto *If = dynamic_cast<IfExprAST *>(E))
+      return walk(If->getCond()) && walkBody(If->getThen()) && walkBody(If->getElse());
+    if (auto *While = dynamic_cast<WhileExprAST *>(E))
+    {
+      double Saved = Weight;
+      Weight *= UnknownTripCount;
+      bool Ok = walk(While->getCond());
+      Weight = Saved;
+      return Ok && walkRepeated(While->getBody(), UnknownTripCount);
+    }
+    if (auto *For = dynamic_cast<ForExprAST *>(E))
+    {
+      if (For->isParallel())
+        return fail("ine 'pakati pamwe' mukati");
+      if (!walk(For->getStart()) || !walk(For->getEnd()) ||
+          (For->getStep() && !walk(For->getStep())))
+        return false;
+      if (!For->getBody())
+        return true;
+
+      // Its j indexes a inside it if it starts inside a (it runs once even
+      // when it ends before it starts).
+      std::string Array;
+      bool ArrayLoop =
+          MatchArrayLoop(For->getVarName(), For->getStart(), For->getEnd(), For->getStep(),
+                         For->getBody()->getBody(), Array) &&
+          !declared(Array) &&
+          present(static_cast<CallExprAST *>(For->getEnd())->getArgs()[0].get());
+      if (ArrayLoop)
+        InnerLoops.push_back({For->getVarName(), Array, Scopes.size(),
+                              static_cast<NumberExprAST *>(For->getStart())->getVal()});
+      bool Ok =
+          walkRepeated(For->getBody()->getBody(), tripCount(For), For->getVarName());
+      if (ArrayLoop)
+        InnerLoops.pop_back();
+      return Ok;
+    }
+    if (auto *ForIn = dynamic_cast<ForInExprAST *>(E))
+      return walk(ForIn->getArray()) && present(ForIn->getArray()) &&
+             walkRepeated(ForIn->getBody(), UnknownTripCount, ForIn->getVarName());
+    if (auto *Block = dynamic_cast<BlockExprAST *>(E))
+      return walkBody(Block->getBody());
+    if (auto *Decl = dynamic_cast<VarExprAST *>(E))
+      return declare(Decl);
+    if (dynamic_cast<ArrayExprAST *>(E))
+      return walkChildren(E);
+    if (dynamic_cast<NewArrayExprAST *>(E))
+    {
+      // A length the runtime might refuse ends the script.
+      if (newArrayLength(E) < 0)
+        return fail("inogadzira array ine urefu husingazivikanwi");
+      return walkChildren(E);
+    }
+    if (dynamic_cast<ReturnExprAST *>(E))
+      return fail("ine 'dzosa'");
+    if (dynamic_cast<SpawnExprAST *>(E))
+      return fail("ine 'tanga'");
+    if (dynamic_cast<NewExprAST *>(E) || dynamic_cast<MethodCallExprAST *>(E))
+      return fail("inodaidza basa re kirasi");
+    return fail("ine chirevo chisingagoni kuongororwa");
+  }
+
+  /// declare - 'zita' in the body: a variable of each iteration's own.
+  bool declare(VarExprAST *Decl)
+  {
+    for (auto &Var : Decl->getVars())
+      if (Var.second && !walk(Var.second.get()))
+        return false;
+
+    // With a body, the names are visible only in it.
+    if (Decl->getBody())
+      Scopes.emplace_back();
+    for (auto &Var : Decl->getVars())
+    {
+      ExprAST *Init = Var.second.get();
+      Declared &D = Scopes.back()[Var.first];
+      D.Fresh = dynamic_cast<NewArrayExprAST *>(Init) || dynamic_cast<ArrayExprAST *>(Init);
+      if (D.Fresh)
+        D.Length = newArrayLength(Init);
+      D.Object = !Init || !ClassOf(Init).empty();
+    }
+    bool Ok = !Decl->getBody() || walk(Decl->getBody());
+    if (Decl->getBody())
+      Scopes.pop_back();
+    return Ok;
+  }
+
+  bool assign(ExprAST *LHS, ExprAST *RHS)
+  {
+    if (auto *Var = dynamic_cast<VariableExprAST *>(LHS))
+    {
+      const std::string &Name = Var->getName();
+      if (Declared *D = declared(Name))
+      {
+        // It may now hold an array other iterations see too.
+        D->Fresh = false;
+        D->Length = -1;
+        D->Object = D->Object || !ClassOf(RHS).empty();
+        return walk(RHS);
+      }
+      if (Name == LoopVar)
+        return fail("inoshandura '" + Name + "'");
+
+      LoopReduction::Kind Kind;
+      if (ExprAST *Operand = reductionOperand(Name, RHS, Kind))
+      {
+        auto It = Reductions.find(Name);
+        if (It != Reductions.end() && It->second != Kind)
+          return fail("'" + Name + "' inounganidzwa ne ma operators akasiyana");
+        Reductions[Name] = Kind;
+        return walk(Operand);
+      }
+      return fail("inoshandura '" + Name + "', inoshandiswa ne iterations dzese");
+    }
+
+    if (!walk(RHS))
+      return false;
+    if (auto *Index = dynamic_cast<IndexExprAST *>(LHS))
+      return index(Index, true);
+    // A member of a record in a collection: pts[i].x = ...
+    if (auto *Member = dynamic_cast<MemberExprAST *>(LHS))
+      if (auto *Index = dynamic_cast<IndexExprAST *>(Member->getObject()))
+        return index(Index, true);
+    return fail("inonyora munda we object");
+  }
+
+  bool index(IndexExprAST *Index, bool Write)
+  {
+    if (!walk(Index->getIndex()))
+      return false;
+
+    auto *Var = dynamic_cast<VariableExprAST *>(Index->getArray());
+    if (!Var)
+      return fail(Write ? "inonyora mu array isina zita"
+                        : "inoverenga array isina zita, ingangova pa index iri kunze kwayo");
+
+    if (Declared *D = declared(Var->getName()))
+    {
+      // Only a constant index into an array of constant length is known
+      // to be inside it.
+      auto *Num = dynamic_cast<NumberExprAST *>(Index->getIndex());
+      if (D->Fresh && Num && Num->getVal() >= 0 && Num->getVal() < std::floor(D->Length))
+        return true;
+      if (!D->Fresh && Write)
+        return fail("inonyora mu '" + Var->getName() +
+                    "', ingangova array inoonekwa ne dzimwe iterations");
+      return fail("inoshandisa '" + Var->getName() + "' pa index ingangova kunze kwayo");
     }
+
+    Access A{Var->getName(), false, 0, Write};
+    A.Own = ownIndex(Index->getIndex(), A.Offset);
+    if (Write && !A.Own)
+      return fail("inonyora mu '" + A.Array + "' pa index isiri '" + LoopVar + "'");
+    double Start;
+    if (A.Own)
+      OwnIndexes.insert({A.Array, A.Offset});
+    else if (innerIndex(Index->getIndex(), A.Array, Start))
+      InnerStarts.insert({A.Array, Start});
     else
-    { // If not specified, use 0.0.
-      InitVal = ConstantFP::get(*TheContext, APFloat(0.0));
+      return fail("inoverenga '" + A.Array + "' pa index ingangova kunze kwayo");
+    Present.insert(A.Array);
+    Accesses.push_back(A);
+    return true;
+  }
+
+  /// readsAnywhere - Arg goes to a builtin that may read any element of it.
+  void readsAnywhere(ExprAST *Arg)
+  {
+    if (auto *Var = dynamic_cast<VariableExprAST *>(Arg))
+    {
+      if (Declared *D = declared(Var->getName()))
+      {
+        if (D->Object && !D->Fresh)
+          Accesses.push_back({"", false, 0, false});
+        return;
+      }
+      Accesses.push_back({Var->getName(), false, 0, false});
+      if (!ClassOfVariable(Var->getName()).empty())
+        Present.insert(Var->getName());
     }
+    else if (!ClassOf(Arg).empty())
+      Accesses.push_back({"", false, 0, false});
+  }
 
-    AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarName);
-    Builder->CreateStore(InitVal, Alloca);
+  bool call(CallExprAST *Call)
+  {
+    const std::string &Callee = Call->getCallee();
+    auto &Args = Call->getArgs();
+    Cost += 8 * Weight;
+    for (auto &Arg : Args)
+      if (!walk(Arg.get()))
+        return false;
+
+    if (Callee == "nyora" || Callee == "urefu")
+      return true;
+    if (IsVectorBuiltin(Callee))
+    {
+      if (Callee == "vstore")
+        return fail("inonyora ne 'vstore'");
+      // Its lanes' indexes are checked only as it runs.
+      if (Callee.rfind("vload", 0) == 0)
+        return fail("inoverenga ne '" + Callee + "'");
+      return true;
+    }
+
+    auto Proto = FunctionProtos.find(Callee);
+    unsigned Attrs = Proto == FunctionProtos.end() ? FA_None : Proto->second->getAttrs();
+    // Builtins that touch only memory no script sees are out too: putchard,
+    // govana, tsvagaMudzi and logarithm write to stderr straight away, out
+    // of order, and nguva would read the clock in another order. So are
+    // those that may end the script, like arrayDot and matrixGet.
+    if ((Attrs & (FA_NoMemory | FA_ReadOnly)) && !(Attrs & FA_WillReturn))
+      return fail("inodaidza '" + Callee + "', ringagumisa script");
+    if (Attrs & FA_NoMemory)
+      return true;
+    if (Attrs & FA_ReadOnly)
+    {
+      for (auto &Arg : Args)
+        readsAnywhere(Arg.get());
+      return true;
+    }
+    return fail("inodaidza '" + Callee + "', risingazivikanwi kuti harichinji chinhu");
+  }
+};
+
+} // end anonymous namespace
+
+/// PlanParallelLoop - Whether the iterations of the serial loop For can
+/// run in parallel and give the same result (see IterationAnalysis), and how.
+static ParallelPlan PlanParallelLoop(const ForExprAST &For)
+{
+  ParallelPlan P;
+  auto Fail = [&](const std::string &Why) {
+    P.Reason = Why;
+    return P;
+  };
+
+  if (!For.getBody())
+    return Fail("haina muviri");
+  // i is then counted exactly, as Start + k * Step.
+  auto *Step = dynamic_cast<NumberExprAST *>(For.getStep());
+  if (For.getStep() &&
+      (!Step || Step->getVal() < 1 || Step->getVal() != std::floor(Step->getVal())))
+    return Fail("nhanho yayo haisi namba yakazara inozivikanwa");
+
+  IterationAnalysis Body(For.getVarName());
+  if (!Body.walkBody(For.getBody()->getBody()) || !Body.finish(P))
+    return Fail(Body.Reason);
+
+  // The serial loop works its end out again after every iteration.
+  if (!Body.invariant(For.getEnd()))
+    return Fail("kupera kwayo kungachinja mukati me loop");
+
+  for (const LoopReduction &R : P.Reductions)
+  {
+    auto Local = NamedValues.find(R.Var);
+    Type *Ty = nullptr;
+    if (Local != NamedValues.end() && Local->second)
+      Ty = Local->second->getAllocatedType();
+    else if (GlobalNamedValues.count(R.Var) && GlobalNamedValues[R.Var])
+      Ty = GlobalNamedValues[R.Var]->getValueType();
+    if (!Ty || !Ty->isDoubleTy() || !ClassOfVariable(R.Var).empty())
+      return Fail("'" + R.Var + "' haisi namba inozivikanwa");
+  }
+
+  P.MinIterations =
+      std::max<int64_t>(2, int64_t(std::ceil(AutoParallelWork / std::max(1.0, Body.Cost))));
+  return P;
+}
+
+/// ReportParallelLoop - --report-parallel: a line on stderr for each
+/// 'pakati (i = ...)' loop, saying whether it runs in parallel, and if not,
+/// why not.
+static void ReportParallelLoop(int Line, const ParallelPlan *Plan)
+{
+  std::string What;
+  if (!Plan)
+    What = "pamwe, sezvainyorwa";
+  else if (!Plan->Reason.empty())
+    What = "kwete pamwe: " + Plan->Reason;
+  else
+  {
+    What = "pamwe kana iine iterations " + std::to_string(Plan->MinIterations) +
+           " kana kupfuura";
+    static const char *const Ops[] = {"+", "*", "min", "max"};
+    for (unsigned r = 0, e = Plan->Reductions.size(); r != e; ++r)
+      What += std::string(r ? ", " : "; reductions: ") + Ops[Plan->Reductions[r].Op] +
+              ": " + Plan->Reductions[r].Var;
+    for (auto &Pair : Plan->Disjoint)
+      What += "; kana '" + Pair.first + "' ne '" + Pair.second + "' dziri arrays dzakasiyana";
+    if (!Plan->OwnIndexes.empty() || !Plan->InnerStarts.empty())
+      What += "; kana ma index ayo ari mukati me arrays";
+  }
+  fprintf(stderr, "pakati pa line %d: %s\n", Line, What.c_str());
+}
+
+Value *ForExprAST::codegen()
+{
+  if (Parallel)
+  {
+    if (CompileOptions.ReportParallel)
+      ReportParallelLoop(Line, nullptr);
+    return codegenParallel();
+  }
+
+  // At -O2 and above, a loop whose iterations provably don't depend on each
+  // other runs on the thread pool too, when it has enough of them.
+  if (CompileOptions.OptLevel >= 2 || CompileOptions.ReportParallel)
+  {
+    ParallelPlan Plan;
+    if (ParallelBodyDepth)
+      Plan.Reason = "iri mukati me loop inoitwa pamwe";
+    else
+      Plan = PlanParallelLoop(*this);
+    if (Plan.Reason.empty() && CompileOptions.OptLevel < 2)
+      Plan.Reason = "inoitwa pamwe pa -O2 kana kupfuura chete";
+    if (CompileOptions.ReportParallel)
+      ReportParallelLoop(Line, &Plan);
+    if (Plan.Reason.empty())
+      return codegenParallel(&Plan);
+  }
+
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+
+  // Create allocas for the loop variable
+  AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarName);
+
+  // Emit the start code first
+  Value *StartVal = Start->codegen();
+  if (!StartVal)
+    return nullptr;
+
+  // Store the value into the alloca
+  Builder->CreateStore(StartVal, Alloca);
+
+  // A loop over the indexes of an array checks the bounds once, here, and
+  // counts with an integer the vectorizer can follow (see ProvenIndex).
+  std::string ArrayName;
+  bool ArrayLoop = Body && MatchArrayLoop(VarName, Start.get(), End.get(), Step.get(),
+                                          Body->getBody(), ArrayName);
+  Type *IdxTy = Type::getInt64Ty(*TheContext);
+  AllocaInst *Counter = nullptr;
+  Value *LengthVal = nullptr;
+  if (ArrayLoop)
+  {
+    AllocaInst *ArrayVar = NamedValues[ArrayName];
+    Value *Arr = Builder->CreateLoad(ArrayVar->getAllocatedType(), ArrayVar, ArrayName);
+    LengthVal = LoadArrayParts(Arr).second;
+    Counter = CreateEntryBlockAlloca(TheFunction, VarName + ".idx", IdxTy);
+    Value *StartIdx = Builder->CreateFPToSI(StartVal, IdxTy);
+    Builder->CreateStore(StartIdx, Counter);
+    ProvenIndexes.push_back({Alloca, ArrayVar, Counter,
+                             Builder->CreateICmpSLT(StartIdx, LengthVal, "inbounds")});
+  }
+
+  // Create the loop header block
+  BasicBlock *LoopBB = BasicBlock::Create(*TheContext, "loop", TheFunction);
+  Builder->CreateBr(LoopBB);
+  Builder->SetInsertPoint(LoopBB);
+
+  // Save the old variable (if it exists)
+  AllocaInst *OldVal = NamedValues[VarName];
+  NamedValues[VarName] = Alloca;
+
+  // Generate loop body (handling multiple statements)
+  if (Body)
+  {
+    LocalScope Scope;
+    bool Failed = false;
+    for (auto &Stmt : Body->getBody())
+    { // Fixed to use getBody()
+      if (!Stmt->codegen())
+      {
+        Failed = true;
+        break;
+      }
+    }
+    if (ArrayLoop)
+      ProvenIndexes.pop_back();
+    if (Failed)
+      return nullptr;
+  }
+
+  // The integer counter steps with the loop variable; the array (and so its
+  // length) can't change inside the loop.
+  if (ArrayLoop)
+  {
+    Value *StepIdx = ConstantInt::get(
+        IdxTy, Step ? int64_t(static_cast<NumberExprAST *>(Step.get())->getVal()) : 1);
+    Value *NextIdx = Builder->CreateNSWAdd(
+        Builder->CreateLoad(IdxTy, Counter, VarName + ".idx"), StepIdx, "nextidx");
+    Builder->CreateStore(NextIdx, Counter);
+    Builder->CreateStore(
+        Builder->CreateSIToFP(NextIdx, Type::getDoubleTy(*TheContext), "nextvar"), Alloca);
+
+    BasicBlock *AfterBB = BasicBlock::Create(*TheContext, "afterloop", TheFunction);
+    Builder->CreateCondBr(Builder->CreateICmpSLT(NextIdx, LengthVal, "loopcond"),
+                          LoopBB, AfterBB);
+    Builder->SetInsertPoint(AfterBB);
+
+    if (OldVal)
+      NamedValues[VarName] = OldVal;
+    else
+      NamedValues.erase(VarName);
+    return ConstantFP::get(*TheContext, APFloat(0.0));
+  }
+
+  // Compute the step value
+  Value *StepVal = Step ? Step->codegen() : ConstantFP::get(*TheContext, APFloat(1.0));
+  if (!StepVal)
+    return nullptr;
+
+  // Load current loop variable
+  Value *CurVar = Builder->CreateLoad(Alloca->getAllocatedType(), Alloca, VarName.c_str());
+
+  // Compute NextVar = i + StepVal
+  Value *NextVar = Builder->CreateFAdd(CurVar, StepVal, "nextvar");
+  Builder->CreateStore(NextVar, Alloca);
+
+  // Compute the end condition
+  Value *EndCond = End->codegen();
+  if (!EndCond)
+    return nullptr;
+
+  // Compare NextVar to EndCond: NextVar < EndCond (strict comparison)
+  EndCond = Builder->CreateFCmpULT(NextVar, EndCond, "loopcond");
+
+  // Create the "after loop" block
+  BasicBlock *AfterBB = BasicBlock::Create(*TheContext, "afterloop", TheFunction);
+  Builder->CreateCondBr(EndCond, LoopBB, AfterBB);
+  Builder->SetInsertPoint(AfterBB);
+
+  // Restore the old variable (if it existed)
+  if (OldVal)
+    NamedValues[VarName] = OldVal;
+  else
+    NamedValues.erase(VarName);
+
+  // Return 0.0 (per Kaleidoscope convention)
+  return ConstantFP::get(*TheContext, APFloat(0.0));
+}
+
+/// ContainsReturn - Whether E (at any depth) is or contains a 'dzosa'.
+static bool ContainsReturn(ExprAST *E)
+{
+  if (dynamic_cast<ReturnExprAST *>(E))
+    return true;
+  bool Found = false;
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    Found = Found || ContainsReturn(Child.get());
+  });
+  return Found;
+}
+
+/// CollectDeclaredNames - Add every name a 'zita' in E (at any depth)
+/// declares.
+static void CollectDeclaredNames(ExprAST *E, std::set<std::string> &Names)
+{
+  if (auto *Decl = dynamic_cast<VarExprAST *>(E))
+    for (auto &Var : Decl->getVars())
+      Names.insert(Var.first);
+  E->forEachChild([&](std::unique_ptr<ExprAST> &Child) {
+    CollectDeclaredNames(Child.get(), Names);
+  });
+}
+
+/// codegenParallel - 'pakati pamwe (i = s, e, step) (op: v, ...) { body }'.
+///
+/// The body becomes a function of its own, run by tino_parallel_for on the
+/// thread pool for ranges [Begin, End) of iteration numbers k, with
+/// i = s + k * step. Unlike the serial loop, e and step are evaluated once,
+/// before the first iteration.
+///
+/// The locals the body uses are copied into an environment when the loop
+/// starts, so the body can't assign to them (or to globals); the
+/// reduction variables are the exception. Each worker has its own copy of
+/// those, which the body reads and assigns like any other variable, and
+/// which start from the operator's identity; after the loop the runtime
+/// combines the copies and each variable is combined with the result.
+Value *ForExprAST::codegenParallel(const ParallelPlan *Auto)
+{
+  const std::vector<LoopReduction> &Reductions = Auto ? Auto->Reductions : this->Reductions;
+  LLVMContext &C = *TheContext;
+  Type *DoubleTy = Type::getDoubleTy(C);
+  Type *IdxTy = Type::getInt64Ty(C);
+  PointerType *PtrTy = PointerType::getUnqual(C);
+  const auto &Stmts = Body->getBody();
+
+  std::set<std::string> Referenced, Declared;
+  for (auto &Stmt : Stmts)
+  {
+    if (ContainsReturn(Stmt.get()))
+      return LogErrorV("'dzosa' haigoni kushandiswa mukati me 'pakati pamwe'");
+    CollectReferencedNames(Stmt.get(), Referenced);
+    CollectDeclaredNames(Stmt.get(), Declared);
+  }
+
+  // Where each reduction variable lives outside the loop.
+  std::vector<Value *> Outer;
+  std::set<std::string> Reduced;
+  for (const LoopReduction &R : Reductions)
+  {
+    if (R.Var == VarName)
+      return LogErrorV("Zita re 'pakati pamwe' harigoni kuva reduction");
+    Value *Ptr = nullptr;
+    Type *Ty = nullptr;
+    auto Local = NamedValues.find(R.Var);
+    if (Local != NamedValues.end() && Local->second)
+    {
+      Ptr = Local->second;
+      Ty = Local->second->getAllocatedType();
+    }
+    else if (GlobalNamedValues.count(R.Var) && GlobalNamedValues[R.Var])
+    {
+      Ptr = GlobalNamedValues[R.Var];
+      Ty = GlobalNamedValues[R.Var]->getValueType();
+    }
+    if (!Ptr)
+      return LogErrorV(("'Zita' irir harina kuwanikwa: " + R.Var).c_str());
+    if (!Ty->isDoubleTy() || !ClassOfVariable(R.Var).empty())
+      return LogErrorV(("Reduction '" + R.Var + "' inofanira kuva namba").c_str());
+    Outer.push_back(Ptr);
+    Reduced.insert(R.Var);
+  }
+
+  // Iterations may run in any order, on any thread: only what each one
+  // declares for itself, and the reductions, can be assigned.
+  for (const std::string &Name : Referenced)
+    if (!Declared.count(Name) && !Reduced.count(Name) && IsAssigned(Stmts, Name))
+      return LogErrorV(("'" + Name +
+                        "' haigoni kushandurwa mukati me 'pakati pamwe' (shandisa reduction)")
+                           .c_str());
+
+  // A loop over the indexes of an array checks the bounds once per range
+  // (see ProvenIndex).
+  std::string ArrayName;
+  bool ArrayLoop =
+      MatchArrayLoop(VarName, Start.get(), End.get(), Step.get(), Stmts, ArrayName);
+
+  // The locals the body reads, copied into its environment after the start
+  // and step.
+  std::vector<std::pair<std::string, AllocaInst *>> Captures;
+  Referenced.insert("this");
+  if (ArrayLoop)
+    Referenced.insert(ArrayName);
+  for (const std::string &Name : Referenced)
+  {
+    auto Local = NamedValues.find(Name);
+    if (Name != VarName && !Reduced.count(Name) && Local != NamedValues.end() &&
+        Local->second)
+      Captures.push_back(*Local);
+  }
+
+  Value *StartVal = Start->codegen();
+  if (!StartVal)
+    return nullptr;
+  Value *EndVal = End->codegen();
+  if (!EndVal)
+    return nullptr;
+  Value *StepVal = Step ? Step->codegen() : ConstantFP::get(C, APFloat(1.0));
+  if (!StepVal)
+    return nullptr;
+  if (!StartVal->getType()->isDoubleTy() || !EndVal->getType()->isDoubleTy() ||
+      !StepVal->getType()->isDoubleTy())
+    return LogErrorV("'pakati pamwe' inoda manhamba");
+
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  std::vector<Type *> EnvFields = {DoubleTy, DoubleTy};
+  for (auto &Capture : Captures)
+    EnvFields.push_back(Capture.second->getAllocatedType());
+  StructType *EnvTy = StructType::get(C, EnvFields);
+  AllocaInst *Env = CreateEntryBlockAlloca(TheFunction, "pamwe.env", EnvTy);
+  Builder->CreateStore(StartVal, Builder->CreateStructGEP(EnvTy, Env, 0));
+  Builder->CreateStore(StepVal, Builder->CreateStructGEP(EnvTy, Env, 1));
+  for (unsigned i = 0, e = Captures.size(); i != e; ++i)
+  {
+    AllocaInst *Var = Captures[i].second;
+    Builder->CreateStore(
+        Builder->CreateLoad(Var->getAllocatedType(), Var, Captures[i].first),
+        Builder->CreateStructGEP(EnvTy, Env, i + 2));
+  }
+
+  // void body(ptr Env, i64 Begin, i64 End, ptr Partials)
+  Function *BodyF = Function::Create(
+      FunctionType::get(Type::getVoidTy(C), {PtrTy, IdxTy, IdxTy, PtrTy}, false),
+      Function::InternalLinkage, TheFunction->getName() + ".pamwe", TheModule.get());
+  BodyF->addFnAttr(Attribute::NoUnwind);
+  BodyF->addParamAttr(0, Attribute::NoAlias);
+  BodyF->addParamAttr(3, Attribute::NoAlias);
+  Value *EnvArg = BodyF->getArg(0), *BeginArg = BodyF->getArg(1),
+        *EndArg = BodyF->getArg(2), *PartialsArg = BodyF->getArg(3);
+
+  auto SavedIP = Builder->saveIP();
+  auto SavedValues = std::move(NamedValues);
+  auto SavedProven = std::move(ProvenIndexes);
+  NamedValues.clear();
+  ProvenIndexes.clear();
+
+  Builder->SetInsertPoint(BasicBlock::Create(C, "entry", BodyF));
+  for (unsigned i = 0, e = Captures.size(); i != e; ++i)
+  {
+    AllocaInst *OuterVar = Captures[i].second;
+    AllocaInst *Var = CreateEntryBlockAlloca(BodyF, Captures[i].first,
+                                             OuterVar->getAllocatedType());
+    if (MDNode *Class = OuterVar->getMetadata("tino.class"))
+      Var->setMetadata("tino.class", Class);
+    Builder->CreateStore(
+        Builder->CreateLoad(Var->getAllocatedType(),
+                            Builder->CreateStructGEP(EnvTy, EnvArg, i + 2),
+                            Captures[i].first),
+        Var);
+    NamedValues[Captures[i].first] = Var;
+  }
+  std::vector<AllocaInst *> Partials;
+  for (unsigned r = 0, e = Reductions.size(); r != e; ++r)
+  {
+    AllocaInst *Var = CreateEntryBlockAlloca(BodyF, Reductions[r].Var);
+    Builder->CreateStore(
+        Builder->CreateLoad(DoubleTy, Builder->CreateConstGEP1_64(DoubleTy, PartialsArg, r),
+                            Reductions[r].Var),
+        Var);
+    NamedValues[Reductions[r].Var] = Var;
+    Partials.push_back(Var);
+  }
+
+  AllocaInst *LoopVar = CreateEntryBlockAlloca(BodyF, VarName);
+  AllocaInst *K = CreateEntryBlockAlloca(BodyF, "k", IdxTy);
+  NamedValues[VarName] = LoopVar;
+  Value *StartV = Builder->CreateLoad(DoubleTy, Builder->CreateStructGEP(EnvTy, EnvArg, 0),
+                                      "start");
+  Value *StepV = Builder->CreateLoad(DoubleTy, Builder->CreateStructGEP(EnvTy, EnvArg, 1),
+                                     "step");
+  Builder->CreateStore(BeginArg, K);
+
+  // Every index the range visits lies between its first and its last.
+  Value *StartIdx = nullptr, *StepIdx = nullptr;
+  AllocaInst *Counter = nullptr;
+  if (ArrayLoop)
+  {
+    AllocaInst *ArrayVar = NamedValues[ArrayName];
+    Value *Arr = Builder->CreateLoad(ArrayVar->getAllocatedType(), ArrayVar, ArrayName);
+    Value *LengthVal = LoadArrayParts(Arr).second;
+    StartIdx = Builder->CreateFPToSI(StartV, IdxTy, "startidx");
+    StepIdx = ConstantInt::get(
+        IdxTy, Step ? int64_t(static_cast<NumberExprAST *>(Step.get())->getVal()) : 1);
+    Value *LastIdx = Builder->CreateNSWAdd(
+        StartIdx,
+        Builder->CreateNSWMul(Builder->CreateSub(EndArg, ConstantInt::get(IdxTy, 1)), StepIdx),
+        "lastidx");
+    Counter = CreateEntryBlockAlloca(BodyF, VarName + ".idx", IdxTy);
+    ProvenIndexes.push_back(
+        {LoopVar, ArrayVar, Counter, Builder->CreateICmpSLT(LastIdx, LengthVal, "inbounds")});
+  }
+
+  BasicBlock *CondBB = BasicBlock::Create(C, "pamwe.cond", BodyF);
+  BasicBlock *LoopBB = BasicBlock::Create(C, "pamwe.loop", BodyF);
+  BasicBlock *AfterBB = BasicBlock::Create(C, "pamwe.after", BodyF);
+  Builder->CreateBr(CondBB);
+  Builder->SetInsertPoint(CondBB);
+  Value *KVal = Builder->CreateLoad(IdxTy, K, "k");
+  Builder->CreateCondBr(Builder->CreateICmpSLT(KVal, EndArg, "pamwecond"), LoopBB, AfterBB);
+
+  Builder->SetInsertPoint(LoopBB);
+  if (ArrayLoop)
+  {
+    Value *Idx = Builder->CreateNSWAdd(StartIdx, Builder->CreateNSWMul(KVal, StepIdx), "idx");
+    Builder->CreateStore(Idx, Counter);
+    Builder->CreateStore(Builder->CreateSIToFP(Idx, DoubleTy, VarName), LoopVar);
+  }
+  else
+    Builder->CreateStore(
+        Builder->CreateFAdd(StartV,
+                            Builder->CreateFMul(Builder->CreateSIToFP(KVal, DoubleTy), StepV),
+                            VarName),
+        LoopVar);
+
+  bool Failed = false;
+  {
+    LocalScope Scope;
+    ++ParallelBodyDepth;
+    for (auto &Stmt : Stmts)
+      if (!Stmt->codegen())
+      {
+        Failed = true;
+        break;
+      }
+    --ParallelBodyDepth;
+  }
+  if (!Failed)
+  {
+    Builder->CreateStore(Builder->CreateNSWAdd(KVal, ConstantInt::get(IdxTy, 1), "nextk"), K);
+    Builder->CreateBr(CondBB);
+
+    Builder->SetInsertPoint(AfterBB);
+    for (unsigned r = 0, e = Partials.size(); r != e; ++r)
+      Builder->CreateStore(Builder->CreateLoad(DoubleTy, Partials[r], Reductions[r].Var),
+                           Builder->CreateConstGEP1_64(DoubleTy, PartialsArg, r));
+    Builder->CreateRetVoid();
+    verifyFunction(*BodyF);
+  }
+
+  NamedValues = std::move(SavedValues);
+  ProvenIndexes = std::move(SavedProven);
+  Builder->restoreIP(SavedIP);
+  if (Failed)
+  {
+    BodyF->eraseFromParent();
+    return nullptr;
+  }
+
+  // A loop parallelized automatically runs on the pool only when it is long
+  // enough, and counts i exactly as the serial loop would: from a whole
+  // Start, and with no array it writes also read under another name. So
+  // that no iteration can end the script while others still hold their
+  // output, its objects and arrays must be there, and every index it uses
+  // inside its array (see ParallelPlan). Otherwise it runs all its
+  // iterations on this thread, in order, as the serial loop would.
+  Value *MinIterations = ConstantInt::get(IdxTy, 1);
+  if (Auto)
+  {
+    BasicBlock *SerialBB = BasicBlock::Create(C, "pamwe.serial", TheFunction);
+    BasicBlock *RunBB = BasicBlock::Create(C, "pamwe.run", TheFunction);
+
+    // Nothing is loaded from an object or array until it is known to be there.
+    std::map<std::string, Value *> Values;
+    for (const std::string &Name : Auto->Present)
+    {
+      Value *V = Name == "this" ? ThisExprAST().codegen() : VariableExprAST(Name).codegen();
+      if (!V)
+        return nullptr;
+      Values[Name] = V;
+      BasicBlock *ThereBB = BasicBlock::Create(C, "pamwe.there", TheFunction, SerialBB);
+      Builder->CreateCondBr(Builder->CreateIsNotNull(V, Name + ".there"), ThereBB, SerialBB);
+      Builder->SetInsertPoint(ThereBB);
+    }
+
+    Value *Safe = Builder->CreateFCmpOEQ(
+        Builder->CreateUnaryIntrinsic(Intrinsic::floor, StartVal), StartVal, "wholestart");
+    for (auto &Pair : Auto->Disjoint)
+    {
+      Value *A = LoadArrayParts(Values[Pair.first]).first;
+      Value *B = LoadArrayParts(Values[Pair.second]).first;
+      Safe = Builder->CreateAnd(Safe, Builder->CreateICmpNE(A, B), "disjoint");
+    }
+
+    // i runs from Start to Last = Start + (Count - 1) * Step, where Count is
+    // worked out as tino_parallel_for does; i + n stays inside a if both ends
+    // do.
+    Value *Count = Builder->CreateMaxNum(
+        ConstantFP::get(DoubleTy, 1.0),
+        Builder->CreateUnaryIntrinsic(
+            Intrinsic::ceil,
+            Builder->CreateFDiv(Builder->CreateFSub(EndVal, StartVal), StepVal)),
+        "count");
+    Value *Last = Builder->CreateFAdd(
+        StartVal,
+        Builder->CreateFMul(Builder->CreateFSub(Count, ConstantFP::get(DoubleTy, 1.0)),
+                            StepVal),
+        "last");
+    auto LengthOf = [&](const std::string &Name) {
+      return Builder->CreateSIToFP(LoadArrayParts(Values[Name]).second, DoubleTy,
+                                   Name + ".length");
+    };
+    for (auto &Own : Auto->OwnIndexes)
+    {
+      Value *Offset = ConstantFP::get(DoubleTy, Own.second);
+      Safe = Builder->CreateAnd(
+          Safe,
+          Builder->CreateAnd(
+              Builder->CreateFCmpOGE(Builder->CreateFAdd(StartVal, Offset),
+                                     ConstantFP::get(DoubleTy, 0.0)),
+              Builder->CreateFCmpOLT(Builder->CreateFAdd(Last, Offset), LengthOf(Own.first))),
+          "inbounds");
+    }
+    for (auto &Inner : Auto->InnerStarts)
+      Safe = Builder->CreateAnd(
+          Safe,
+          Builder->CreateFCmpOLT(ConstantFP::get(DoubleTy, Inner.second),
+                                 LengthOf(Inner.first)),
+          "inbounds");
+    BasicBlock *SafeBB = Builder->GetInsertBlock();
+    Builder->CreateCondBr(Safe, RunBB, SerialBB);
+
+    Builder->SetInsertPoint(SerialBB);
+    Builder->CreateBr(RunBB);
+
+    Builder->SetInsertPoint(RunBB);
+    PHINode *Min = Builder->CreatePHI(IdxTy, 2, "miniters");
+    Min->addIncoming(ConstantInt::get(IdxTy, Auto->MinIterations), SafeBB);
+    Min->addIncoming(ConstantInt::get(IdxTy, INT64_MAX), SerialBB);
+    MinIterations = Min;
+  }
+
+  // tino_parallel_for(body, env, start, end, step, min, n, ops, results)
+  Value *Ops = ConstantPointerNull::get(PtrTy);
+  Value *Results = ConstantPointerNull::get(PtrTy);
+  if (!Reductions.empty())
+  {
+    std::vector<uint64_t> Kinds;
+    for (const LoopReduction &R : Reductions)
+      Kinds.push_back(R.Op);
+    Ops = new GlobalVariable(*TheModule, ArrayType::get(IdxTy, Kinds.size()), true,
+                             GlobalValue::PrivateLinkage,
+                             ConstantDataArray::get(C, ArrayRef<uint64_t>(Kinds)),
+                             "pamwe.ops");
+    Results = CreateEntryBlockAlloca(TheFunction, "pamwe.results",
+                                     ArrayType::get(DoubleTy, Reductions.size()));
+  }
+  FunctionCallee ParallelFor = TheModule->getOrInsertFunction(
+      "tino_parallel_for", Type::getVoidTy(C), PtrTy, PtrTy, DoubleTy, DoubleTy, DoubleTy,
+      IdxTy, IdxTy, PtrTy, PtrTy);
+  Builder->CreateCall(ParallelFor,
+                      {BodyF, Env, StartVal, EndVal, StepVal, MinIterations,
+                       ConstantInt::get(IdxTy, Reductions.size()), Ops, Results});
+
+  for (unsigned r = 0, e = Reductions.size(); r != e; ++r)
+  {
+    Value *Old = Builder->CreateLoad(DoubleTy, Outer[r], Reductions[r].Var);
+    Value *New = Builder->CreateLoad(
+        DoubleTy, Builder->CreateConstGEP1_64(DoubleTy, Results, r), "reduced");
+    switch (Reductions[r].Op)
+    {
+    case LoopReduction::Add:
+      New = Builder->CreateFAdd(Old, New, "addtmp");
+      break;
+    case LoopReduction::Mul:
+      New = Builder->CreateFMul(Old, New, "multmp");
+      break;
+    case LoopReduction::Min:
+      New = Builder->CreateSelect(Builder->CreateFCmpOLT(New, Old), New, Old, "mintmp");
+      break;
+    case LoopReduction::Max:
+      New = Builder->CreateSelect(Builder->CreateFCmpOGT(New, Old), New, Old, "maxtmp");
+      break;
+    }
+    Builder->CreateStore(New, Outer[r]);
+  }
+  return ConstantFP::get(C, APFloat(0.0));
+}
+
+Value* VariableExprAST::codegen() {
+  
+  // First check local variables, which shadow globals of the same name
+  auto Local = NamedValues.find(Name);
+  if (Local != NamedValues.end() && Local->second)
+    return Builder->CreateLoad(Local->second->getAllocatedType(), Local->second,
+                               Name.c_str());
+
+  // Then check global variables
+  std::lock_guard<std::mutex> lock(global_var_mutex);
+  if (!GlobalNamedValues.count(Name))
+    return LogErrorV(("'Zita' irir harina kuwanikwa: "+Name).c_str());
+
+  GlobalVariable* GV = GlobalNamedValues[Name];
+  if (!GV) {
+    return LogErrorV("'Zita' iri harina kuwanikwa");
+  }
+  return Builder->CreateLoad(GV->getValueType(), GV, Name.c_str());
+}
+Value *VarExprAST::codegen()
+{
+  std::vector<AllocaInst *> OldBindings;
+
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+
+  // Register all variables and emit their initializer.
+  for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
+  {
+    const std::string &VarName = VarNames[i].first;
+    ExprAST *Init = VarNames[i].second.get();
+
+    // Emit the initializer before adding the variable to scope, this prevents
+    // the initializer from referencing the variable itself, and permits stuff
+    // like this:
+    //  var a = 1 in
+    //    var a = a in ...   # refers to outer 'a'.
+    Value *InitVal;
+    if (Init)
+    {
+      InitVal = Init->codegen();
+      if (!InitVal)
+        return nullptr;
+    }
+    else
+    { // If not specified, use 0.0.
+      InitVal = ConstantFP::get(*TheContext, APFloat(0.0));
+    }
+
+    AllocaInst *Alloca =
+        CreateEntryBlockAlloca(TheFunction, VarName, InitVal->getType());
+    if (Init)
+      setVariableClass(Alloca, ClassOf(Init));
+    Builder->CreateStore(InitVal, Alloca);
+
+    // Remember the old variable binding so that we can restore the binding when
+    // we unrecurse.
+    auto Old = NamedValues.find(VarName);
+    OldBindings.push_back(Old == NamedValues.end() ? nullptr : Old->second);
+
+    // Remember this binding.
+    NamedValues[VarName] = Alloca;
+  }
+
+  // Without a body ('zita' inside a basa or block), the variables stay in
+  // scope until the enclosing LocalScope closes.
+  if (!Body)
+  {
+    for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
+      ScopeStack.back().emplace_back(VarNames[i].first, OldBindings[i]);
+    return ConstantFP::get(*TheContext, APFloat(0.0));
+  }
+
+  // Codegen the body, now that all vars are in scope.
+  Value *BodyVal = Body->codegen();
+  if (!BodyVal)
+    return nullptr;
+
+  // Pop all our variables from scope.
+  for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
+  {
+    if (OldBindings[i])
+      NamedValues[VarNames[i].first] = OldBindings[i];
+    else
+      NamedValues.erase(VarNames[i].first);
+  }
+
+  // Return the body computation.
+  return BodyVal;
+}
+
+
+std::string LLVMTypeToString(llvm::Type* type) {
+  std::string str;
+  llvm::raw_string_ostream rso(str);
+  type->print(rso);
+  return rso.str();
+}
+
+std::string LLVMValueToString(llvm::Value* val) {
+  std::string str;
+  llvm::raw_string_ostream rso(str);
+  val->print(rso);
+  return rso.str();
+}
+ 
+void DumpGlobalVariables() {
+  DEBUG_LOG("=== GLOBAL VARIABLE DUMP (" << GlobalNamedValues.size() << ") ===");
+  for (const auto& [name, gv] : GlobalNamedValues) {
+    DEBUG_LOG("'" << name << "'");
+    DEBUG_LOG("  Address: " << (void*)gv);
+    if (!gv) {
+      DEBUG_LOG("  WARNING: NULL GLOBAL VARIABLE!");
+      continue;
+    }
+    DEBUG_LOG("  Type: " + LLVMTypeToString(gv->getValueType()));
+    DEBUG_LOG("  Initializer: " << (void*)gv->getInitializer());
+    if (gv->hasInitializer()) {
+      DEBUG_LOG("  Init Value: " + LLVMValueToString(gv->getInitializer()));
+    }
+    DEBUG_LOG("  IsConstant: " << gv->isConstant());
+    DEBUG_LOG("  Linkage: " << gv->getLinkage());
+  }
+  DEBUG_LOG("=== END DUMP ===");
+}
+Value* GlobalVarExprAST::codegen() {
+  
+  for (auto& [Name, Init] : VarNames) {
+    
+    if (TheModule->getNamedGlobal(Name)) {
+
+      return LogErrorV(("'Zita iri riripo nechekare"+ Name).c_str());
+    }
+    if (GlobalNamedValues.count(Name)) {
+        
+      return LogErrorV(("'Zita' iri harina kuwanikwa " + Name).c_str());
+    }
+
+    Value* InitVal = nullptr;
+    if (Init) {
+      InitVal = Init->codegen();
+      if (!InitVal) {
+        return nullptr;
+      }
+    } else {
+      InitVal = ConstantFP::get(*TheContext, APFloat(0.0));
+    }
+
+    auto* ConstInit = dyn_cast<Constant>(InitVal);
+    if (!ConstInit) {
+
+      return LogErrorV(("Initializer for " + Name + " must be constant").c_str());
+    }
+
+    // With the whole program in view, a global nobody writes is a constant
+    // and nothing outside the module can see any of them.
+    bool IsConstant = ReadOnlyGlobals.count(Name) != 0;
+    auto* GV = new GlobalVariable(
+      *TheModule,
+      InitVal->getType(),
+      IsConstant,
+      CompileOptions.WholeProgram ? GlobalValue::InternalLinkage
+                                  : GlobalValue::ExternalLinkage,
+      ConstInit,
+      Name
+    );
+    if (Init)
+      setVariableClass(GV, ClassOf(Init.get()));
+
+    GlobalNamedValues[Name] = GV;
+  }
+
+ 
+  return Constant::getNullValue(Type::getDoubleTy(*TheContext));
+}
+
+Function* FunctionAST::codegen(const std::string& FuncNameOverride) {
+  std::string FuncName = FuncNameOverride.empty() ? getName() : FuncNameOverride;
+
+  // Fill in a declaration made ahead of time (see RunWholeProgram), otherwise
+  // declare the function from its prototype under the resolved name
+  Function *TheFunction = TheModule->getFunction(FuncName);
+  if (!TheFunction || !TheFunction->isDeclaration() ||
+      TheFunction->arg_size() != Proto->getArgs().size())
+    TheFunction = Proto->codegen(FuncName);
+
+  // Create a new basic block to start insertion into
+  BasicBlock *BB = BasicBlock::Create(*TheContext, "entry", TheFunction);
+  Builder->SetInsertPoint(BB);
+
+  // Locals from a previous function are not visible in this one
+  NamedValues.clear();
+  LocalScope Scope;
+
+  // Give every argument a stack slot so the body can assign to it; mem2reg
+  // turns them straight back into registers.
+  for (auto &Arg : TheFunction->args())
+  {
+    AllocaInst *Alloca =
+        CreateEntryBlockAlloca(TheFunction, Arg.getName(), Arg.getType());
+    setVariableClass(Alloca, Proto->getArgClass(Arg.getArgNo()));
+    Builder->CreateStore(&Arg, Alloca);
+    NamedValues[std::string(Arg.getName())] = Alloca;
+  }
+
+  // Generate the body
+  for (auto &Expr : Body) {
+    if (!Expr->codegen()) {
+      TheFunction->eraseFromParent(); // cleanup
+      return nullptr;
+    }
+  }
+
+  // Return 0.0 by default if the body has no return (optional)
+  if (!Builder->GetInsertBlock()->getTerminator())
+    Builder->CreateRet(ConstantFP::get(*TheContext, APFloat(0.0)));
+
+  // Verify the function
+  verifyFunction(*TheFunction);
+
+  if (!CompileOptions.ProfileGenerateFile.empty())
+    InstrumentFunction(*TheFunction);
+  else if (HasProfileData())
+    AttachProfileData(*TheFunction);
+
+  return TheFunction;
+}
+
+
+Value *ClassAST::codegen() {
+  if (!declare() || !codegenMethods())
+    return nullptr;
+  return Constant::getNullValue(Type::getInt32Ty(*TheContext));
+}
+
+/// OverrideMatches - Whether a method taking the (qualified) ArgClasses and
+/// returning ReturnClass can take Inherited's vtable slot: calls through
+/// the slot use Inherited's function type, so everything but the class of
+/// 'this' must be the same.
+static bool OverrideMatches(const PrototypeAST &Inherited,
+                            const std::vector<std::string> &ArgClasses,
+                            const std::string &ReturnClass)
+{
+  if (Inherited.getArgs().size() != ArgClasses.size() ||
+      Inherited.getReturnClass() != ReturnClass)
+    return false;
+  for (unsigned i = 1, e = ArgClasses.size(); i != e; ++i)
+    if (Inherited.getArgClass(i) != ArgClasses[i])
+      return false;
+  return true;
+}
+
+bool ClassAST::declare() {
+  if (ClassInfos.count(Name)) {
+    LogError(("Kirasi iyi iripo nechekare: " + Name).c_str());
+    return false;
+  }
+
+  // A subclass starts as a copy of its base: the same fields at the same
+  // offsets and the same vtable slots, so code compiled for the base works
+  // on it unchanged.
+  ClassInfo Info;
+  if (!Base.empty()) {
+    auto BaseIt = ClassInfos.find(Base);
+    if (BaseIt == ClassInfos.end()) {
+      LogError(("Kirasi iyi haizivikanwi: " + Base).c_str());
+      return false;
+    }
+    Info = BaseIt->second;
+    Info.Base = Base;
+    Info.Subclasses.clear();
+  }
+
+  // Instance layout: the vtable pointer, then one field per member in
+  // declaration order.
+  Type *PtrTy = PointerType::getUnqual(*TheContext);
+  for (auto &Member : Members) {
+    if (Info.fieldIndex(Member.first) >= 0) {
+      LogError(("Kirasi " + Name + " ine '" + Member.first + "' kaviri").c_str());
+      return false;
+    }
+    Info.Fields.push_back(Member.first);
+    Info.FieldClasses.push_back(Member.second ? ClassOf(Member.second.get()) : "");
+    if (VectorWidthOf(Info.FieldClasses.back())) {
+      LogError(("'" + Member.first + "' haigone kuva vector: kirasi dzinochengeta "
+                "manhamba nezvinhu chete").c_str());
+      return false;
+    }
+    if (isPrivate(Member.first))
+      Info.PrivateMembers[Member.first] = Name;
+  }
+  std::vector<Type *> FieldTypes = {PtrTy};
+  for (auto &FieldClass : Info.FieldClasses)
+    FieldTypes.push_back(FieldClass.empty() ? Type::getDoubleTy(*TheContext) : PtrTy);
+  Info.Type = StructType::create(*TheContext, FieldTypes, "class." + Name);
+
+  // Handle Members
+  std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> QualifiedMembers;
+
+  for (auto &Member : Members) {
+    std::string FullVarName = Name + "." + Member.first;
+    QualifiedMembers.emplace_back(FullVarName, std::move(Member.second));
+  }
+
+  auto GlobalVars = std::make_unique<GlobalVarExprAST>(std::move(QualifiedMembers));
+
+  if (!GlobalVars->codegen()) {
+    LogError(("'zita' iri ratadza kugadzirwa " + Name).c_str());
+    return false;
+  }
+
+  // A new instance starts out with the values the members were declared with.
+  for (auto &Member : Members) {
+    unsigned Idx = Info.fieldIndex(Member.first) + 1;
+    GlobalVariable *GV = GlobalNamedValues[Name + "." + Member.first];
+    Constant *Default = GV ? GV->getInitializer() : nullptr;
+    if (!Default || Default->getType() != FieldTypes[Idx])
+      Default = Constant::getNullValue(FieldTypes[Idx]);
+    Info.Defaults.push_back(Default);
+  }
+
+  // Every method takes the object it's called on as a hidden first argument,
+  // 'this'. Declare them all first so methods can call each other.
+  for (auto &Method : Methods) {
+    PrototypeAST* OriginalProto = Method->getProto();
+    std::string MethodName = OriginalProto->getName();
+    std::string FullName = Name + "." + MethodName;
+
+    std::vector<std::string> Args = {"this"};
+    std::vector<std::string> ArgClasses = {Name};
+    for (unsigned i = 0, e = OriginalProto->getArgs().size(); i != e; ++i) {
+      Args.push_back(OriginalProto->getArgs()[i]);
+      ArgClasses.push_back(OriginalProto->getArgClass(i));
+    }
+
+    // An override takes the slot of the method it replaces, and must be
+    // callable the same way.
+    int Slot = Info.methodSlot(MethodName);
+    if (Slot < 0) {
+      Info.Methods.push_back(MethodName);
+      Info.Impls.push_back(FullName);
+    } else {
+      if (!OverrideMatches(*FunctionProtos[Info.Impls[Slot]], ArgClasses,
+                           OriginalProto->getReturnClass())) {
+        LogError(("Basa '" + MethodName + "' rinofanira kutora ma argument "
+                  "akaenzana uye erudzi rumwe neaya ari mu " + Base).c_str());
+        return false;
+      }
+      Info.Impls[Slot] = FullName;
+    }
+    if (isPrivate(MethodName))
+      Info.PrivateMembers[MethodName] = Name;
+
+    auto NewProto = std::make_unique<PrototypeAST>(
+        FullName,
+        std::move(Args),
+        OriginalProto->isOperator(),
+        OriginalProto->getBinaryPrecedence()
+    );
+    NewProto->setArgClasses(std::move(ArgClasses));
+    NewProto->setReturnClass(OriginalProto->getReturnClass());
+    NewProto->setInternal();
+
+    FunctionProtos[FullName] = std::move(NewProto);
+  }
+
+  // The vtable: one entry per slot, pointing at the implementation this
+  // class uses. Nothing ever writes it, so loads from it fold once the
+  // object's class is known.
+  std::vector<Constant *> Entries;
+  for (auto &Impl : Info.Impls)
+    Entries.push_back(getFunction(Impl));
+  ArrayType *VTableTy = ArrayType::get(PtrTy, Entries.size());
+  new GlobalVariable(*TheModule, VTableTy, true,
+                     CompileOptions.WholeProgram ? GlobalValue::InternalLinkage
+                                                 : GlobalValue::ExternalLinkage,
+                     ConstantArray::get(VTableTy, Entries), Name + ".vtable");
+
+  ClassInfos[Name] = std::move(Info);
+  if (!Base.empty())
+    ClassInfos[Base].Subclasses.push_back(Name);
+  return true;
+}
+
+bool ClassAST::codegenMethods() {
+  for (auto &Method : Methods) {
+    std::string FullName = Name + "." + Method->getProto()->getName();
+
+    // Move method body
+    std::vector<std::unique_ptr<ExprAST>> Body;
+    for (auto &Expr : Method->getBody()) {
+      Body.push_back(std::move(Expr));
+    }
+
+    auto NewFunction = std::make_unique<FunctionAST>(
+        FunctionProtos[FullName]->clone(),
+        std::move(Body),
+        FullName
+    );
+
+    if (!NewFunction->codegen()) {
+      LogError(("Basa iri ratadza kugadzirwa" + FullName).c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+/// getObjectAllocator - Declare the runtime's allocator for 'new'. The
+/// attributes tell LLVM it returns fresh, zeroed memory of the requested
+/// size, so loads of untouched fields fold to zero and objects that are
+/// never used are not allocated at all.
+static Function *getObjectAllocator()
+{
+  if (Function *F = TheModule->getFunction("tino_object_alloc"))
+    return F;
+
+  LLVMContext &C = *TheContext;
+  FunctionType *FT = FunctionType::get(PointerType::getUnqual(C),
+                                       {Type::getInt64Ty(C)}, false);
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 "tino_object_alloc", TheModule.get());
+  F->addRetAttr(Attribute::NoAlias);
+  F->addRetAttr(Attribute::NonNull);
+  F->addRetAttr(Attribute::getWithAlignment(C, Align(16)));
+  F->addFnAttr(Attribute::getWithAllocSizeArgs(C, 0, std::nullopt));
+  F->addFnAttr(Attribute::get(
+      C, Attribute::AllocKind,
+      uint64_t(AllocFnKind::Alloc | AllocFnKind::Zeroed)));
+  F->addFnAttr("alloc-family", "tino_object");
+  F->setMemoryEffects(MemoryEffects::inaccessibleMemOnly());
+  F->setDoesNotThrow();
+  F->addFnAttr(Attribute::WillReturn);
+  return F;
+}
+
+/// CodegenMethodArgs - 'this' followed by the arguments, checked against the
+/// method's parameters.
+static bool CodegenMethodArgs(Function *Method, Value *This,
+                              const std::vector<std::unique_ptr<ExprAST>> &Args,
+                              std::vector<Value *> &ArgsV)
+{
+  if (Method->arg_size() != Args.size() + 1) {
+    LogError("Ma arguments aya haasiriwo anotarisirwa");
+    return false;
+  }
+
+  ArgsV.push_back(This);
+  for (auto &Arg : Args) {
+    Value *ArgV = Arg->codegen();
+    if (!ArgV)
+      return false;
+    ArgsV.push_back(ArgV);
+  }
+  return CheckArgTypes(Method, ArgsV) &&
+         CheckArgClasses(Method->getName().str(), Args, 1);
+}
+
+/// EmitMethodCall - Call a method directly with This and the given arguments.
+static Value *EmitMethodCall(Function *Method, Value *This,
+                             const std::vector<std::unique_ptr<ExprAST>> &Args)
+{
+  std::vector<Value *> ArgsV;
+  if (!CodegenMethodArgs(Method, This, Args, ArgsV))
+    return nullptr;
+
+  CallInst *Call = Builder->CreateCall(Method, ArgsV, "calltmp");
+  Call->setCallingConv(Method->getCallingConv());
+  return Call;
+}
+
+/// SingleImplementation - With the whole program in view, the method every
+/// object of Class or of any of its subclasses runs for Slot, if they all
+/// run the same one. Otherwise "".
+static std::string SingleImplementation(const std::string &Class, unsigned Slot)
+{
+  if (!CompileOptions.WholeProgram)
+    return "";
+
+  const ClassInfo &Info = ClassInfos[Class];
+  std::string Impl = Info.Impls[Slot];
+  for (auto &Subclass : Info.Subclasses)
+    if (SingleImplementation(Subclass, Slot) != Impl)
+      return "";
+  return Impl;
+}
+
+/// getNullObjectError - Declare the runtime's 'tino_null_object_error'. Like
+/// the bounds error it never returns, and the paths calling it are cold.
+static Function *getNullObjectError()
+{
+  if (Function *F = TheModule->getFunction("tino_null_object_error"))
+    return F;
+
+  LLVMContext &C = *TheContext;
+  Type *PtrTy = PointerType::getUnqual(C);
+  FunctionType *FT = FunctionType::get(Type::getVoidTy(C), {PtrTy, PtrTy}, false);
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 "tino_null_object_error", TheModule.get());
+  F->setDoesNotReturn();
+  F->setDoesNotThrow();
+  F->addFnAttr(Attribute::Cold);
+  return F;
+}
+
+/// EmitNullCheck - Continue only if Obj holds an object; otherwise report
+/// Member used on a missing Class and end the script. 'zita p: Point' with
+/// no value, and 'this' in a method called through the class name, are
+/// null. The check folds away wherever Obj is known to come from 'new'.
+static void EmitNullCheck(Value *Obj, const std::string &Class, const std::string &Member)
+{
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  BasicBlock *OkBB = BasicBlock::Create(*TheContext, "object.ok", TheFunction);
+  BasicBlock *FailBB = BasicBlock::Create(*TheContext, "object.null", TheFunction);
+  Builder->CreateCondBr(Builder->CreateIsNotNull(Obj), OkBB, FailBB,
+                        MDBuilder(*TheContext).createBranchWeights(1 << 20, 1));
+
+  Builder->SetInsertPoint(FailBB);
+  Builder->CreateCall(getNullObjectError(),
+                      {Builder->CreateGlobalStringPtr(Class, "class"),
+                       Builder->CreateGlobalStringPtr(Member, "member")});
+  Builder->CreateUnreachable();
+
+  Builder->SetInsertPoint(OkBB);
+}
+
+// The most methods a virtual call site checks for and calls directly.
+static const unsigned MaxInlineCacheTargets = 4;
+
+/// VirtualTargets - The methods objects of Class and of its subclasses run
+/// for Slot, each once, Class's own first.
+static void VirtualTargets(const std::string &Class, unsigned Slot,
+                           std::vector<std::string> &Targets)
+{
+  const ClassInfo &Info = ClassInfos[Class];
+  if (std::find(Targets.begin(), Targets.end(), Info.Impls[Slot]) == Targets.end())
+    Targets.push_back(Info.Impls[Slot]);
+  for (auto &Subclass : Info.Subclasses)
+    VirtualTargets(Subclass, Slot, Targets);
+}
+
+/// EmitVirtualCall - Call the method in Slot of This's vtable.
+///
+/// The call site is a polymorphic inline cache seeded from the class
+/// hierarchy: it compares the loaded entry with each method an object of
+/// the declared class or of a subclass known so far could run (up to
+/// MaxInlineCacheTargets of them) and calls the one that matches directly,
+/// where the inliner can open it up. Only an object of a class declared
+/// later pays for the indirect call. Every hit is a block of its own, so
+/// --profile-generate counts which receivers each site actually saw, and
+/// --profile-use weights the checks (and inlines) by those counts.
+static Value *EmitVirtualCall(const std::string &Class, unsigned Slot, Value *This,
+                              const std::vector<std::unique_ptr<ExprAST>> &Args)
+{
+  const ClassInfo &Info = ClassInfos[Class];
+  std::vector<std::string> Targets;
+  VirtualTargets(Class, Slot, Targets);
+  if (Targets.size() > MaxInlineCacheTargets)
+    Targets.resize(MaxInlineCacheTargets);
+
+  Function *Declared = getFunction(Targets[0]);
+  std::vector<Value *> ArgsV;
+  if (!CodegenMethodArgs(Declared, This, Args, ArgsV))
+    return nullptr;
+
+  EmitNullCheck(This, Class, Info.Methods[Slot]);
+  Type *PtrTy = PointerType::getUnqual(*TheContext);
+  Value *VTable = Builder->CreateLoad(PtrTy, This, "vtable");
+  Value *Entry = Builder->CreateLoad(
+      PtrTy, Builder->CreateConstInBoundsGEP1_64(PtrTy, VTable, Slot),
+      Info.Methods[Slot] + ".impl");
+
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  BasicBlock *MergeBB = BasicBlock::Create(*TheContext, "ic.cont", TheFunction);
+  std::vector<std::pair<Value *, BasicBlock *>> Results;
+  for (const std::string &Target : Targets)
+  {
+    Function *Expected = getFunction(Target);
+    BasicBlock *HitBB = BasicBlock::Create(*TheContext, "ic.hit", TheFunction);
+    BasicBlock *MissBB = BasicBlock::Create(*TheContext, "ic.miss", TheFunction);
+    Builder->CreateCondBr(Builder->CreateICmpEQ(Entry, Expected, "ic.check"),
+                          HitBB, MissBB);
+
+    Builder->SetInsertPoint(HitBB);
+    CallInst *Direct = Builder->CreateCall(Expected, ArgsV, "calltmp");
+    Direct->setCallingConv(Expected->getCallingConv());
+    Builder->CreateBr(MergeBB);
+    Results.emplace_back(Direct, HitBB);
+
+    Builder->SetInsertPoint(MissBB);
+  }
+
+  CallInst *Indirect =
+      Builder->CreateCall(Declared->getFunctionType(), Entry, ArgsV, "calltmp");
+  Indirect->setCallingConv(Declared->getCallingConv());
+  Builder->CreateBr(MergeBB);
+  Results.emplace_back(Indirect, Builder->GetInsertBlock());
+
+  Builder->SetInsertPoint(MergeBB);
+  PHINode *Result =
+      Builder->CreatePHI(Declared->getReturnType(), Results.size(), "calltmp");
+  for (auto &[V, BB] : Results)
+    Result->addIncoming(V, BB);
+  return Result;
+}
+
+/// CheckAccess - A private member or method may only be used by the methods
+/// of the class that declares it.
+static bool CheckAccess(const ClassInfo &Info, const std::string &Name)
+{
+  auto Private = Info.PrivateMembers.find(Name);
+  if (Private == Info.PrivateMembers.end() ||
+      ClassOfVariable("this") == Private->second)
+    return true;
+  LogError(("'" + Name + "' yakavanzika mukati mekirasi " + Private->second).c_str());
+  return false;
+}
+
+Value *NewExprAST::codegen()
+{
+  auto It = ClassInfos.find(ClassName);
+  if (It == ClassInfos.end())
+    return LogErrorV(("Kirasi iyi haizivikanwi: " + ClassName).c_str());
+  const ClassInfo &Info = It->second;
+
+  uint64_t Size = TheModule->getDataLayout().getTypeAllocSize(Info.Type);
+  Value *Obj = Builder->CreateCall(
+      getObjectAllocator(), ConstantInt::get(Type::getInt64Ty(*TheContext), Size),
+      ClassName);
+  Builder->CreateStore(TheModule->getNamedGlobal(ClassName + ".vtable"), Obj);
+
+  // The memory is already zeroed; only non-zero defaults need a store.
+  for (unsigned i = 0, e = Info.Defaults.size(); i != e; ++i)
+    if (!Info.Defaults[i]->isNullValue())
+      Builder->CreateStore(Info.Defaults[i],
+                           Builder->CreateStructGEP(Info.Type, Obj, i + 1));
+
+  // The object's class is known here, so 'gadzira' is called directly.
+  int Ctor = Info.methodSlot("gadzira");
+  if (Ctor < 0) {
+    if (!Args.empty())
+      return LogErrorV(("Kirasi " + ClassName +
+                        " haina 'gadzira' inogamuchira ma argument").c_str());
+    return Obj;
+  }
+  if (!CheckAccess(Info, "gadzira") ||
+      !EmitMethodCall(getFunction(Info.Impls[Ctor]), Obj, Args))
+    return nullptr;
+  return Obj;
+}
+
+Value *ThisExprAST::codegen()
+{
+  auto It = NamedValues.find("this");
+  if (It == NamedValues.end() || !It->second)
+    return LogErrorV("'this' inoshandiswa mukati mebasa rekirasi chete");
+  return Builder->CreateLoad(It->second->getAllocatedType(), It->second, "this");
+}
+
+Value *NullObjectExprAST::codegen()
+{
+  // A vector declared without a value is all zeros.
+  if (VectorWidthOf(ClassName))
+    return Constant::getNullValue(TypeOfClass(ClassName));
+  return ConstantPointerNull::get(PointerType::getUnqual(*TheContext));
+}
+
+Value *MemberExprAST::codegenAddress(Type *&FieldTy)
+{
+  std::string Class = ClassOf(Object.get());
+  auto It = ClassInfos.find(Class);
+  if (It == ClassInfos.end())
+    return LogErrorV(("'" + Field + "' inoda chinhu chekirasi kuruboshwe kwe '.'").c_str());
+  const ClassInfo &Info = It->second;
+
+  int Idx = Info.fieldIndex(Field);
+  if (Idx < 0)
+    return LogErrorV(("Kirasi " + Class + " haina '" + Field + "'").c_str());
+  if (!CheckAccess(Info, Field))
+    return nullptr;
+
+  // 'a[i].x' in a collection of records is element i of a's column for x.
+  // Like the header, the column table never changes.
+  auto *Record = dynamic_cast<IndexExprAST *>(Object.get());
+  if (Record && !RecordClassOf(ClassOf(Record->getArray())).empty())
+  {
+    Value *Columns = nullptr;
+    Value *I = Record->codegenIndex(Columns);
+    if (!I)
+      return nullptr;
+    LLVMContext &C = *TheContext;
+    Type *PtrTy = PointerType::getUnqual(C);
+    LoadInst *Column = Builder->CreateLoad(
+        PtrTy, Builder->CreateConstInBoundsGEP1_64(PtrTy, Columns, Idx), Field + ".column");
+    Column->setMetadata(LLVMContext::MD_invariant_load, MDNode::get(C, {}));
+    Column->setMetadata(LLVMContext::MD_nonnull, MDNode::get(C, {}));
+    Column->setMetadata(LLVMContext::MD_align,
+                        MDNode::get(C, ConstantAsMetadata::get(
+                                           ConstantInt::get(Type::getInt64Ty(C), 64))));
+    FieldTy = Info.FieldClasses[Idx].empty() ? Type::getDoubleTy(C) : PtrTy;
+    return Builder->CreateInBoundsGEP(FieldTy, Column, I, Field);
+  }
+
+  Value *Obj = Object->codegen();
+  if (!Obj)
+    return nullptr;
+  EmitNullCheck(Obj, Class, Field);
+  FieldTy = Info.Type->getElementType(Idx + 1);
+  return Builder->CreateStructGEP(Info.Type, Obj, Idx + 1, Field);
+}
+
+Value *MemberExprAST::codegen()
+{
+  Type *FieldTy = nullptr;
+  Value *Addr = codegenAddress(FieldTy);
+  if (!Addr)
+    return nullptr;
+  return Builder->CreateLoad(FieldTy, Addr, Field);
+}
 
-    // Remember the old variable binding so that we can restore the binding when
-    // we unrecurse.
-    OldBindings.push_back(NamedValues[VarName]);
+Value *MethodCallExprAST::codegen()
+{
+  std::string Class = Object ? ClassOf(Object.get()) : ClassName;
+  auto It = ClassInfos.find(Class);
+  if (It == ClassInfos.end())
+    return LogErrorV(("'" + Method + "' inoda chinhu chekirasi kuruboshwe kwe '.'").c_str());
+  const ClassInfo &Info = It->second;
+
+  int Slot = Info.methodSlot(Method);
+  if (Slot < 0)
+    return LogErrorV(("Kirasi " + Class + " haina basa '" + Method + "'").c_str());
+  if (!CheckAccess(Info, Method))
+    return nullptr;
 
-    // Remember this binding.
-    NamedValues[VarName] = Alloca;
-  }
+  // Called through the class name there is no object; 'this' is null and
+  // the class's own implementation runs, ending the script (see
+  // EmitNullCheck) if it touches a field or a virtual method of 'this'.
+  if (!Object)
+    return EmitMethodCall(getFunction(Info.Impls[Slot]),
+                          ConstantPointerNull::get(PointerType::getUnqual(*TheContext)),
+                          Args);
 
-  // Codegen the body, now that all vars are in scope.
-  Value *BodyVal = Body->codegen();
-  if (!BodyVal)
+  Value *This = Object->codegen();
+  if (!This)
     return nullptr;
 
-  // Pop all our variables from scope.
-  for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
-    NamedValues[VarNames[i].first] = OldBindings[i];
-
-  // Return the body computation.
-  return BodyVal;
+  // Class hierarchy analysis: no subclass overrides the method, so there is
+  // only one thing the call can do.
+  std::string Impl = SingleImplementation(Class, Slot);
+  if (!Impl.empty())
+    return EmitMethodCall(getFunction(Impl), This, Args);
+  return EmitVirtualCall(Class, Slot, This, Args);
 }
 
+/// getArrayAllocator - Declare the runtime's 'tino_array_new'.
+static Function *getArrayAllocator()
+{
+  if (Function *F = TheModule->getFunction("tino_array_new"))
+    return F;
 
-std::string LLVMTypeToString(llvm::Type* type) {
-  std::string str;
-  llvm::raw_string_ostream rso(str);
-  type->print(rso);
-  return rso.str();
+  LLVMContext &C = *TheContext;
+  FunctionType *FT = FunctionType::get(PointerType::getUnqual(C),
+                                       {Type::getInt64Ty(C)}, false);
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 "tino_array_new", TheModule.get());
+  F->addRetAttr(Attribute::NoAlias);
+  F->addRetAttr(Attribute::NonNull);
+  F->addRetAttr(Attribute::getWithAlignment(C, Align(64)));
+  F->setDoesNotThrow();
+  F->addFnAttr(Attribute::WillReturn);
+  return F;
 }
 
-std::string LLVMValueToString(llvm::Value* val) {
-  std::string str;
-  llvm::raw_string_ostream rso(str);
-  val->print(rso);
-  return rso.str();
-}
- 
-void DumpGlobalVariables() {
-  DEBUG_LOG("=== GLOBAL VARIABLE DUMP (" << GlobalNamedValues.size() << ") ===");
-  for (const auto& [name, gv] : GlobalNamedValues) {
-    DEBUG_LOG("'" << name << "'");
-    DEBUG_LOG("  Address: " << (void*)gv);
-    if (!gv) {
-      DEBUG_LOG("  WARNING: NULL GLOBAL VARIABLE!");
-      continue;
-    }
-    DEBUG_LOG("  Type: " + LLVMTypeToString(gv->getValueType()));
-    DEBUG_LOG("  Initializer: " << (void*)gv->getInitializer());
-    if (gv->hasInitializer()) {
-      DEBUG_LOG("  Init Value: " + LLVMValueToString(gv->getInitializer()));
-    }
-    DEBUG_LOG("  IsConstant: " << gv->isConstant());
-    DEBUG_LOG("  Linkage: " << gv->getLinkage());
-  }
-  DEBUG_LOG("=== END DUMP ===");
+/// getBoundsError - Declare the runtime's 'tino_array_bounds_error'. It
+/// never returns, and the paths that call it are marked cold.
+static Function *getBoundsError()
+{
+  if (Function *F = TheModule->getFunction("tino_array_bounds_error"))
+    return F;
+
+  LLVMContext &C = *TheContext;
+  FunctionType *FT = FunctionType::get(
+      Type::getVoidTy(C), {Type::getInt64Ty(C), Type::getInt64Ty(C)}, false);
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 "tino_array_bounds_error", TheModule.get());
+  F->setDoesNotReturn();
+  F->setDoesNotThrow();
+  F->addFnAttr(Attribute::Cold);
+  return F;
 }
-Value* GlobalVarExprAST::codegen() {
-  
-  for (auto& [Name, Init] : VarNames) {
-    
-    if (TheModule->getNamedGlobal(Name)) {
 
-      return LogErrorV(("'Zita iri riripo nechekare"+ Name).c_str());
-    }
-    if (GlobalNamedValues.count(Name)) {
-        
-      return LogErrorV(("'Zita' iri harina kuwanikwa " + Name).c_str());
-    }
+/// NewArray - Allocate an array of Length (an i64) zeroed elements.
+static Value *NewArray(Value *Length, const Twine &Name)
+{
+  return Builder->CreateCall(getArrayAllocator(), Length, Name);
+}
 
-    Value* InitVal = nullptr;
-    if (Init) {
-      InitVal = Init->codegen();
-      if (!InitVal) {
-        return nullptr;
-      }
-    } else {
-      InitVal = ConstantFP::get(*TheContext, APFloat(0.0));
-    }
+Value *ArrayExprAST::codegen()
+{
+  std::vector<Value *> Values;
+  for (auto &Element : Elements)
+  {
+    Value *V = Element->codegen();
+    if (!V)
+      return nullptr;
+    if (!V->getType()->isDoubleTy())
+      return LogErrorV("Array inogona kuchengeta manhamba chete");
+    Values.push_back(V);
+  }
 
-    auto* ConstInit = dyn_cast<Constant>(InitVal);
-    if (!ConstInit) {
+  Type *DoubleTy = Type::getDoubleTy(*TheContext);
+  Value *Arr = NewArray(
+      ConstantInt::get(Type::getInt64Ty(*TheContext), Values.size()), "array");
+  Value *Data = LoadArrayParts(Arr).first;
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    Builder->CreateStore(Values[i], Builder->CreateConstInBoundsGEP1_64(DoubleTy, Data, i));
+  return Arr;
+}
 
-      return LogErrorV(("Initializer for " + Name + " must be constant").c_str());
+/// NewRecords - Allocate a collection of Length (an i64) records of a
+/// class, each member starting at the value it was declared with.
+static Value *NewRecords(const std::string &Class, Value *Length)
+{
+  LLVMContext &C = *TheContext;
+  Type *PtrTy = PointerType::getUnqual(C);
+  Type *IdxTy = Type::getInt64Ty(C);
+  const ClassInfo &Info = ClassInfos[Class];
+
+  // The runtime fills each column with its default; all zeros (the usual
+  // case) needs no table at all.
+  Constant *Defaults = ConstantPointerNull::get(cast<PointerType>(PtrTy));
+  bool AllZero = std::all_of(Info.Defaults.begin(), Info.Defaults.end(),
+                             [](Constant *D) { return D->isNullValue(); });
+  if (!AllZero)
+  {
+    std::string Name = Class + ".defaults";
+    Defaults = TheModule->getNamedGlobal(Name);
+    if (!Defaults)
+    {
+      std::vector<double> Values;
+      for (Constant *D : Info.Defaults)
+        Values.push_back(isa<ConstantFP>(D)
+                             ? cast<ConstantFP>(D)->getValueAPF().convertToDouble()
+                             : 0.0);
+      Constant *Init = ConstantDataArray::get(C, Values);
+      Defaults = new GlobalVariable(*TheModule, Init->getType(), true,
+                                    GlobalValue::PrivateLinkage, Init, Name);
     }
+  }
 
-    auto* GV = new GlobalVariable(
-      *TheModule,
-      InitVal->getType(),
-      false,
-      GlobalValue::ExternalLinkage,
-      ConstInit,
-      Name
-    );
-
-    GlobalNamedValues[Name] = GV;
+  FunctionCallee New = TheModule->getOrInsertFunction(
+      "tino_records_new", PtrTy, IdxTy, IdxTy, PtrTy);
+  if (auto *F = dyn_cast<Function>(New.getCallee()))
+  {
+    F->addRetAttr(Attribute::NoAlias);
+    F->addRetAttr(Attribute::NonNull);
+    F->addRetAttr(Attribute::getWithAlignment(C, Align(64)));
+    F->setDoesNotThrow();
+    F->addFnAttr(Attribute::WillReturn);
   }
+  return Builder->CreateCall(
+      New, {ConstantInt::get(IdxTy, Info.Fields.size()), Length, Defaults}, Class);
+}
 
- 
-  return Constant::getNullValue(Type::getDoubleTy(*TheContext));
+Value *NewArrayExprAST::codegen()
+{
+  std::string Record = RecordClassOf(ArrayType);
+  if (!IsArrayClass(ArrayType) && Record.empty())
+    return LogErrorV(("Kirasi iyi haizivikanwi: " + ArrayType).c_str());
+
+  Value *LengthV = Length->codegen();
+  if (!LengthV)
+    return nullptr;
+  if (!LengthV->getType()->isDoubleTy())
+    return LogErrorV("Urefu hwe array hunofanira kuva namba");
+  // fptosi is poison for NaN and for lengths past int64, so clamp first, the
+  // way the matrix builtins read a size: NaN and negatives are 0 (maxnum
+  // takes the number over a NaN) and anything huge is 2^62, which the
+  // runtime then refuses to allocate.
+  Type *DoubleTy = Type::getDoubleTy(*TheContext);
+  LengthV = Builder->CreateMinNum(
+      Builder->CreateMaxNum(LengthV, ConstantFP::get(DoubleTy, 0.0)),
+      ConstantFP::get(DoubleTy, 0x1p62), "length");
+  Value *N = Builder->CreateFPToSI(LengthV, Type::getInt64Ty(*TheContext));
+  if (!Record.empty())
+    return NewRecords(Record, N);
+  return NewArray(N, "array");
 }
 
-Function* FunctionAST::codegen(const std::string& FuncNameOverride) {
-  std::string FuncName = FuncNameOverride.empty() ? getName() : FuncNameOverride;
+/// EmitBoundsCheck - Continue only if InBounds holds; otherwise report Idx
+/// as outside an array of Length elements and end the script.
+static void EmitBoundsCheck(Value *InBounds, Value *Idx, Value *Length)
+{
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  BasicBlock *OkBB = BasicBlock::Create(*TheContext, "index.ok", TheFunction);
+  BasicBlock *FailBB = BasicBlock::Create(*TheContext, "index.fail", TheFunction);
+  Builder->CreateCondBr(InBounds, OkBB, FailBB,
+                        MDBuilder(*TheContext).createBranchWeights(1 << 20, 1));
 
-  // Get the function type from the prototype (or build it)
-  FunctionType *FT = FunctionType::get(Type::getDoubleTy(*TheContext), false);
+  Builder->SetInsertPoint(FailBB);
+  Builder->CreateCall(getBoundsError(), {Idx, Length});
+  Builder->CreateUnreachable();
 
-  // Create the function with the resolved name
+  Builder->SetInsertPoint(OkBB);
+}
 
-  Function *TheFunction = Function::Create(
-      FT,
-      Function::ExternalLinkage,
-      FuncName,
-      TheModule.get()
-  );
+Value *IndexExprAST::codegenIndex(Value *&Data)
+{
+  std::string Class = ClassOf(Array.get());
+  if (!IsCollectionClass(Class))
+    return LogErrorV("'[ ]' inoda array kuruboshwe kwayo");
+
+  // Inside a loop over the array's indexes (see ProvenIndex), 'a[i]' needs
+  // neither the conversion of i nor a per-iteration comparison.
+  const ProvenIndex *Proven = nullptr;
+  auto *ArrayVar = dynamic_cast<VariableExprAST *>(Array.get());
+  auto *IndexVar = dynamic_cast<VariableExprAST *>(Index.get());
+  if (ArrayVar && IndexVar && NamedValues.count(ArrayVar->getName()) &&
+      NamedValues.count(IndexVar->getName()))
+    for (auto It = ProvenIndexes.rbegin(); It != ProvenIndexes.rend(); ++It)
+      if (It->Array == NamedValues[ArrayVar->getName()] &&
+          It->Var == NamedValues[IndexVar->getName()])
+      {
+        Proven = &*It;
+        break;
+      }
 
-  // Create a new basic block to start insertion into
-  BasicBlock *BB = BasicBlock::Create(*TheContext, "entry", TheFunction);
-  Builder->SetInsertPoint(BB);
+  Value *Arr = Array->codegen();
+  if (!Arr)
+    return nullptr;
 
-  // Generate the body
-  for (auto &Expr : Body) {
-    if (!Expr->codegen()) {
-      TheFunction->eraseFromParent(); // cleanup
+  Type *IdxTy = Type::getInt64Ty(*TheContext);
+  Value *Idx, *InBounds, *Length;
+  std::tie(Data, Length) = LoadArrayParts(Arr);
+  if (Proven)
+  {
+    Idx = Builder->CreateLoad(IdxTy, Proven->Counter, "idx");
+    InBounds = Proven->InBounds;
+  }
+  else
+  {
+    Value *IndexV = Index->codegen();
+    if (!IndexV)
       return nullptr;
-    }
+    if (!IndexV->getType()->isDoubleTy())
+      return LogErrorV("Index ye array inofanira kuva namba");
+    // Freeze: an index too large for an i64 must fail the check, not make
+    // it undefined.
+    Idx = Builder->CreateFreeze(Builder->CreateFPToSI(IndexV, IdxTy), "idx");
+    // Unsigned, so a negative index fails too.
+    InBounds = Builder->CreateICmpULT(Idx, Length, "inbounds");
   }
 
-  // Return 0.0 by default if the body has no return (optional)
-  Builder->CreateRet(ConstantFP::get(*TheContext, APFloat(0.0)));
+  EmitBoundsCheck(InBounds, Idx, Length);
+  return Idx;
+}
 
-  // Verify the function
-  verifyFunction(*TheFunction);
+Value *IndexExprAST::codegenAddress(Type *&ElemTy)
+{
+  std::string Class = ClassOf(Array.get());
+  if (!RecordClassOf(Class).empty())
+    return LogErrorV("Rekodhi iri mu '[ ]' inoshandiswa ne '.' chete, semuna 'a[i].x'");
 
-  return TheFunction;
+  Value *Data = nullptr;
+  Value *Idx = codegenIndex(Data);
+  if (!Idx)
+    return nullptr;
+  ElemTy = Class == "[int]" ? Idx->getType() : Type::getDoubleTy(*TheContext);
+  return Builder->CreateInBoundsGEP(ElemTy, Data, Idx, "elem");
 }
 
+Value *IndexExprAST::codegen()
+{
+  Type *ElemTy = nullptr;
+  Value *Addr = codegenAddress(ElemTy);
+  if (!Addr)
+    return nullptr;
+  Value *Elem = Builder->CreateLoad(ElemTy, Addr, "elem");
+  if (ElemTy->isIntegerTy())
+    Elem = Builder->CreateSIToFP(Elem, Type::getDoubleTy(*TheContext), "elem");
+  return Elem;
+}
 
-Value *ClassAST::codegen() {
+// Output 'pakati (x mu a)' as a loop over the indexes of a, tested at the
+// top so an empty array runs the body no times. The indexes are in bounds
+// by construction, so there are no checks.
+Value *ForInExprAST::codegen()
+{
+  std::string Class = ClassOf(Array.get());
+  if (!IsArrayClass(Class))
+    return LogErrorV("'pakati (x mu ...)' inoda array");
 
-  // Handle Methods
-  for (auto &Method : Methods) {
-    PrototypeAST* OriginalProto = Method->getProto();
-    std::string MethodName = OriginalProto->getName();
-    std::string FullName = Name + "." + MethodName;
+  Value *Arr = Array->codegen();
+  if (!Arr)
+    return nullptr;
+  auto [Data, Length] = LoadArrayParts(Arr);
 
+  LLVMContext &C = *TheContext;
+  Type *IdxTy = Type::getInt64Ty(C);
+  Type *ElemTy = Class == "[int]" ? IdxTy : Type::getDoubleTy(C);
+  Function *TheFunction = Builder->GetInsertBlock()->getParent();
+  AllocaInst *Counter = CreateEntryBlockAlloca(TheFunction, VarName + ".idx", IdxTy);
+  AllocaInst *Var = CreateEntryBlockAlloca(TheFunction, VarName);
+  Builder->CreateStore(ConstantInt::get(IdxTy, 0), Counter);
 
-    auto NewProto = std::make_unique<PrototypeAST>(
-        FullName,
-        OriginalProto->getArgs(),
-        OriginalProto->isOperator(),
-        OriginalProto->getBinaryPrecedence()
-    );
+  BasicBlock *CondBB = BasicBlock::Create(C, "forin.cond", TheFunction);
+  BasicBlock *LoopBB = BasicBlock::Create(C, "forin.body", TheFunction);
+  BasicBlock *AfterBB = BasicBlock::Create(C, "forin.end", TheFunction);
+  Builder->CreateBr(CondBB);
 
-    FunctionProtos[FullName] = std::move(NewProto);
+  Builder->SetInsertPoint(CondBB);
+  Value *Idx = Builder->CreateLoad(IdxTy, Counter, "idx");
+  Builder->CreateCondBr(Builder->CreateICmpSLT(Idx, Length, "forin.cond"), LoopBB,
+                        AfterBB);
 
-    // Move method body
-    std::vector<std::unique_ptr<ExprAST>> Body;
-    for (auto &Expr : Method->getBody()) {
-      Body.push_back(std::move(Expr));
-    }
+  // x is a copy of the element; assigning to it leaves the array alone.
+  Builder->SetInsertPoint(LoopBB);
+  Value *Elem = Builder->CreateLoad(
+      ElemTy, Builder->CreateInBoundsGEP(ElemTy, Data, Idx, "elem"), VarName);
+  if (ElemTy->isIntegerTy())
+    Elem = Builder->CreateSIToFP(Elem, Type::getDoubleTy(C), VarName);
+  Builder->CreateStore(Elem, Var);
+
+  auto Old = NamedValues.find(VarName);
+  AllocaInst *OldVal = Old == NamedValues.end() ? nullptr : Old->second;
+  NamedValues[VarName] = Var;
+  {
+    LocalScope Scope;
+    for (auto &Stmt : Body)
+      if (!Stmt->codegen())
+        return nullptr;
+  }
+  if (OldVal)
+    NamedValues[VarName] = OldVal;
+  else
+    NamedValues.erase(VarName);
 
-    auto NewFunction = std::make_unique<FunctionAST>(
-        FunctionProtos[FullName]->clone(),
-        std::move(Body),
-        FullName
-    );
+  Idx = Builder->CreateLoad(IdxTy, Counter, "idx");
+  Builder->CreateStore(Builder->CreateNSWAdd(Idx, ConstantInt::get(IdxTy, 1), "nextidx"),
+                       Counter);
+  Builder->CreateBr(CondBB);
 
-    if (!NewFunction->codegen()) {
-      return LogErrorV(("Basa iri ratadza kugadzirwa" + FullName).c_str());
+  Builder->SetInsertPoint(AfterBB);
+  return ConstantFP::get(C, APFloat(0.0));
+}
+
+//===----------------------------------------------------------------------===//
+// Vectors
+//===----------------------------------------------------------------------===//
+
+/// VectorBuiltin - Make, load, store, take apart and reduce vectors. These
+/// are expanded in place into LLVM vector instructions rather than called.
+static Value *VectorBuiltin(const std::string &Callee,
+                            const std::vector<std::unique_ptr<ExprAST>> &Args)
+{
+  LLVMContext &C = *TheContext;
+  Type *DoubleTy = Type::getDoubleTy(C);
+  auto Fail = [&](const std::string &What) {
+    return LogErrorV(("'" + Callee + "' " + What).c_str());
+  };
+
+  // vload4(a, i) is a[i] .. a[i + 3] as a vec4, and vstore(a, i, v) stores
+  // v there. Every lane's index is checked, as 'a[i]' checks one.
+  if (Callee == "vstore" || Callee.rfind("vload", 0) == 0)
+  {
+    bool Store = Callee == "vstore";
+    if (Args.size() != (Store ? 3u : 2u))
+      return Fail(Store ? "inoda (array, index, vector)" : "inoda (array, index)");
+    if (ClassOf(Args[0].get()) != "[double]")
+      return Fail("inoda array ye [double]");
+    Value *Arr = Args[0]->codegen();
+    Value *IndexV = Arr ? Args[1]->codegen() : nullptr;
+    Value *Vec = Store && IndexV ? Args[2]->codegen() : nullptr;
+    if (!IndexV || (Store && !Vec))
+      return nullptr;
+    unsigned N = Store ? LanesOf(Vec) : VectorWidthOf("vec" + Callee.substr(5));
+    if (!IndexV->getType()->isDoubleTy() || !N)
+      return Fail(Store ? "inoda index iri namba ne vector" : "inoda index iri namba");
+
+    Type *IdxTy = Type::getInt64Ty(C);
+    auto [Data, Length] = LoadArrayParts(Arr);
+    Value *First = Builder->CreateFreeze(Builder->CreateFPToSI(IndexV, IdxTy), "idx");
+    Value *Last = Builder->CreateAdd(First, ConstantInt::get(IdxTy, N - 1), "idx.last");
+    Value *FirstOk = Builder->CreateICmpULT(First, Length, "inbounds");
+    Value *InBounds =
+        Builder->CreateAnd(FirstOk, Builder->CreateICmpULT(Last, Length), "inbounds");
+    EmitBoundsCheck(InBounds, Builder->CreateSelect(FirstOk, Last, First), Length);
+
+    // The elements are only known to be 8-byte aligned: i may be any index.
+    Value *Addr = Builder->CreateInBoundsGEP(DoubleTy, Data, First, "elem");
+    if (Store)
+    {
+      Builder->CreateAlignedStore(Vec, Addr, Align(8));
+      return ConstantFP::get(C, APFloat(0.0));
     }
+    return Builder->CreateAlignedLoad(FixedVectorType::get(DoubleTy, N), Addr, Align(8),
+                                      "vload");
   }
 
-  // Handle Members
-  std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> QualifiedMembers;
+  std::vector<Value *> Vals;
+  for (auto &Arg : Args)
+  {
+    Value *V = Arg->codegen();
+    if (!V)
+      return nullptr;
+    Vals.push_back(V);
+  }
+  unsigned N = Vals.empty() ? 0 : LanesOf(Vals[0]);
 
-  for (auto &Member : Members) {
-    std::string FullVarName = Name + "." + Member.first;
-    QualifiedMembers.emplace_back(FullVarName, std::move(Member.second));
+  // vec4(a, b, c, d), or vec4(x) for x in every lane.
+  if (unsigned Width = VectorWidthOf(Callee))
+  {
+    for (Value *V : Vals)
+      if (!V->getType()->isDoubleTy())
+        return Fail("inoda manhamba");
+    if (Vals.size() == 1)
+      return Builder->CreateVectorSplat(Width, Vals[0], Callee);
+    if (Vals.size() != Width)
+      return Fail("inoda nhamba imwe chete kana " + std::to_string(Width));
+    Value *Vec = PoisonValue::get(FixedVectorType::get(DoubleTy, Width));
+    for (unsigned i = 0; i != Width; ++i)
+      Vec = Builder->CreateInsertElement(Vec, Vals[i], i, Callee);
+    return Vec;
   }
 
-  auto GlobalVars = std::make_unique<GlobalVarExprAST>(std::move(QualifiedMembers));
+  // lane(v, k) and setLane(v, k, x). k is taken modulo the width, so every
+  // k names a lane.
+  if (Callee == "lane" || Callee == "setLane")
+  {
+    bool Set = Callee == "setLane";
+    if (Vals.size() != (Set ? 3u : 2u) || !N || !Vals[1]->getType()->isDoubleTy() ||
+        (Set && !Vals[2]->getType()->isDoubleTy()))
+      return Fail(Set ? "inoda (vector, lane, namba)" : "inoda (vector, lane)");
+    Type *IdxTy = Type::getInt64Ty(C);
+    Value *K = Builder->CreateFreeze(Builder->CreateFPToSI(Vals[1], IdxTy));
+    K = Builder->CreateAnd(K, ConstantInt::get(IdxTy, N - 1), "lane");
+    return Set ? Builder->CreateInsertElement(Vals[0], Vals[2], K, "setlane")
+               : Builder->CreateExtractElement(Vals[0], K, "lane");
+  }
 
-  if (!GlobalVars->codegen()) {
-    return LogErrorV(("'zita' iri ratadza kugadzirwa " + Name).c_str());
+  // shuffle(v, 3, 2, 1, 0) picks lanes of v by number; shuffle2(a, b, ...)
+  // numbers the lanes of a then those of b. The result has as many lanes as
+  // there are numbers, which must be constants.
+  if (Callee == "shuffle" || Callee == "shuffle2")
+  {
+    unsigned Sources = Callee == "shuffle2" ? 2 : 1;
+    if (Vals.size() <= Sources || !N || (Sources == 2 && LanesOf(Vals[1]) != N))
+      return Fail(Sources == 2 ? "inoda ma vector maviri akaenzana" : "inoda vector");
+    unsigned Width = Vals.size() - Sources;
+    if (!VectorWidthOf("vec" + std::to_string(Width)))
+      return Fail("inoda 2, 4 kana 8 lanes");
+    SmallVector<int, 8> Mask;
+    for (unsigned i = 0; i != Width; ++i)
+    {
+      auto *Lane = dyn_cast<ConstantFP>(Vals[Sources + i]);
+      double D = Lane ? Lane->getValueAPF().convertToDouble() : -1;
+      if (!(D >= 0 && D < Sources * N && D == std::floor(D)))
+        return Fail("inoda manhamba akatarwa e lanes, semuna shuffle(v, 3, 2, 1, 0)");
+      Mask.push_back(int(D));
+    }
+    Value *Second = Sources == 2 ? Vals[1] : PoisonValue::get(Vals[0]->getType());
+    return Builder->CreateShuffleVector(Vals[0], Second, Mask, "shuffle");
   }
 
-  return Constant::getNullValue(Type::getInt32Ty(*TheContext));
-}
+  // hsum adds the lanes in whatever order is quickest; hmin and hmax.
+  if (Callee == "hsum" || Callee == "hmin" || Callee == "hmax")
+  {
+    if (Vals.size() != 1 || !N)
+      return Fail("inoda vector");
+    if (Callee == "hmin")
+      return Builder->CreateFPMinReduce(Vals[0]);
+    if (Callee == "hmax")
+      return Builder->CreateFPMaxReduce(Vals[0]);
+    auto *Sum = cast<Instruction>(
+        Builder->CreateFAddReduce(ConstantFP::getNegativeZero(DoubleTy), Vals[0]));
+    Sum->setHasAllowReassoc(true);
+    return Sum;
+  }
 
+  // vmin, vmax, vabs and vfma (a * b + c, rounded once), lane by lane.
+  unsigned Arity = Callee == "vabs" ? 1 : Callee == "vfma" ? 3 : 2;
+  if (Vals.size() != Arity || !MatchLanes(Vals))
+    return Fail("haina ma arguments akakodzera");
+  if (Callee == "vmin")
+    return Builder->CreateMinNum(Vals[0], Vals[1], "vmin");
+  if (Callee == "vmax")
+    return Builder->CreateMaxNum(Vals[0], Vals[1], "vmax");
+  if (Callee == "vabs")
+    return Builder->CreateUnaryIntrinsic(Intrinsic::fabs, Vals[0], nullptr, "vabs");
+  return Builder->CreateIntrinsic(Intrinsic::fma, {Vals[0]->getType()}, Vals, nullptr,
+                                  "vfma");
+}
 
-Function *PrototypeAST::codegen()
+/// LanewiseMath - The numeric builtins applied to each lane of a vector, as
+/// LLVM instructions and intrinsics. They don't report bad arguments the way
+/// the builtins do: a lane of logarithm(v) at 0 is simply -inf.
+static Value *LanewiseMath(const std::string &Callee, std::vector<Value *> Args)
 {
-  // Make the function type:  double(double,double) etc.
-  std::vector<Type *> Doubles(Args.size(), Type::getDoubleTy(*TheContext));
-  FunctionType *FT =
-      FunctionType::get(Type::getDoubleTy(*TheContext), Doubles, false);
+  if (!MatchLanes(Args))
+    return LogErrorV(("Ma vector e '" + Callee + "' haana upamhi hwakaenzana").c_str());
+
+  if (Callee == "wedzera")
+    return Builder->CreateFAdd(Args[0], Args[1], "addtmp");
+  if (Callee == "bvisaNamba")
+    return Builder->CreateFSub(Args[0], Args[1], "subtmp");
+  if (Callee == "wedzeranisa")
+    return Builder->CreateFMul(Args[0], Args[1], "multmp");
+  if (Callee == "govana")
+    return Builder->CreateFDiv(Args[0], Args[1], "divtmp");
+  if (Callee == "simba")
+    return Builder->CreateBinaryIntrinsic(Intrinsic::pow, Args[0], Args[1], nullptr, "simba");
+
+  static const std::map<std::string, Intrinsic::ID> Unary = {
+      {"tsvagaMudzi", Intrinsic::sqrt}, {"logarithm", Intrinsic::log},
+      {"expo", Intrinsic::exp},         {"saini", Intrinsic::sin},
+      {"cosi", Intrinsic::cos},
+  };
+  return Builder->CreateUnaryIntrinsic(Unary.at(Callee), Args[0], nullptr, Callee);
+}
 
-  Function *F =
-      Function::Create(FT, Function::ExternalLinkage, Name, TheModule.get());
+Function *PrototypeAST::codegen(const std::string &NameOverride)
+{
+  // Make the function type:  double(double,double) etc. Object arguments
+  // are pointers, vector arguments LLVM vectors.
+  std::vector<Type *> ArgTypes;
+  for (unsigned i = 0, e = Args.size(); i != e; ++i)
+    ArgTypes.push_back(TypeOfClass(getArgClass(i)));
+  FunctionType *FT = FunctionType::get(TypeOfClass(ReturnClass), ArgTypes, false);
+
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 NameOverride.empty() ? Name : NameOverride,
+                                 TheModule.get());
+
+  // Calls between JIT'd functions never cross into C, so let the backend
+  // pass arguments in as many registers as it likes.
+  if (Internal)
+    F->setCallingConv(CallingConv::Fast);
+
+  // Without these LLVM must assume a call may read or write any memory,
+  // which keeps it from CSE'ing, hoisting or vectorizing around the call.
+  if (Attrs & FA_NoMemory)
+    F->setMemoryEffects(MemoryEffects::none());
+  else if (Attrs & FA_ReadOnly)
+    F->setMemoryEffects(MemoryEffects::readOnly());
+  else if (Attrs & FA_InaccessibleMem)
+    F->setMemoryEffects(MemoryEffects::inaccessibleMemOnly());
+  if (Attrs & FA_NoUnwind)
+    F->setDoesNotThrow();
+  if (Attrs & FA_WillReturn)
+    F->addFnAttr(Attribute::WillReturn);
+  if (Attrs & FA_NoFree)
+    F->addFnAttr(Attribute::NoFree);
+
+  // A returned object is always a new one.
+  if (!ReturnClass.empty())
+  {
+    F->addRetAttr(Attribute::NoAlias);
+    F->addRetAttr(Attribute::NonNull);
+  }
 
   // Set names for all arguments.
   unsigned Idx = 0;
@@ -697,10 +3511,20 @@ void InitializeModuleAndManagers()
   TheContext = std::make_unique<LLVMContext>();
   TheModule = std::make_unique<Module>("KaleidoscopeJIT", *TheContext);
   TheModule->setDataLayout(TheJIT->getDataLayout());
+  TheModule->setTargetTriple(sys::getProcessTriple());
 
   // Create a new builder for the module.
   Builder = std::make_unique<IRBuilder<>>(*TheContext);
 
+  // Let every floating-point operation be reassociated, contracted into FMAs
+  // and assumed finite, which is what lets reductions vectorize.
+  if (CompileOptions.FastMath)
+  {
+    FastMathFlags FMF;
+    FMF.setFast();
+    Builder->setFastMathFlags(FMF);
+  }
+
   // Create new pass and analysis managers.
   TheFPM = std::make_unique<FunctionPassManager>();
   TheLAM = std::make_unique<LoopAnalysisManager>();
@@ -731,11 +3555,78 @@ void InitializeModuleAndManagers()
   PB.crossRegisterProxies(*TheLAM, *TheFAM, *TheCGAM, *TheMAM);
 }
 
+/// OptimizeModule - Run LLVM's standard pipeline for the selected -O level on a
+/// module that is about to be handed to the JIT.
+void OptimizeModule(Module &M)
+{
+  if (CompileOptions.OptLevel == 0)
+    return;
+
+  // Leave broken IR alone; the optimizer assumes a valid module.
+  if (verifyModule(M))
+    return;
+
+  // Give the inliner the bodies of the small builtins M calls.
+  LinkRuntime(M);
+
+  if (HasProfileData())
+    AttachProfileSummary(M);
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+
+  // The JIT's target machine gives the optimizer real cost models: vector
+  // register widths, FMA, the CPU selected by --march=native.
+  static std::unique_ptr<TargetMachine> TM = [] {
+    auto TMOrErr = TheJIT->createTargetMachine();
+    if (!TMOrErr)
+    {
+      consumeError(TMOrErr.takeError());
+      return std::unique_ptr<TargetMachine>();
+    }
+    return std::move(*TMOrErr);
+  }();
+
+  PassBuilder PB(TM.get());
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  OptimizationLevel Level = CompileOptions.OptLevel == 1   ? OptimizationLevel::O1
+                            : CompileOptions.OptLevel == 2 ? OptimizationLevel::O2
+                                                           : OptimizationLevel::O3;
+  // Objects that never leave the function creating them go on its stack,
+  // and from there into registers.
+  PB.registerScalarOptimizerLateEPCallback(
+      [](FunctionPassManager &FPM, OptimizationLevel) {
+        FPM.addPass(StackPromoteObjectsPass());
+        FPM.addPass(SROAPass(SROAOptions::ModifyCFG));
+      });
+  // With real block counts, outline the cold parts of hot functions.
+  if (HasProfileData())
+    PB.registerOptimizerLastEPCallback(
+        [](ModulePassManager &MPM, OptimizationLevel) {
+          MPM.addPass(HotColdSplittingPass());
+        });
+
+  ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(Level);
+  MPM.run(M, MAM);
+
+  if (HasProfileData())
+    LayOutFunctions(M);
+}
+
+static void FlushIfPendingUses(const std::string &Name);
 
 void HandleExtern()
 {
   if (auto ProtoAST = ParseExtern())
   {
+    FlushIfPendingUses(ProtoAST->getName());
     if (auto *FnIR = ProtoAST->codegen())
     {
       fprintf(stderr, "Read extern: ");
@@ -753,8 +3644,16 @@ void HandleExtern()
 
 void HandleDefinition() {
   if (auto FnAST = ParseDefinition()) {
+      FlushIfPendingUses(FnAST->getName());
+      // Calls in its own body already go to the new basa.
+      ForgetPureBuiltin(FnAST->getName());
+      if (CompileOptions.OptLevel > 0)
+          FoldConstants(FnAST->getBody());
       if (auto *FnIR = FnAST->codegen()) {
-          // Don't add to JIT yet — handled in MainLoop
+          // Don't add to JIT yet — handled in MainLoop. Keep the AST so
+          // later constant calls to this basa can be evaluated.
+          AddEvaluableFunction(FnAST.get());
+          EvaluableDefinitions.push_back(std::move(FnAST));
       }
   } else {
       getNextToken();
@@ -765,6 +3664,7 @@ void HandleDefinition() {
 std::unique_ptr<Module> CloneModule(Module& M, LLVMContext& Context) {
   auto NewModule = std::make_unique<Module>("jit_module", Context);
   NewModule->setDataLayout(M.getDataLayout());
+  NewModule->setTargetTriple(M.getTargetTriple());
   
   // Value mapping for cloning
   ValueToValueMapTy VMap;
@@ -815,35 +3715,102 @@ for (Function &F : M.functions()) {
   
   return NewModule;
 }
-void HandleTopLevelExpression() {
+// Top-level statements parsed but not run yet, and every name they refer to.
+// They are compiled and run together by FlushTopLevelStatements.
+static std::vector<std::unique_ptr<FunctionAST>> PendingStatements;
+static std::set<std::string> PendingNames;
+
+/// FlushTopLevelStatements - Compile the pending statements, each into its
+/// own function, plus one entry point that calls them in order. The batch is
+/// cloned, optimized, JIT'd, looked up and removed once, however many
+/// statements it holds.
+static void FlushTopLevelStatements() {
   static int AnonCount = 0;
-  std::string FuncName = "__anon_expr" + std::to_string(AnonCount++);
+  static int BatchCount = 0;
+
+  // A statement that fails to compile is reported and skipped, as before;
+  // the others still run.
+  std::vector<Function *> Statements;
+  for (auto &FnAST : PendingStatements) {
+    std::string FuncName = "__anon_expr" + std::to_string(AnonCount++);
+    if (Function *F = FnAST->codegen(FuncName)) {
+      F->setLinkage(GlobalValue::InternalLinkage);
+      Statements.push_back(F);
+    }
+  }
+  PendingStatements.clear();
+  PendingNames.clear();
+  if (Statements.empty())
+    return;
+
+  std::string EntryName = "__anon_batch" + std::to_string(BatchCount++);
+  Function *Entry = Function::Create(
+      FunctionType::get(Type::getDoubleTy(*TheContext), false),
+      Function::ExternalLinkage, EntryName, TheModule.get());
+  Builder->SetInsertPoint(BasicBlock::Create(*TheContext, "entry", Entry));
+  for (Function *F : Statements)
+    Builder->CreateCall(F);
+  Builder->CreateRet(ConstantFP::get(*TheContext, APFloat(0.0)));
 
-  if (auto FnAST = ParseTopLevelExpr()) {
-    // Pass the function name override
-    if (FnAST->codegen(FuncName)) {
+  // Create resource tracker
+  auto RT = TheJIT->getMainJITDylib().createResourceTracker();
 
-      // Create resource tracker
-      auto RT = TheJIT->getMainJITDylib().createResourceTracker();
+  // Use a temporary context for cloning
+  auto TmpContext = std::make_unique<LLVMContext>();
+  auto ClonedModule = CloneModule(*TheModule, *TmpContext);
+  OptimizeModule(*ClonedModule);
 
-      // Use a temporary context for cloning
-      auto TmpContext = std::make_unique<LLVMContext>();
-      auto ClonedModule = CloneModule(*TheModule, *TmpContext);
+  // The statements have run once they're in the JIT; later batches and the
+  // module added at EOF don't need them.
+  Entry->eraseFromParent();
+  for (Function *F : Statements)
+    F->eraseFromParent();
 
-      // Create the ThreadSafeModule
-      orc::ThreadSafeModule TSM(std::move(ClonedModule), std::move(TmpContext));
+  // Create the ThreadSafeModule
+  orc::ThreadSafeModule TSM(std::move(ClonedModule), std::move(TmpContext));
 
-      // Add to JIT
-      ExitOnErr(TheJIT->addModule(std::move(TSM), RT));
+  // Add to JIT
+  ExitOnErr(TheJIT->addModule(std::move(TSM), RT));
 
-      // Lookup and execute the unique function
-      auto ExprSymbol = ExitOnErr(TheJIT->lookup(FuncName));
-      auto FP = ExprSymbol.getAddress().toPtr<double (*)()>();
-      FP();
+  // Lookup and execute the batch
+  auto ExprSymbol = ExitOnErr(TheJIT->lookup(EntryName));
+  auto FP = ExprSymbol.getAddress().toPtr<double (*)()>();
+  FP();
 
-      // Clean up
-      ExitOnErr(RT->remove());
-    }
+  // Tasks the batch started run its code; let them finish before it goes.
+  WaitForTasks();
+
+  // Clean up
+  ExitOnErr(RT->remove());
+}
+
+/// FlushIfPendingUses - Run the pending statements before a definition of
+/// Name takes effect, if any of them refers to it. Otherwise they'd see a
+/// declaration that comes after them in the script.
+static void FlushIfPendingUses(const std::string &Name) {
+  if (PendingNames.count(Name))
+    FlushTopLevelStatements();
+}
+
+/// QueueStatement - Add a top-level statement to the pending batch.
+static void QueueStatement(std::unique_ptr<ExprAST> E) {
+  CollectReferencedNames(E.get(), PendingNames);
+  std::vector<std::unique_ptr<ExprAST>> Body;
+  Body.push_back(std::move(E));
+  auto Proto = std::make_unique<PrototypeAST>("__anon_expr",
+                                              std::vector<std::string>());
+  PendingStatements.push_back(
+      std::make_unique<FunctionAST>(std::move(Proto), std::move(Body)));
+}
+
+void HandleTopLevelExpression() {
+  if (auto FnAST = ParseTopLevelExpr()) {
+    if (CompileOptions.OptLevel > 0)
+      FoldConstants(FnAST->getBody());
+
+    for (auto &Stmt : FnAST->getBody())
+      CollectReferencedNames(Stmt.get(), PendingNames);
+    PendingStatements.push_back(std::move(FnAST));
   } else {
     getNextToken(); // Skip on error
   }
@@ -856,8 +3823,9 @@ void MainLoop() {
   while (true) {
       switch (CurTok) {
           case tok_eof: {
+              FlushTopLevelStatements();
               if (needsModuleAdd) {
-
+                  OptimizeModule(*TheModule);
                   ExitOnErr(TheJIT->addModule(
                       ThreadSafeModule(std::move(TheModule), std::move(TheContext))
                   ));
@@ -869,9 +3837,24 @@ void MainLoop() {
 
           case tok_globalvar: {
             auto Global = ParseGlobalVarExpr();
+            // 'zita p = new Point()' declares p empty and fills it in when
+            // the statements around it run.
+            std::vector<std::unique_ptr<ExprAST>> Inits;
+            if (auto *Decl = dynamic_cast<GlobalVarExprAST *>(Global.get())) {
+                for (auto &Var : Decl->getVars())
+                    FlushIfPendingUses(Var.first);
+                Inits = Decl->takeRuntimeInitializers();
+            }
+            if (Global && CompileOptions.OptLevel > 0)
+                FoldConstants(Global);
             if (Global && Global->codegen()) {
                 // Keep the module with globals alive
                 needsModuleAdd = true;
+                for (auto &Init : Inits) {
+                    if (CompileOptions.OptLevel > 0)
+                        FoldConstants(Init);
+                    QueueStatement(std::move(Init));
+                }
             } else {
                 LogError("Zita iri ratadza kugadzirwa");
             }
@@ -883,6 +3866,10 @@ void MainLoop() {
               getNextToken(); // Skip empty statement
               break;
 
+          case tok_extern:
+              HandleExtern();
+              break;
+
           case tok_def:
               HandleDefinition();
               needsModuleAdd = true;
@@ -891,6 +3878,13 @@ void MainLoop() {
           case tok_class: {
               getNextToken(); // eat 'class'
               if (auto Class = ParseClass()) {
+                  for (auto &Method : Class->getMethods())
+                      FlushIfPendingUses(Class->getName() + "." + Method->getProto()->getName());
+                  for (auto &Member : Class->getMembers())
+                      FlushIfPendingUses(Class->getName() + "." + Member.first);
+                  if (CompileOptions.OptLevel > 0)
+                      for (auto &Method : Class->getMethods())
+                          FoldConstants(Method->getBody());
                   if (!Class->codegen()) {
                   } else {
                       needsModuleAdd = true;
@@ -907,4 +3901,107 @@ void MainLoop() {
               break;
       }
   }
-}
\ No newline at end of file
+}
+
+/// RunWholeProgram - Parse the entire script, compile it into a single module
+/// with a synthesized __tino_main holding the top-level statements, optimize
+/// that module as a whole and run it once.
+void RunWholeProgram() {
+  auto Program = ParseProgram();
+
+  // A global initialized with 'new' starts out empty and gets its object
+  // where it was declared, like any other assignment.
+  for (size_t i = 0; i != Program->TopLevel.size(); ++i) {
+    auto *Global = dynamic_cast<GlobalVarExprAST *>(Program->TopLevel[i].get());
+    if (!Global)
+      continue;
+    auto Inits = Global->takeRuntimeInitializers();
+    for (auto &Init : Inits)
+      Program->TopLevel.insert(Program->TopLevel.begin() + ++i, std::move(Init));
+  }
+
+  ReadOnlyGlobals = FindReadOnlyGlobals(*Program);
+
+  // Evaluate what can be evaluated before generating any code. Globals that
+  // are never assigned are constants the evaluator may read, and every basa
+  // is visible to it wherever it is defined.
+  if (CompileOptions.OptLevel > 0) {
+    for (auto &Fn : Program->Functions)
+      ForgetPureBuiltin(Fn->getName());
+    for (auto &E : Program->TopLevel) {
+      auto *Global = dynamic_cast<GlobalVarExprAST *>(E.get());
+      if (!Global)
+        continue;
+      FoldConstants(E);
+      for (auto &[Name, Init] : Global->getVars())
+        if (auto *Num = dynamic_cast<NumberExprAST *>(Init.get()))
+          if (ReadOnlyGlobals.count(Name))
+            AddConstantGlobal(Name, Num->getVal());
+    }
+    for (auto &Fn : Program->Functions)
+      AddEvaluableFunction(Fn.get());
+    ForEachBody(*Program, [](std::vector<std::unique_ptr<ExprAST>> &Body) {
+      FoldConstants(Body);
+    });
+  }
+
+  for (auto &Proto : Program->Externs) {
+    std::string Name = Proto->getName();
+    FunctionProtos[Name] = std::move(Proto);
+  }
+
+  // Globals first, so every function body can refer to them whatever their
+  // position in the file. Their initializers are constants, so nothing is
+  // lost by hoisting them out of the statement order.
+  std::vector<std::unique_ptr<ExprAST>> MainBody;
+  for (auto &E : Program->TopLevel) {
+    if (auto *Global = dynamic_cast<GlobalVarExprAST *>(E.get())) {
+      if (!Global->codegen())
+        LogError("Zita iri ratadza kugadzirwa");
+      continue;
+    }
+    MainBody.push_back(std::move(E));
+  }
+
+  // Declare every function before any body is generated so calls may refer
+  // to functions defined further down.
+  for (auto &Fn : Program->Functions) {
+    if (!TheModule->getFunction(Fn->getName()))
+      Fn->getProto()->codegen(Fn->getName());
+  }
+
+  // Every class is known before any method body is generated, so calls can
+  // be devirtualized against the complete class hierarchy.
+  std::vector<ClassAST *> Declared;
+  for (auto &Class : Program->Classes)
+    if (Class->declare())
+      Declared.push_back(Class.get());
+  for (ClassAST *Class : Declared)
+    Class->codegenMethods();
+  for (auto &Fn : Program->Functions)
+    Fn->codegen();
+
+  auto MainProto = std::make_unique<PrototypeAST>("__tino_main",
+                                                  std::vector<std::string>());
+  FunctionAST Main(std::move(MainProto), std::move(MainBody), "__tino_main");
+  Function *MainF = Main.codegen();
+  if (!MainF)
+    return;
+
+  // Only the entry point is called from outside; every other function and
+  // global may be inlined, specialized, folded or dropped by the IPO passes.
+  for (GlobalValue &GV : TheModule->global_values())
+    if (!GV.isDeclaration() && &GV != MainF && !GV.hasLocalLinkage())
+      GV.setLinkage(GlobalValue::InternalLinkage);
+
+  OptimizeModule(*TheModule);
+
+  if (CompileOptions.EmitLLVM)
+    TheModule->print(errs(), nullptr);
+
+  ExitOnErr(TheJIT->addModule(
+      ThreadSafeModule(std::move(TheModule), std::move(TheContext))));
+  auto MainSymbol = ExitOnErr(TheJIT->lookup("__tino_main"));
+  MainSymbol.getAddress().toPtr<double (*)()>()();
+  WaitForTasks();
+}
@@ -23,11 +23,30 @@ extern std::unique_ptr<StandardInstrumentations> TheSI;
 extern std::map<std::string, std::unique_ptr<PrototypeAST>> FunctionProtos;
 extern ExitOnError ExitOnErr;
 
+/// TinoOptions - Settings taken from the command line by the driver.
+struct TinoOptions
+{
+  unsigned OptLevel = 2;           // -O0 .. -O3
+  std::string ProfileGenerateFile; // --profile-generate[=file]
+  std::string ProfileUseFile;      // --profile-use[=file]
+  bool HugePages = false;          // --huge-pages
+  bool WholeProgram = false;       // --whole-program
+  bool EmitLLVM = false;           // --emit-llvm
+  bool NativeCPU = false;          // --march=native
+  bool FastMath = false;           // --fast-math
+  std::string Simd;                // --simd=isa; empty for the best available
+  unsigned Threads = 0;            // --threads=n; 0 for one per hardware thread
+  bool ReportParallel = false;     // --report-parallel
+};
+extern TinoOptions CompileOptions;
+
 // Initializes the LLVM module and global states.
 void MainLoop();
+void RunWholeProgram();
 void HandleTopLevelExpression();
 void HandleExtern();
 void HandleDefinition();
 void InitializeModuleAndManagers();
+void OptimizeModule(Module &M);
 
 #endif // CODEGEN_H
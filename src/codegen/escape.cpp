@@ -0,0 +1,113 @@
+#include "escape.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/InstIterator.h"
+
+// Bigger objects stay on the heap, so recursion can't exhaust the stack one
+// large frame at a time.
+static const uint64_t MaxStackObjectSize = 256;
+
+static bool isObjectAllocation(const CallInst *CI)
+{
+  const Function *Callee = CI->getCalledFunction();
+  return Callee && Callee->getName() == "tino_object_alloc";
+}
+
+/// escapes - Whether the object Alloc returns may still be reachable once the
+/// function returns. Loads and stores through the object and its fields are
+/// fine; storing the pointer itself, returning it, merging it with other
+/// pointers in a phi or select, or handing it to a call that may capture it
+/// are not. Neither is handing it to a musttail call, which can't read the
+/// caller's frame; the other calls it is handed to go in Calls.
+static bool escapes(Instruction *Alloc, SmallVectorImpl<CallInst *> &Calls)
+{
+  SmallVector<Value *, 8> Worklist = {Alloc};
+  SmallPtrSet<Value *, 8> Visited;
+  while (!Worklist.empty())
+  {
+    Value *V = Worklist.pop_back_val();
+    if (!Visited.insert(V).second)
+      continue;
+
+    for (Use &U : V->uses())
+    {
+      auto *User = cast<Instruction>(U.getUser());
+      if (isa<LoadInst>(User) || isa<ICmpInst>(User))
+        continue;
+      if (auto *Store = dyn_cast<StoreInst>(User))
+      {
+        if (U.getOperandNo() == StoreInst::getPointerOperandIndex())
+          continue;
+        return true;
+      }
+      if (auto *GEP = dyn_cast<GetElementPtrInst>(User))
+      {
+        Worklist.push_back(GEP);
+        continue;
+      }
+      // A method that wasn't inlined but is known not to keep 'this'.
+      if (auto *Call = dyn_cast<CallBase>(User))
+      {
+        auto *CI = dyn_cast<CallInst>(Call);
+        if (CI && CI->isMustTailCall())
+          return true;
+        if (Call->isArgOperand(&U) &&
+            Call->doesNotCapture(Call->getArgOperandNo(&U)))
+        {
+          if (CI)
+            Calls.push_back(CI);
+          continue;
+        }
+        return true;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+PreservedAnalyses StackPromoteObjectsPass::run(Function &F, FunctionAnalysisManager &)
+{
+  SmallVector<CallInst *, 8> Promotable;
+  SmallVector<CallInst *, 8> Receivers;
+  for (Instruction &I : instructions(F))
+  {
+    auto *Call = dyn_cast<CallInst>(&I);
+    if (!Call || !isObjectAllocation(Call))
+      continue;
+    auto *Size = dyn_cast<ConstantInt>(Call->getArgOperand(0));
+    SmallVector<CallInst *, 4> Calls;
+    if (Size && Size->getZExtValue() <= MaxStackObjectSize && !escapes(Call, Calls))
+    {
+      Promotable.push_back(Call);
+      Receivers.append(Calls.begin(), Calls.end());
+    }
+  }
+  if (Promotable.empty())
+    return PreservedAnalyses::all();
+
+  IRBuilder<> Entry(&F.getEntryBlock(), F.getEntryBlock().getFirstInsertionPt());
+  for (CallInst *Call : Promotable)
+  {
+    uint64_t Size = cast<ConstantInt>(Call->getArgOperand(0))->getZExtValue();
+    AllocaInst *Slot = Entry.CreateAlloca(
+        ArrayType::get(Entry.getInt8Ty(), Size), nullptr, Call->getName());
+    Slot->setAlignment(Align(16));
+
+    // 'new' hands out zeroed memory, on every trip round a loop too. Nothing
+    // can refer to the previous trip's object here: it would have needed a
+    // phi, and a phi counts as an escape.
+    IRBuilder<> B(Call);
+    B.CreateMemSet(Slot, B.getInt8(0), Size, Align(16));
+    Call->replaceAllUsesWith(Slot);
+    Call->eraseFromParent();
+  }
+
+  // A 'tail' call may assume it reads nothing in this frame, which is no
+  // longer so for the calls the objects are passed to (dzosa f(new A)).
+  for (CallInst *Call : Receivers)
+    Call->setTailCallKind(CallInst::TCK_None);
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  return PA;
+}
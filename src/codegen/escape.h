@@ -0,0 +1,23 @@
+// Escape.h
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "../lexer/lexer.h"
+
+// Escape analysis for 'new'.
+//
+// An object that never leaves the function it is created in (it is not
+// returned, stored into memory, or passed to a call that might keep it) does
+// not need the heap. This pass turns such allocations into zeroed stack
+// slots; SROA, run right after it, then splits them into SSA values, so a
+// loop that builds a temporary Point every iteration allocates nothing.
+//
+// It runs late in the function simplification pipeline, after the inliner
+// has had a chance to pull in the methods called on the object.
+
+struct StackPromoteObjectsPass : PassInfoMixin<StackPromoteObjectsPass>
+{
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+};
+
+#endif // ESCAPE_H
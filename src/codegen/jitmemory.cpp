@@ -0,0 +1,84 @@
+#include "jitmemory.h"
+#include "../runtime/memory.h"
+
+// Sections are carved out at this granularity so they can still be handed to
+// sys::Memory::InvalidateInstructionCache and friends like normal mappings.
+static constexpr size_t SmallPageSize = 4096;
+
+HugePageMemoryMapper::~HugePageMemoryMapper()
+{
+  for (Pool *P : {&CodePool, &DataPool})
+    for (auto &[Base, Size] : P->Regions)
+      ReleaseLargeRegion(Base, Size);
+}
+
+sys::MemoryBlock HugePageMemoryMapper::allocateMappedMemory(
+    SectionMemoryManager::AllocationPurpose Purpose, size_t NumBytes,
+    const sys::MemoryBlock *const, unsigned, std::error_code &EC)
+{
+  std::lock_guard<std::mutex> Guard(Lock);
+  bool IsCode = Purpose == SectionMemoryManager::AllocationPurpose::Code;
+  Pool &P = IsCode ? CodePool : DataPool;
+  size_t Size = (NumBytes + SmallPageSize - 1) / SmallPageSize * SmallPageSize;
+  EC = std::error_code();
+
+  // Reuse memory from modules the JIT has already removed (first fit).
+  for (auto It = P.Free.begin(); It != P.Free.end(); ++It)
+  {
+    if (It->allocatedSize() < Size)
+      continue;
+    char *Base = static_cast<char *>(It->base());
+    size_t Rest = It->allocatedSize() - Size;
+    if (Rest)
+      *It = sys::MemoryBlock(Base + Size, Rest);
+    else
+      P.Free.erase(It);
+    return sys::MemoryBlock(Base, Size);
+  }
+
+  if (P.Left < Size)
+  {
+    if (P.Left)
+      P.Free.push_back(sys::MemoryBlock(P.Next, P.Left));
+
+    size_t RegionSize = std::max(Size, HugePageSize);
+    void *Region = AllocateLargeRegion(RegionSize, IsCode);
+    if (!Region)
+    {
+      EC = std::make_error_code(std::errc::not_enough_memory);
+      return sys::MemoryBlock();
+    }
+    P.Regions.emplace_back(Region, RegionSize);
+    P.Next = static_cast<char *>(Region);
+    P.Left = RegionSize;
+  }
+
+  sys::MemoryBlock Block(P.Next, Size);
+  P.Next += Size;
+  P.Left -= Size;
+  return Block;
+}
+
+std::error_code HugePageMemoryMapper::protectMappedMemory(const sys::MemoryBlock &,
+                                                          unsigned)
+{
+  // Regions already carry the widest protection they need; see the class
+  // comment for why they are not narrowed here.
+  return std::error_code();
+}
+
+std::error_code HugePageMemoryMapper::releaseMappedMemory(sys::MemoryBlock &M)
+{
+  std::lock_guard<std::mutex> Guard(Lock);
+  char *Base = static_cast<char *>(M.base());
+  for (Pool *P : {&CodePool, &DataPool})
+    for (auto &[RegionBase, RegionSize] : P->Regions)
+      if (Base >= static_cast<char *>(RegionBase) &&
+          Base < static_cast<char *>(RegionBase) + RegionSize)
+      {
+        P->Free.push_back(M);
+        M = sys::MemoryBlock();
+        return std::error_code();
+      }
+  return std::make_error_code(std::errc::invalid_argument);
+}
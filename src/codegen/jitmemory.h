@@ -0,0 +1,43 @@
+// JITMemory.h
+#ifndef JITMEMORY_H
+#define JITMEMORY_H
+
+#include "../lexer/lexer.h"
+#include <mutex>
+
+/// HugePageMemoryMapper - Hands out JIT code and data memory from large
+/// regions (see runtime/memory.h) instead of one mapping per section, so
+/// thousands of JIT'd functions share a handful of 2 MiB pages.
+///
+/// Changing the protection of part of a huge page splits it back into small
+/// pages, so code regions are mapped read/write/execute up front and
+/// protectMappedMemory leaves them alone. This gives up W^X for the JIT's own
+/// code, which is why the mapper is only used with --huge-pages.
+class HugePageMemoryMapper : public SectionMemoryManager::MemoryMapper
+{
+  struct Pool
+  {
+    std::vector<std::pair<void *, size_t>> Regions;
+    char *Next = nullptr;
+    size_t Left = 0;
+    std::vector<sys::MemoryBlock> Free;
+  };
+
+  Pool CodePool, DataPool;
+  std::mutex Lock;
+
+public:
+  ~HugePageMemoryMapper() override;
+
+  sys::MemoryBlock
+  allocateMappedMemory(SectionMemoryManager::AllocationPurpose Purpose,
+                       size_t NumBytes, const sys::MemoryBlock *const NearBlock,
+                       unsigned Flags, std::error_code &EC) override;
+
+  std::error_code protectMappedMemory(const sys::MemoryBlock &Block,
+                                      unsigned Flags) override;
+
+  std::error_code releaseMappedMemory(sys::MemoryBlock &M) override;
+};
+
+#endif // JITMEMORY_H
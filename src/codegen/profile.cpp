@@ -0,0 +1,245 @@
+#include "profile.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/ProfileSummary.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/TargetParser/Triple.h"
+
+// Counters handed out to JIT'd code. The code refers to them by address, so a
+// buffer is never freed or moved once a function has been instrumented with it.
+static std::vector<std::unique_ptr<uint64_t[]>> CounterStorage;
+static std::map<std::string, std::pair<uint64_t *, size_t>> FunctionCounters;
+
+// Counts read by LoadProfile, indexed by function name and block number.
+static std::map<std::string, std::vector<uint64_t>> LoadedProfile;
+
+static uint64_t *getCounters(const std::string &Name, size_t NumBlocks)
+{
+  auto It = FunctionCounters.find(Name);
+  if (It != FunctionCounters.end() && It->second.second == NumBlocks)
+    return It->second.first;
+
+  // A redefinition with a different shape gets fresh counters; the old ones
+  // stay alive because code from an earlier module may still be running.
+  CounterStorage.push_back(std::make_unique<uint64_t[]>(NumBlocks));
+  uint64_t *Counters = CounterStorage.back().get();
+  std::fill(Counters, Counters + NumBlocks, 0);
+  FunctionCounters[Name] = {Counters, NumBlocks};
+  return Counters;
+}
+
+void InstrumentFunction(Function &F)
+{
+  if (F.isDeclaration())
+    return;
+
+  uint64_t *Counters = getCounters(F.getName().str(), F.size());
+  Type *Int64Ty = Type::getInt64Ty(F.getContext());
+  Type *PtrTy = PointerType::getUnqual(F.getContext());
+
+  unsigned Idx = 0;
+  for (BasicBlock &BB : F)
+  {
+    BasicBlock::iterator IP = BB.getFirstInsertionPt();
+    // Keep the entry block's allocas together so mem2reg still sees them first.
+    while (IP != BB.end() && isa<AllocaInst>(*IP))
+      ++IP;
+
+    IRBuilder<> B(&BB, IP);
+    Value *Addr = B.CreateIntToPtr(
+        ConstantInt::get(Int64Ty, reinterpret_cast<uint64_t>(&Counters[Idx++])),
+        PtrTy);
+    // Atomic, since tanga and parallel pakati run the same blocks on pool
+    // threads; monotonic is enough for counts nobody reads until exit.
+    B.CreateAtomicRMW(AtomicRMWInst::Add, Addr, ConstantInt::get(Int64Ty, 1),
+                      MaybeAlign(8), AtomicOrdering::Monotonic);
+  }
+}
+
+void AttachProfileData(Function &F)
+{
+  auto It = LoadedProfile.find(F.getName().str());
+  if (It == LoadedProfile.end())
+    return;
+
+  const std::vector<uint64_t> &Counts = It->second;
+  // The script changed since the profile was taken; its counts don't apply.
+  if (Counts.size() != F.size())
+    return;
+
+  std::map<const BasicBlock *, uint64_t> BlockCounts;
+  unsigned Idx = 0;
+  for (BasicBlock &BB : F)
+    BlockCounts[&BB] = Counts[Idx++];
+
+  F.setEntryCount(Counts[0]);
+
+  MDBuilder MDB(F.getContext());
+  for (BasicBlock &BB : F)
+  {
+    auto *Br = dyn_cast_or_null<BranchInst>(BB.getTerminator());
+    if (!Br || !Br->isConditional())
+      continue;
+
+    uint64_t TrueCount = BlockCounts[Br->getSuccessor(0)];
+    uint64_t FalseCount = BlockCounts[Br->getSuccessor(1)];
+    if (TrueCount == 0 && FalseCount == 0)
+      continue;
+
+    // Branch weights are 32-bit; scale both sides down together.
+    uint64_t Scale = std::max(TrueCount, FalseCount) / UINT32_MAX + 1;
+    Br->setMetadata(LLVMContext::MD_prof,
+                    MDB.createBranchWeights(uint32_t(TrueCount / Scale),
+                                            uint32_t(FalseCount / Scale)));
+  }
+
+  // Sink blocks that never ran (error paths, untaken branches) below the
+  // ones that did, so the code that actually executes is contiguous.
+  if (Counts[0] == 0)
+    return;
+  std::vector<BasicBlock *> ColdBlocks;
+  for (BasicBlock &BB : F)
+    if (BlockCounts[&BB] == 0)
+      ColdBlocks.push_back(&BB);
+  for (BasicBlock *BB : ColdBlocks)
+    BB->moveAfter(&F.back());
+}
+
+void AttachProfileSummary(Module &M)
+{
+  if (LoadedProfile.empty())
+    return;
+
+  std::vector<uint64_t> AllCounts;
+  uint64_t MaxCount = 0, MaxFunctionCount = 0, TotalCount = 0;
+  for (const auto &[Name, Counts] : LoadedProfile)
+  {
+    if (Counts.empty())
+      continue;
+    MaxFunctionCount = std::max(MaxFunctionCount, Counts[0]);
+    for (uint64_t C : Counts)
+    {
+      AllCounts.push_back(C);
+      MaxCount = std::max(MaxCount, C);
+      TotalCount += C;
+    }
+  }
+  if (TotalCount == 0)
+    return;
+
+  // For every cutoff, the smallest count among the hottest blocks that
+  // together account for that fraction of all executions.
+  std::sort(AllCounts.begin(), AllCounts.end(), std::greater<uint64_t>());
+  SummaryEntryVector DetailedSummary;
+  uint64_t Sum = 0;
+  size_t Next = 0;
+  for (uint32_t Cutoff : ProfileSummaryBuilder::DefaultCutoffs)
+  {
+    uint64_t Target = uint64_t(double(TotalCount) * Cutoff / ProfileSummary::Scale);
+    while (Next < AllCounts.size() && Sum < Target)
+      Sum += AllCounts[Next++];
+    uint64_t MinCount = AllCounts[Next == 0 ? 0 : Next - 1];
+    DetailedSummary.emplace_back(Cutoff, MinCount, Next);
+  }
+
+  ProfileSummary PS(ProfileSummary::PSK_Instr, DetailedSummary, TotalCount,
+                    MaxCount, MaxCount, MaxFunctionCount, AllCounts.size(),
+                    LoadedProfile.size());
+  M.setProfileSummary(PS.getMD(M.getContext()), ProfileSummary::PSK_Instr);
+}
+
+// 0 = ran, 1 = no profile data, 2 = never ran (or already marked cold).
+static int getHotnessRank(const Function &F)
+{
+  if (F.hasFnAttribute(Attribute::Cold))
+    return 2;
+  auto Count = F.getEntryCount();
+  if (!Count)
+    return 1;
+  return Count->getCount() ? 0 : 2;
+}
+
+void LayOutFunctions(Module &M)
+{
+  std::vector<Function *> Defined;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Defined.push_back(&F);
+
+  // Hottest functions first, then the ones we know nothing about, then cold
+  // code (including the .cold parts that HotColdSplitting outlined).
+  std::stable_sort(Defined.begin(), Defined.end(), [](Function *A, Function *B) {
+    int RA = getHotnessRank(*A), RB = getHotnessRank(*B);
+    if (RA != RB)
+      return RA < RB;
+    if (RA == 0)
+      return A->getEntryCount()->getCount() > B->getEntryCount()->getCount();
+    return false;
+  });
+
+  // On ELF, named sections keep each group contiguous in JIT memory as well.
+  Triple TT(M.getTargetTriple().empty() ? sys::getProcessTriple()
+                                        : M.getTargetTriple());
+  bool UseSections = TT.isOSBinFormatELF();
+
+  for (Function *F : Defined)
+  {
+    int Rank = getHotnessRank(*F);
+    if (Rank == 2)
+      F->addFnAttr(Attribute::Cold);
+    if (UseSections && !F->hasSection() && Rank != 1)
+      F->setSection(Rank == 0 ? ".text.hot" : ".text.unlikely");
+
+    F->removeFromParent();
+    M.getFunctionList().push_back(F);
+  }
+}
+
+// The profile file is plain text:
+//
+//   # tino profile v1
+//   <function> <number of blocks>
+//   <count> <count> ...
+//
+// with one pair of lines per instrumented function.
+bool LoadProfile(const std::string &Path)
+{
+  std::ifstream In(Path);
+  if (!In.is_open())
+    return false;
+
+  std::string Line;
+  if (!std::getline(In, Line) || Line != "# tino profile v1")
+    return false;
+
+  std::string Name;
+  size_t NumBlocks;
+  while (In >> Name >> NumBlocks)
+  {
+    std::vector<uint64_t> Counts(NumBlocks);
+    for (uint64_t &C : Counts)
+      if (!(In >> C))
+        return false;
+    LoadedProfile[Name] = std::move(Counts);
+  }
+  return true;
+}
+
+bool WriteProfile(const std::string &Path)
+{
+  std::ofstream Out(Path, std::ios::trunc);
+  if (!Out.is_open())
+    return false;
+
+  Out << "# tino profile v1\n";
+  for (const auto &[Name, Counters] : FunctionCounters)
+  {
+    Out << Name << " " << Counters.second << "\n";
+    for (size_t I = 0; I != Counters.second; ++I)
+      Out << (I ? " " : "") << Counters.first[I];
+    Out << "\n";
+  }
+  return true;
+}
+
+bool HasProfileData() { return !LoadedProfile.empty(); }
@@ -0,0 +1,42 @@
+// Profile.h
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "../lexer/lexer.h"
+
+// Profile-guided optimization support.
+//
+// With --profile-generate every JIT'd function gets one execution counter per
+// basic block. The counters live in the tino process, so they survive the
+// per-statement modules that the JIT adds and removes, and are written to the
+// profile file when the script finishes.
+//
+// With --profile-use the counts are read back and attached to the IR produced
+// by FunctionAST::codegen as function entry counts and branch weights, which
+// block placement, the inliner and the loop unroller all consume.
+
+// Adds block counters to a freshly generated function.
+void InstrumentFunction(Function &F);
+
+// Attaches the loaded counts (if any) for F to its entry and branches, and
+// moves blocks that never executed to the end of F.
+void AttachProfileData(Function &F);
+
+// Records the whole-profile summary on M so ProfileSummaryInfo can classify
+// functions and call sites as hot or cold.
+void AttachProfileSummary(Module &M);
+
+// Orders M's functions hottest first and cold last, placing them in
+// .text.hot/.text.unlikely where the object format allows it.
+void LayOutFunctions(Module &M);
+
+// Reads a profile written by WriteProfile. Returns false if it can't be read.
+bool LoadProfile(const std::string &Path);
+
+// Writes all counters collected so far.
+bool WriteProfile(const std::string &Path);
+
+// True once LoadProfile has succeeded.
+bool HasProfileData();
+
+#endif // PROFILE_H
@@ -0,0 +1,84 @@
+#include "runtimelink.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Linker/Linker.h"
+
+#ifdef TINO_RUNTIME_BITCODE
+// Generated at build time by cmake/EmbedFile.cmake.
+extern const unsigned char TinoRuntimeBitcode[];
+extern const size_t TinoRuntimeBitcodeSize;
+#endif
+
+// Builtins larger than this are not worth a copy in every module that calls
+// them; the call into tino costs little next to their own work.
+static const unsigned MaxLinkedInstructions = 64;
+
+void LinkRuntime(Module &M)
+{
+#ifdef TINO_RUNTIME_BITCODE
+  MemoryBufferRef Buffer(
+      StringRef(reinterpret_cast<const char *>(TinoRuntimeBitcode),
+                TinoRuntimeBitcodeSize),
+      "runtime.bc");
+
+  // Each module gets its own lazily loaded copy in its own context; only the
+  // functions looked at below are ever read out of the bitcode.
+  auto RuntimeOrErr = getLazyBitcodeModule(Buffer, M.getContext());
+  if (!RuntimeOrErr)
+  {
+    logAllUnhandledErrors(RuntimeOrErr.takeError(), errs(), "runtime.bc: ");
+    return;
+  }
+  std::unique_ptr<Module> Runtime = std::move(*RuntimeOrErr);
+  Runtime->setTargetTriple(M.getTargetTriple());
+  Runtime->setDataLayout(M.getDataLayout());
+  if (NamedMDNode *Flags = Runtime->getModuleFlagsMetadata())
+    Runtime->eraseNamedMetadata(Flags);
+
+  std::vector<std::string> Linked;
+  for (Function &F : *Runtime)
+  {
+    if (F.isDeclaration() || F.hasLocalLinkage())
+      continue;
+
+    // LinkOnlyNeeded skips whatever M doesn't refer to, but a builtin M does
+    // call is dropped here if it's too big or M declared it differently.
+    Function *Decl = M.getFunction(F.getName());
+    if (!Decl || !Decl->isDeclaration())
+      continue;
+    if (Error Err = F.materialize())
+    {
+      consumeError(std::move(Err));
+      F.deleteBody();
+      continue;
+    }
+    if (Decl->getFunctionType() != F.getFunctionType() ||
+        F.getInstructionCount() > MaxLinkedInstructions)
+    {
+      F.deleteBody();
+      continue;
+    }
+
+    // clang tags the runtime with the build machine's CPU and features. Script
+    // functions carry none, and the inliner refuses callees that need features
+    // their caller lacks.
+    F.removeFnAttr("target-cpu");
+    F.removeFnAttr("target-features");
+    F.removeFnAttr("tune-cpu");
+    Linked.push_back(F.getName().str());
+  }
+  if (Linked.empty())
+    return;
+
+  if (Linker::linkModules(M, std::move(Runtime), Linker::Flags::LinkOnlyNeeded))
+  {
+    errs() << "runtime.bc: linking into " << M.getName() << " failed\n";
+    return;
+  }
+
+  // The JIT still has tino's own copy for anything outside this module, so
+  // these may be inlined everywhere and then deleted.
+  for (const std::string &Name : Linked)
+    if (Function *F = M.getFunction(Name))
+      F->setLinkage(GlobalValue::InternalLinkage);
+#endif
+}
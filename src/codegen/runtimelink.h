@@ -0,0 +1,14 @@
+// RuntimeLink.h
+#ifndef RUNTIMELINK_H
+#define RUNTIMELINK_H
+
+#include "../lexer/lexer.h"
+
+// Links the bodies of the small runtime builtins that M calls into M, from the
+// bitcode copy of runtime/runtime.cpp embedded in tino, so the optimizer can
+// inline them like script code. The linked copies are internal to M; larger
+// builtins stay calls into tino. Does nothing if tino was built without the
+// bitcode.
+void LinkRuntime(Module &M);
+
+#endif // RUNTIMELINK_H
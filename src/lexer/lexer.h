@@ -71,12 +71,12 @@ enum Token
   tok_new = -19,
   tok_this = -20,
   tok_extends = -21,
-  tok_public = -21,
   tok_private = -22,
   tok_dot = -23,  
   tok_arrow = -24, 
   tok_semicolon = -25,
   tok_globalvar = -26,
+  tok_public = -27,
 };
 
 extern std::ifstream InputFile;
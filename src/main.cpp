@@ -2,21 +2,25 @@
 #include "../ast/ast.h"
 #include "../parser/parser.h"
 #include "../codegen/codegen.h"
+#include "../codegen/profile.h"
+#include "../codegen/jitmemory.h"
+#include "../runtime/memory.h"
+#include "../runtime/runtime.h"
+#include "../runtime/kernels.h"
+#include "../runtime/parallel.h"
+#include "../runtime/channels.h"
 
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
 
 #define SHONALANG_VERSION "1.0.0"
 
-#ifdef _WIN32
-#define DLLEXPORT __declspec(dllexport)
-#else
-#define DLLEXPORT
-#endif
-
 extern "C" DLLEXPORT double putchard(double X)
 {
   fputc((char)X, stderr);
@@ -160,123 +164,168 @@ extern "C" DLLEXPORT void bvisaFaera(const char *filePath)
   }
 }
 
-extern "C" DLLEXPORT double wedzera(double a, double b) // Addition
-{  
-    double result = a+b;
-    return result;
-}
-
-extern "C" DLLEXPORT double bvisaNamba(double a, double b) // Subtraction
+/// Files streamed a number at a time, for files too big to read whole:
+/// vhuraFaeraKuverenga and vhuraFaeraKunyora open one, verengaNamba and
+/// nyoraNamba read and write the next number, and vharaFaera closes it.
+struct TinoFile
 {
-    double result = a-b;
-    return result;
-}
+  FILE *File;
+  const char *Builtin; // The one that opened it, for diagnostics.
+};
 
-extern "C" DLLEXPORT double wedzeranisa(double a, double b) // Multiplication
+static TinoFile *openStream(const char *Builtin, const char *filePath, const char *mode)
 {
-  double result = a*b;
-  return result;
+  FILE *File = filePath ? fopen(filePath, mode) : nullptr;
+  if (!File)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: '%s' haina kuvhura faera: %s\n", Builtin,
+            filePath ? filePath : "");
+    exit(1);
+  }
+  setvbuf(File, nullptr, _IOFBF, 1 << 16);
+  return new TinoFile{File, Builtin};
 }
 
-extern "C" DLLEXPORT double govana(double a, double b) // Division
-{
-    if (b == 0)
-    {
-        std::cerr << "Kukanganisa: Haugone kupatsanura ne zero!\n"; // Error: Cannot divide by zero
-        
-    }
-    double result = a/b;
-    return result;
-    
-}
-extern "C" DLLEXPORT double nambaInosara(double a, double b) // Modulus (Remainder)
+static FILE *openFileOf(const char *Builtin, TinoFile *F)
 {
-  double result = int(a)%int(b);
-  return result;
-  
+  if (!F || !F->File)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: '%s' yapihwa faera isina kuvhurwa\n", Builtin);
+    exit(1);
+  }
+  return F->File;
 }
 
-extern "C" DLLEXPORT double simba(double base, double exponent) // Power
+extern "C" DLLEXPORT TinoFile *vhuraFaeraKuverenga(const char *filePath)
 {
-  double result = pow(base,exponent);
-  return result;
+  return openStream("vhuraFaeraKuverenga", filePath, "r");
 }
 
-extern "C" DLLEXPORT double tsvagaMudzi(double value) // Square Root
+extern "C" DLLEXPORT TinoFile *vhuraFaeraKunyora(const char *filePath)
 {
-    if (value < 0)
-    {
-        std::cerr << "Kukanganisa: Haugone kutora mudzi wesikweya we nhamba isina kugadzikana!\n";
-     
-    }
-    double result = sqrt(value);
-    return result;
-   
+  return openStream("vhuraFaeraKunyora", filePath, "w");
 }
 
-extern "C" DLLEXPORT double logarithm(double value) // Natural Logarithm (ln)
+/// verengaNamba - The next number in the file (numbers are separated by
+/// spaces or new lines), or atEnd once there are no more.
+extern "C" DLLEXPORT double verengaNamba(TinoFile *F, double atEnd)
 {
-    if (value <= 0)
-    {
-        std::cerr << "Kukanganisa: Logarithm inoshanda pane nhamba huru kupfuura zero chete!\n";
-      
-    }
-    double result = log(value);
-    return result;
-    
+  double X;
+  return fscanf(openFileOf("verengaNamba", F), "%lf", &X) == 1 ? X : atEnd;
 }
 
-extern "C" DLLEXPORT double expo(double value) // Exponential (e^x)
+/// nyoraNamba - Writes X on a line of its own, with every digit it needs to
+/// be read back the same.
+extern "C" DLLEXPORT double nyoraNamba(TinoFile *F, double X)
 {
-  double result = exp(value);
-  return result;
-   
+  fprintf(openFileOf("nyoraNamba", F), "%.17g\n", X);
+  return 0;
 }
 
-// Trigonometric Functions
-extern "C" DLLEXPORT double  saini(double angle) // Sine
+extern "C" DLLEXPORT double vharaFaera(TinoFile *F)
 {
-  double result = sin(angle);
-  return result;
-  
+  fclose(openFileOf("vharaFaera", F));
+  F->File = nullptr;
+  return 0;
 }
 
-extern "C" DLLEXPORT double cosi(double angle) // Cosine
-{
-  double result = cos(angle);
-  return result;
-  
-}
 
-extern "C" DLLEXPORT double tanhi(double angle) // Tangent
+//===----------------------------------------------------------------------===//
+// Main driver code.
+//===----------------------------------------------------------------------===//
 
+/// ParseCommandLine - Fill in CompileOptions from the flags and return the
+/// script path, or an empty string if the command line is not usable.
+static std::string ParseCommandLine(int argc, char **argv)
 {
-  double result = tan(angle);
-  return result;
+  std::string Script;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string Arg = argv[i];
+    if (Arg.rfind("--", 0) != 0 && Arg.rfind("-O", 0) != 0)
+    {
+      Script = Arg;
+      continue;
+    }
 
+    if (Arg.size() == 3 && Arg[1] == 'O' && Arg[2] >= '0' && Arg[2] <= '3')
+      CompileOptions.OptLevel = Arg[2] - '0';
+    else if (Arg == "--profile-generate")
+      CompileOptions.ProfileGenerateFile = "default.tnprof";
+    else if (Arg.rfind("--profile-generate=", 0) == 0)
+      CompileOptions.ProfileGenerateFile = Arg.substr(strlen("--profile-generate="));
+    else if (Arg == "--huge-pages")
+      CompileOptions.HugePages = true;
+    else if (Arg == "--whole-program")
+      CompileOptions.WholeProgram = true;
+    else if (Arg == "--emit-llvm")
+      CompileOptions.EmitLLVM = true;
+    else if (Arg == "--march=native")
+      CompileOptions.NativeCPU = true;
+    else if (Arg == "--fast-math")
+      CompileOptions.FastMath = true;
+    else if (Arg.rfind("--simd=", 0) == 0)
+      CompileOptions.Simd = Arg.substr(strlen("--simd="));
+    else if (Arg == "--report-parallel")
+      CompileOptions.ReportParallel = true;
+    else if (Arg.rfind("--threads=", 0) == 0 &&
+             std::atoi(Arg.c_str() + strlen("--threads=")) > 0)
+      CompileOptions.Threads = std::atoi(Arg.c_str() + strlen("--threads="));
+    else if (Arg == "--profile-use")
+      CompileOptions.ProfileUseFile = "default.tnprof";
+    else if (Arg.rfind("--profile-use=", 0) == 0)
+      CompileOptions.ProfileUseFile = Arg.substr(strlen("--profile-use="));
+    else
+    {
+      std::cerr << "Sarudzo iyi haizivikanwi: " << Arg << std::endl;
+      return "";
+    }
+  }
+  return Script;
 }
 
-
-//===----------------------------------------------------------------------===//
-// Main driver code.
-//===----------------------------------------------------------------------===//
-
 int main(int argc, char **argv)
 {
-  if (argc < 2)
+  std::string Script = ParseCommandLine(argc, argv);
+  if (Script.empty())
   {
-    std::cerr << "Mashandisirwo : " << argv[0] << " <faera>" << std::endl;
+    std::cerr << "Mashandisirwo : " << argv[0]
+              << " [-O0..-O3] [--profile-generate[=faera]] [--profile-use[=faera]]"
+              << " [--huge-pages] [--whole-program] [--emit-llvm]"
+              << " [--march=native] [--fast-math] [--simd=scalar|sse2|avx2|avx512]"
+              << " [--threads=n] [--report-parallel]"
+              << " <faera>"
+              << std::endl;
     return 1;
   }
 
+  // The array builtins use the widest SIMD instructions this CPU has, unless
+  // --simd asks for narrower ones.
+  if (!SelectArrayKernels(CompileOptions.Simd.c_str()))
+  {
+    std::cerr << "--simd=" << CompileOptions.Simd
+              << " haizivikanwi kana kuti CPU iyi haina mirairo iyoyo" << std::endl;
+    return 1;
+  }
+
+  // 'pakati pamwe' loops and 'tanga' tasks run on this many threads.
+  SetParallelThreads(CompileOptions.Threads);
+
   // Open the input file using the global InputFile
-  InputFile.open(argv[1]);
+  InputFile.open(Script);
   if (!InputFile.is_open())
   {
-    std::cerr << "Faera iri ratadza kuvhurwa " << argv[1] << std::endl;
+    std::cerr << "Faera iri ratadza kuvhurwa " << Script << std::endl;
     return 1;
   }
 
+  if (!CompileOptions.ProfileUseFile.empty() &&
+      !LoadProfile(CompileOptions.ProfileUseFile))
+    std::cerr << "Profile iri ratadza kuverengwa " << CompileOptions.ProfileUseFile
+              << std::endl;
+
   // Initialize LLVM components
 
   InitializeNativeTarget();
@@ -284,6 +333,7 @@ int main(int argc, char **argv)
   InitializeNativeTargetAsmParser();
 
   // Install standard binary operators
+  BinopPrecedence['='] = 2;  // assignment, lowest
   BinopPrecedence['<'] = 10;
   BinopPrecedence['>'] = 10; // Set precedence for '>'
   BinopPrecedence['+'] = 20;
@@ -311,19 +361,180 @@ FunctionProtos["expo"] = std::make_unique<PrototypeAST>("expo", std::vector<std:
 FunctionProtos["saini"] = std::make_unique<PrototypeAST>("saini", std::vector<std::string>{"angle"});
 FunctionProtos["cosi"] = std::make_unique<PrototypeAST>("cosi", std::vector<std::string>{"angle"});
 FunctionProtos["tanhi"] = std::make_unique<PrototypeAST>("tanhi", std::vector<std::string>{"angle"});
+FunctionProtos["nguva"] = std::make_unique<PrototypeAST>("nguva", std::vector<std::string>{});
 
+    // Builtins that take or return objects: the class of each argument ("" for
+    // a number) and of the result.
+    auto AddObjectBuiltin = [](const std::string &Name, std::vector<std::string> Args,
+                               std::vector<std::string> ArgClasses,
+                               const std::string &ReturnClass = "")
+    {
+      auto Proto = std::make_unique<PrototypeAST>(Name, std::move(Args));
+      Proto->setArgClasses(std::move(ArgClasses));
+      Proto->setReturnClass(ReturnClass);
+      FunctionProtos[Name] = std::move(Proto);
+    };
+
+    // Whole-array kernels (runtime/kernels.h); array parameters are [double].
+    AddObjectBuiltin("arraySum", {"a"}, {"[double]"});
+    AddObjectBuiltin("arrayDot", {"a", "b"}, {"[double]", "[double]"});
+    AddObjectBuiltin("arrayMin", {"a"}, {"[double]"});
+    AddObjectBuiltin("arrayMax", {"a"}, {"[double]"});
+    AddObjectBuiltin("arrayScale", {"a", "k"}, {"[double]", ""});
+    AddObjectBuiltin("arrayAxpy", {"k", "x", "y"}, {"", "[double]", "[double]"});
+    for (const char *Name : {"arraySaini", "arrayCosi", "arrayExpo", "arrayLogarithm"})
+      AddObjectBuiltin(Name, {"a"}, {"[double]"});
+
+    // Matrices (runtime/matrix.h).
+    AddObjectBuiltin("matrix", {"rows", "cols"}, {"", ""}, "Matrix");
+    AddObjectBuiltin("matrixIdentity", {"n"}, {""}, "Matrix");
+    AddObjectBuiltin("matrixRows", {"m"}, {"Matrix"});
+    AddObjectBuiltin("matrixCols", {"m"}, {"Matrix"});
+    AddObjectBuiltin("matrixGet", {"m", "i", "j"}, {"Matrix", "", ""});
+    AddObjectBuiltin("matrixSet", {"m", "i", "j", "x"}, {"Matrix", "", "", ""});
+    for (const char *Name : {"matrixMul", "matrixSolve", "matrixAdd", "matrixSub",
+                             "matrixMulElements"})
+      AddObjectBuiltin(Name, {"a", "b"}, {"Matrix", "Matrix"}, "Matrix");
+    AddObjectBuiltin("matrixTranspose", {"a"}, {"Matrix"}, "Matrix");
+    AddObjectBuiltin("matrixScale", {"a", "k"}, {"Matrix", ""}, "Matrix");
+
+    // Futures (runtime/parallel.h): mirira(f) waits for 'tanga' task f.
+    AddObjectBuiltin("mirira", {"f"}, {"Future"});
+
+    // Channels between tasks (runtime/channels.h).
+    AddObjectBuiltin("channel", {"capacity"}, {""}, "Channel");
+    AddObjectBuiltin("channelSpsc", {"capacity"}, {""}, "Channel");
+    AddObjectBuiltin("channelSend", {"c", "x"}, {"Channel", ""});
+    AddObjectBuiltin("channelReceive", {"c", "atEnd"}, {"Channel", ""});
+    AddObjectBuiltin("channelClose", {"c"}, {"Channel"});
+    for (const char *Name : {"channelSendBatch", "channelReceiveBatch"})
+      AddObjectBuiltin(Name, {"c", "a", "start", "count"}, {"Channel", "[double]", "", ""});
+
+    // Files streamed a number at a time; the path is a string.
+    for (const char *Name : {"vhuraFaeraKuverenga", "vhuraFaeraKunyora"})
+      AddObjectBuiltin(Name, {"filePath"}, {"String"}, "Faera");
+    AddObjectBuiltin("verengaNamba", {"f", "atEnd"}, {"Faera", ""});
+    AddObjectBuiltin("nyoraNamba", {"f", "x"}, {"Faera", ""});
+    AddObjectBuiltin("vharaFaera", {"f"}, {"Faera"});
   };
 
   AddBuiltinFunctions();
 
+  // What each builtin may do to memory, so calls to it can be CSE'd, hoisted
+  // out of loops and vectorized around. The math builtins only compute
+  // (errno, which no script can read, is ignored); the ones that can print a
+  // diagnostic touch nothing but stderr.
+  auto AddBuiltinAttributes = []()
+  {
+    const unsigned Math = FA_NoMemory | FA_NoUnwind | FA_WillReturn | FA_NoFree;
+    const unsigned Reporting = FA_InaccessibleMem | FA_NoUnwind | FA_WillReturn;
+
+    for (const char *Name : {"wedzera", "bvisaNamba", "wedzeranisa", "nambaInosara",
+                             "simba", "expo", "saini", "cosi", "tanhi"})
+      FunctionProtos[Name]->addAttrs(Math);
+    for (const char *Name : {"govana", "tsvagaMudzi", "logarithm", "putchard"})
+      FunctionProtos[Name]->addAttrs(Reporting);
+
+    // The array reductions only read; arrayDot (like arrayAxpy) may end the
+    // script over mismatched lengths, so it is not willreturn.
+    for (const char *Name : {"arraySum", "arrayMin", "arrayMax"})
+      FunctionProtos[Name]->addAttrs(FA_ReadOnly | FA_NoUnwind | FA_WillReturn | FA_NoFree);
+    FunctionProtos["arrayDot"]->addAttrs(FA_ReadOnly | FA_NoUnwind | FA_NoFree);
+    for (const char *Name : {"arrayScale", "arraySaini", "arrayCosi", "arrayExpo",
+                             "arrayLogarithm"})
+      FunctionProtos[Name]->addAttrs(FA_NoUnwind | FA_WillReturn | FA_NoFree);
+    FunctionProtos["arrayAxpy"]->addAttrs(FA_NoUnwind | FA_NoFree);
+
+    // matrixGet and matrixSet end the script for an index outside the
+    // matrix; the ones that compute a new matrix allocate (and free their
+    // scratch space), so they promise nothing but not to unwind.
+    for (const char *Name : {"matrixRows", "matrixCols"})
+      FunctionProtos[Name]->addAttrs(FA_ReadOnly | FA_NoUnwind | FA_WillReturn | FA_NoFree);
+    FunctionProtos["matrixGet"]->addAttrs(FA_ReadOnly | FA_NoUnwind | FA_NoFree);
+    FunctionProtos["matrixSet"]->addAttrs(FA_NoUnwind | FA_NoFree);
+    for (const char *Name : {"matrix", "matrixIdentity", "matrixMul", "matrixSolve",
+                             "matrixAdd", "matrixSub", "matrixMulElements",
+                             "matrixTranspose", "matrixScale"})
+      FunctionProtos[Name]->addAttrs(FA_NoUnwind);
+
+    // Channel and stream builtins wait on other threads and do I/O; they
+    // only promise not to unwind.
+    for (const char *Name : {"channel", "channelSpsc", "channelSend", "channelReceive",
+                             "channelClose", "channelSendBatch", "channelReceiveBatch",
+                             "vhuraFaeraKuverenga", "vhuraFaeraKunyora", "verengaNamba",
+                             "nyoraNamba", "vharaFaera"})
+      FunctionProtos[Name]->addAttrs(FA_NoUnwind);
+
+    // nguva reads a clock no script can see; every call is a new reading.
+    FunctionProtos["nguva"]->addAttrs(FA_InaccessibleMem | FA_NoUnwind | FA_WillReturn);
+  };
+
+  AddBuiltinAttributes();
+
+  // Builtins the partial evaluator may call at compile time. They run the same
+  // code as at run time; arguments that would print a diagnostic (or crash)
+  // are left for run time so the program still behaves the same.
+  auto AddPureBuiltins = []()
+  {
+    using Args = const std::vector<double> &;
+    using Result = std::optional<double>;
+    auto InIntRange = [](double X) { return X > INT_MIN && X < INT_MAX; };
+
+    AddPureBuiltin("wedzera", 2, [](Args A) -> Result { return wedzera(A[0], A[1]); });
+    AddPureBuiltin("bvisaNamba", 2, [](Args A) -> Result { return bvisaNamba(A[0], A[1]); });
+    AddPureBuiltin("wedzeranisa", 2, [](Args A) -> Result { return wedzeranisa(A[0], A[1]); });
+    AddPureBuiltin("govana", 2, [](Args A) -> Result {
+      if (A[1] == 0)
+        return std::nullopt;
+      return govana(A[0], A[1]);
+    });
+    AddPureBuiltin("nambaInosara", 2, [InIntRange](Args A) -> Result {
+      if (!InIntRange(A[0]) || !InIntRange(A[1]) || int(A[1]) == 0)
+        return std::nullopt;
+      return nambaInosara(A[0], A[1]);
+    });
+    AddPureBuiltin("simba", 2, [](Args A) -> Result { return simba(A[0], A[1]); });
+    AddPureBuiltin("tsvagaMudzi", 1, [](Args A) -> Result {
+      if (A[0] < 0)
+        return std::nullopt;
+      return tsvagaMudzi(A[0]);
+    });
+    AddPureBuiltin("logarithm", 1, [](Args A) -> Result {
+      if (A[0] <= 0)
+        return std::nullopt;
+      return logarithm(A[0]);
+    });
+    AddPureBuiltin("expo", 1, [](Args A) -> Result { return expo(A[0]); });
+    AddPureBuiltin("saini", 1, [](Args A) -> Result { return saini(A[0]); });
+    AddPureBuiltin("cosi", 1, [](Args A) -> Result { return cosi(A[0]); });
+    AddPureBuiltin("tanhi", 1, [](Args A) -> Result { return tanhi(A[0]); });
+  };
+
+  AddPureBuiltins();
+
   getNextToken();
-  TheJIT = ExitOnErr(KaleidoscopeJIT::Create());
+  std::unique_ptr<SectionMemoryManager::MemoryMapper> JITMemory;
+  if (CompileOptions.HugePages)
+  {
+    SetHugePagesEnabled(true);
+    JITMemory = std::make_unique<HugePageMemoryMapper>();
+  }
+  TheJIT = ExitOnErr(KaleidoscopeJIT::Create(std::move(JITMemory),
+                                             CompileOptions.NativeCPU));
 
   // Initialize the module and managers
   InitializeModuleAndManagers();
 
-  // Run the main interpreter loop
-  MainLoop();
+  // Run the main interpreter loop, or compile the script as one module
+  if (CompileOptions.WholeProgram)
+    RunWholeProgram();
+  else
+    MainLoop();
+
+  if (!CompileOptions.ProfileGenerateFile.empty() &&
+      !WriteProfile(CompileOptions.ProfileGenerateFile))
+    std::cerr << "Profile iri ratadza kunyorwa " << CompileOptions.ProfileGenerateFile
+              << std::endl;
 
   // Close the input file
   InputFile.close();
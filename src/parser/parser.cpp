@@ -6,6 +6,16 @@ int getNextToken() { return CurTok = gettok(); }
 
 std::map<char, int> BinopPrecedence;
 
+// How many '{ }' bodies enclose the current token. 'zita' declares a global
+// only at depth 0; inside a basa or a block it declares a local variable.
+static int BodyDepth = 0;
+
+struct BodyScope
+{
+  BodyScope() { ++BodyDepth; }
+  ~BodyScope() { --BodyDepth; }
+};
+
  int GetTokPrecedence()
 {
   if (!isascii(CurTok))
@@ -67,6 +77,7 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
    if (CurTok != '{')
      return LogError("Inotarisirwa '{' kutanga muviri we 'kusvika'");
    getNextToken(); // Eat '{'
+   BodyScope Scope;
  
  
      std::vector<std::unique_ptr<ExprAST>> BodyExpressions;
@@ -108,17 +119,93 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
  }
  
 
+ // Names of the classes parsed so far. 'Name.x' is a member of the class
+// itself when Name is one of these, and a field of an object otherwise.
+static std::set<std::string> KnownClasses;
+
+/// arguments ::= '(' (expression (',' expression)*)? ')'
+static bool ParseArguments(std::vector<std::unique_ptr<ExprAST>> &Args)
+{
+  getNextToken(); // eat '('
+  if (CurTok != ')') {
+    while (true) {
+      if (auto Arg = ParseExpression())
+        Args.push_back(std::move(Arg));
+      else
+        return false;
+
+      if (CurTok == ')') break;
+      if (CurTok != ',') {
+        LogError("Panotarisirwa ',' or ')' mu list rema argument");
+        return false;
+      }
+
+      getNextToken();
+    }
+  }
+
+  getNextToken(); // eat ')'
+  return true;
+}
+
+/// arraytype ::= '[' ('double' | 'int' | classname) ']'
+///
+/// '[Point]' is a collection of Point records, stored a column per member.
+static bool ParseArrayType(std::string &TypeName)
+{
+  getNextToken(); // eat '['
+  if (CurTok != tok_identifier ||
+      (IdentifierStr != "double" && IdentifierStr != "int" &&
+       !KnownClasses.count(IdentifierStr))) {
+    LogError("Panotarisirwa 'double', 'int' kana zita rekirasi mukati me '[ ]'");
+    return false;
+  }
+  TypeName = "[" + IdentifierStr + "]";
+  getNextToken(); // eat the element type
+  if (CurTok != ']') {
+    LogError("Panotarisirwa ']'");
+    return false;
+  }
+  getNextToken(); // eat ']'
+  return true;
+}
+
+/// classannotation ::= ':' (identifier | arraytype)
+static bool ParseClassAnnotation(std::string &ClassName)
+{
+  getNextToken(); // eat ':'
+  if (CurTok == '[')
+    return ParseArrayType(ClassName);
+  if (CurTok != tok_identifier) {
+    LogError("Panotarisirwa zita rekirasi mushure me ':'");
+    return false;
+  }
+  ClassName = IdentifierStr;
+  getNextToken(); // eat the class name
+  return true;
+}
+
+/// spawnexpr ::= 'tanga' identifier arguments
+///
+/// 'tanga' is only a keyword before a call; anywhere else it is a name.
+static std::unique_ptr<ExprAST> ParseSpawnExpr()
+{
+  std::string Callee = IdentifierStr;
+  getNextToken(); // eat the function name
+  if (CurTok != '(')
+    return LogError("Panotarisirwa '(' mushure me 'tanga' ne zita re 'basa'");
+  std::vector<std::unique_ptr<ExprAST>> Args;
+  if (!ParseArguments(Args))
+    return nullptr;
+  return std::make_unique<SpawnExprAST>(Callee, std::move(Args));
+}
+
  std::unique_ptr<ExprAST> ParseIdentifierExpr() {
   std::string IdName = IdentifierStr;
   getNextToken(); // eat identifier
 
-  // Regular variable
-  if (CurTok != '(' && CurTok != '.') {
-    return std::make_unique<VariableExprAST>(IdName);
-  }
-
   // Handle Class access
-  if (CurTok == '.') {
+  if (CurTok == '.' && KnownClasses.count(IdName)) {
     getNextToken(); // eat '.'
 
   if (CurTok != tok_identifier)
@@ -135,27 +222,20 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
     }
 
     // Method access: Class.Method()
-    getNextToken(); // eat '('
     std::vector<std::unique_ptr<ExprAST>> Args;
+    if (!ParseArguments(Args))
+      return nullptr;
+    return std::make_unique<MethodCallExprAST>(nullptr, IdName, MemberName,
+                                               std::move(Args));
+  }
 
-    if (CurTok != ')') {
-      while (true) {
-        if (auto Arg = ParseExpression())
-          Args.push_back(std::move(Arg));
-        else
-          return nullptr;
-
-        if (CurTok == ')') break;
-        if (CurTok != ',')
-          return LogError("Panotarisirwa ',' or ')' mu list rema argument");
-
-        getNextToken();
-      }
-    }
+  // 'tanga f(args)'
+  if (IdName == "tanga" && CurTok == tok_identifier)
+    return ParseSpawnExpr();
 
-    getNextToken(); // eat ')'
-    std::string FullMethod = IdName + "." + MemberName;
-    return std::make_unique<CallExprAST>(FullMethod, std::move(Args));
+  // Regular variable
+  if (CurTok != '(') {
+    return std::make_unique<VariableExprAST>(IdName);
   }
 
   // Simple function call
@@ -181,7 +261,86 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
   return std::make_unique<CallExprAST>(IdName, std::move(Args));
 }
 
+/// memberaccess ::= primary ('.' identifier arguments? | '[' expression ']')*
+std::unique_ptr<ExprAST> ParseMemberAccess(std::unique_ptr<ExprAST> Object)
+{
+  while (Object && (CurTok == '.' || CurTok == '[')) {
+    if (CurTok == '[') {
+      getNextToken(); // eat '['
+      auto Index = ParseExpression();
+      if (!Index)
+        return nullptr;
+      if (CurTok != ']')
+        return LogError("Panotarisirwa ']'");
+      getNextToken(); // eat ']'
+      Object = std::make_unique<IndexExprAST>(std::move(Object), std::move(Index));
+      continue;
+    }
+
+    getNextToken(); // eat '.'
+    if (CurTok != tok_identifier)
+      return LogError("Panotarisirwa zita mushure me '.'");
+    std::string Name = IdentifierStr;
+    getNextToken();
+
+    if (CurTok != '(') {
+      Object = std::make_unique<MemberExprAST>(std::move(Object), Name);
+      continue;
+    }
+
+    std::vector<std::unique_ptr<ExprAST>> Args;
+    if (!ParseArguments(Args))
+      return nullptr;
+    Object = std::make_unique<MethodCallExprAST>(std::move(Object), "", Name,
+                                                 std::move(Args));
+  }
+  return Object;
+}
+
+/// newexpr ::= 'new' identifier arguments?
+///         ::= 'new' arraytype '(' expression ')'
+std::unique_ptr<ExprAST> ParseNewExpr()
+{
+  getNextToken(); // eat 'new'
+  if (CurTok == '[') {
+    std::string ArrayType;
+    if (!ParseArrayType(ArrayType))
+      return nullptr;
+    std::vector<std::unique_ptr<ExprAST>> Args;
+    if (CurTok != '(' || !ParseArguments(Args) || Args.size() != 1)
+      return LogError("Panotarisirwa urefu hwe array mu '( )'");
+    return std::make_unique<NewArrayExprAST>(ArrayType, std::move(Args[0]));
+  }
+  if (CurTok != tok_identifier)
+    return LogError("Panotarisirwa zita rekirasi mushure me 'new'");
+  std::string ClassName = IdentifierStr;
+  getNextToken(); // eat the class name
+
+  std::vector<std::unique_ptr<ExprAST>> Args;
+  if (CurTok == '(' && !ParseArguments(Args))
+    return nullptr;
+  return std::make_unique<NewExprAST>(ClassName, std::move(Args));
+}
 
+/// arrayexpr ::= '[' (expression (',' expression)*)? ']'
+std::unique_ptr<ExprAST> ParseArrayExpr()
+{
+  getNextToken(); // eat '['
+  std::vector<std::unique_ptr<ExprAST>> Elements;
+  while (CurTok != ']') {
+    auto Element = ParseExpression();
+    if (!Element)
+      return nullptr;
+    Elements.push_back(std::move(Element));
+    if (CurTok == ']')
+      break;
+    if (CurTok != ',')
+      return LogError("Panotarisirwa ',' kana ']' mu array");
+    getNextToken(); // eat ','
+  }
+  getNextToken(); // eat ']'
+  return std::make_unique<ArrayExprAST>(std::move(Elements));
+}
  
  /// ifexpr ::= 'if' expression 'then' expression 'else' expression
  /// ifexpr ::= 'if' '(' expression ')' '{' expression '}' ('else' '{' expression '}')?
@@ -204,6 +363,7 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
      if (CurTok != '{')
          return LogError("Panotarisirwa '{' ");
      getNextToken(); // Eat '{'
+     BodyScope Scope;
  
      std::vector<std::unique_ptr<ExprAST>> ThenStatements;
      while (CurTok != '}' && CurTok != tok_eof) {
@@ -229,6 +389,7 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
          if (CurTok != '{')
              return LogError("Panotarisirwa '{' mushure me 'kanakuti'");
          getNextToken(); // Eat '{'
+         BodyScope Scope;
  
          while (CurTok != '}' && CurTok != tok_eof) {
              if (auto E = ParseExpression()) {
@@ -260,10 +421,97 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
  
    return std::make_unique<ReturnExprAST>(std::move(RetVal));
  }
+ /// loopbody ::= '{' expression* '}'
+ static bool ParseLoopBody(std::vector<std::unique_ptr<ExprAST>> &BodyStmts) {
+  // Expect opening curly brace for the loop body.
+  if (CurTok != '{') {
+      LogError("Panotarisirwa '{' mushure me 'pakati ()'");
+      return false;
+  }
+  getNextToken(); // eat '{'.
+  BodyScope Scope;
+
+  // Parse multiple expressions inside the loop body.
+  while (CurTok != '}' && CurTok != tok_eof) {
+      auto Expr = ParseExpression();
+      if (!Expr)
+          return false;
+      BodyStmts.push_back(std::move(Expr));
+  }
+
+  if (CurTok != '}') {
+      LogError("Panotarisirwa '}' mushure me loop body");
+      return false;
+  }
+  getNextToken(); // eat '}'.
+  return true;
+ }
+
+ /// reductions ::= '(' reduction (',' reduction)* ')'
+ /// reduction  ::= ('+' | '*' | 'min' | 'max') ':' identifier
+ static bool ParseReductions(std::vector<LoopReduction> &Reductions) {
+  getNextToken(); // eat '('.
+  for (;;) {
+      LoopReduction::Kind Op;
+      if (CurTok == '+')
+          Op = LoopReduction::Add;
+      else if (CurTok == '*')
+          Op = LoopReduction::Mul;
+      else if (CurTok == tok_identifier && IdentifierStr == "min")
+          Op = LoopReduction::Min;
+      else if (CurTok == tok_identifier && IdentifierStr == "max")
+          Op = LoopReduction::Max;
+      else {
+          LogError("Panotarisirwa '+', '*', 'min' kana 'max' mu reduction ye 'pakati pamwe'");
+          return false;
+      }
+      getNextToken(); // eat the operator.
+
+      if (CurTok != ':') {
+          LogError("Panotarisirwa ':' mushure me operator ye reduction");
+          return false;
+      }
+      getNextToken(); // eat ':'.
+
+      if (CurTok != tok_identifier) {
+          LogError("Panotarisirwa 'zita' re reduction");
+          return false;
+      }
+      for (auto &R : Reductions)
+          if (R.Var == IdentifierStr) {
+              LogError(("'" + IdentifierStr + "' yatove ne reduction").c_str());
+              return false;
+          }
+      Reductions.push_back({IdentifierStr, Op});
+      getNextToken(); // eat identifier.
+
+      if (CurTok == ')')
+          break;
+      if (CurTok != ',') {
+          LogError("Panotarisirwa ',' kana ')' mu reductions");
+          return false;
+      }
+      getNextToken(); // eat ','.
+  }
+  getNextToken(); // eat ')'.
+  return true;
+ }
+
  /// forexpr ::= 'for' identifier '=' expr ',' expr (',' expr)? 'in' expression
+ ///         ::= 'pakati' '(' identifier 'mu' expression ')' loopbody
+ ///         ::= 'pakati' 'pamwe' '(' identifier '=' expr ',' expr (',' expr)? ')'
+ ///             reductions? loopbody
  std::unique_ptr<ExprAST> ParseForExpr() {
+  int Line = CurrentLine;
   getNextToken(); // eat 'for'
 
+  // 'pakati pamwe' runs its iterations in parallel.
+  bool Parallel = false;
+  if (CurTok == tok_identifier && IdentifierStr == "pamwe") {
+      Parallel = true;
+      getNextToken(); // eat 'pamwe'.
+  }
+
   if (CurTok != '(')
       return LogError("Panotarisirwa '(' mushure me 'pakati'");
   getNextToken(); // eat '('.
@@ -275,6 +523,25 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
   std::string IdName = IdentifierStr;
   getNextToken(); // eat identifier.
 
+  // 'pakati (x mu a) { ... }' visits the elements of an array.
+  if (CurTok == tok_in) {
+      if (Parallel)
+          return LogError("'pakati pamwe' inoda (zita = kutanga, kupera)");
+      getNextToken(); // eat 'mu'.
+      auto Array = ParseExpression();
+      if (!Array)
+          return nullptr;
+      if (CurTok != ')')
+          return LogError("Panotarisirwa ')'");
+      getNextToken(); // eat ')'.
+
+      std::vector<std::unique_ptr<ExprAST>> BodyStmts;
+      if (!ParseLoopBody(BodyStmts))
+          return nullptr;
+      return std::make_unique<ForInExprAST>(IdName, std::move(Array),
+                                            std::move(BodyStmts));
+  }
+
   if (CurTok != '=')
       return LogError("Panotarisirwa '=' mushure me 'zita' mu 'pakati ()'");
   getNextToken(); // eat '='.
@@ -304,29 +571,23 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
       return LogError("Panotarisirwa ')'");
   getNextToken(); // eat ')'.
 
-  // Expect opening curly brace for the loop body.
-  if (CurTok != '{')
-      return LogError("Panotarisirwa '{' mushure me 'pakati ()'");
-  getNextToken(); // eat '{'.
+  std::vector<LoopReduction> Reductions;
+  if (Parallel && CurTok == '(' && !ParseReductions(Reductions))
+      return nullptr;
 
-  // Parse multiple expressions inside the loop body.
   std::vector<std::unique_ptr<ExprAST>> BodyStmts;
-  while (CurTok != '}' && CurTok != tok_eof) {
-      auto Expr = ParseExpression();
-      if (!Expr)
-          return nullptr;
-      BodyStmts.push_back(std::move(Expr));
-  }
-
-  if (CurTok != '}')
-      return LogError("Panotarisirwa '}' mushure me loop body");
-  getNextToken(); // eat '}'.
+  if (!ParseLoopBody(BodyStmts))
+      return nullptr;
 
   // Create a BlockExprAST to store multiple statements.
   auto Body = std::make_unique<BlockExprAST>(std::move(BodyStmts));
 
-  return std::make_unique<ForExprAST>(IdName, std::move(Start), std::move(End),
-                                      std::move(Step), std::move(Body));
+  auto For = std::make_unique<ForExprAST>(IdName, std::move(Start), std::move(End),
+                                          std::move(Step), std::move(Body));
+  For->setLine(Line);
+  if (Parallel)
+      For->setParallel(std::move(Reductions));
+  return For;
 }
 
  
@@ -392,7 +653,14 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
       std::string Name = IdentifierStr;
       getNextToken(); // eat identifier
 
+      // 'zita p: Point' holds an object, and no object until one is assigned.
       std::unique_ptr<ExprAST> Init = nullptr;
+      std::string ClassName;
+      if (CurTok == ':') {
+          if (!ParseClassAnnotation(ClassName))
+              return nullptr;
+          Init = std::make_unique<NullObjectExprAST>(ClassName);
+      }
       if (CurTok == '=') {
           getNextToken(); // eat '='
           Init = ParseExpression();
@@ -407,7 +675,11 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
       if (CurTok != tok_identifier)
           return LogError("Panotarisirwa zita pamberi pe comma");
   }
-  
+
+  // A declaration inside a body lives until the end of that body.
+  if (BodyDepth > 0)
+      return std::make_unique<VarExprAST>(std::move(Vars), nullptr);
+
   return std::make_unique<GlobalVarExprAST>(std::move(Vars));
 }
  /// primary
@@ -417,6 +689,9 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
  ///   ::= ifexpr
  ///   ::= forexpr
  ///   ::= varexpr
+ ///   ::= 'this'
+ ///   ::= newexpr
+ ///   ::= arrayexpr
   std::unique_ptr<ExprAST> ParsePrimary()
  {
    switch (CurTok)
@@ -425,13 +700,23 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
      return LogError("Paita izwi risiri kuzivikanwa");
    }
    case tok_identifier:
-     return ParseIdentifierExpr();
+     return ParseMemberAccess(ParseIdentifierExpr());
+
+   case tok_this:
+     getNextToken(); // eat 'this'
+     return ParseMemberAccess(std::make_unique<ThisExprAST>());
+
+   case tok_new:
+     return ParseMemberAccess(ParseNewExpr());
  
    case tok_number:
      return ParseNumberExpr();
  
    case '(':
-     return ParseParenExpr();
+     return ParseMemberAccess(ParseParenExpr());
+
+   case '[':
+     return ParseMemberAccess(ParseArrayExpr());
  
    case tok_if:
      return ParseIfExpr();
@@ -468,7 +753,7 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
   std::unique_ptr<ExprAST> ParseUnary()
  {
    // If the current token is not an operator, it must be a primary expr.
-   if (!isascii(CurTok) || CurTok == '(' || CurTok == ',')
+   if (!isascii(CurTok) || CurTok == '(' || CurTok == '[' || CurTok == ',')
      return ParsePrimary();
  
    // If this is a unary operator, read it.
@@ -526,6 +811,18 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
   
   std::string ClassName = IdentifierStr;
   getNextToken(); // eat class name
+  // Known from here on, so methods can name their own class.
+  KnownClasses.insert(ClassName);
+
+  // kirasi Circle extends Shape { ... }
+  std::string BaseName;
+  if (CurTok == tok_extends) {
+      getNextToken(); // eat 'extends'
+      if (CurTok != tok_identifier)
+          return LogErrorC("Panotarisirwa zita rekirasi mushure me 'extends'");
+      BaseName = IdentifierStr;
+      getNextToken(); // eat base class name
+  }
 
   if (CurTok != '{') {
       return LogErrorC("Panotarisirwa '{' pamberi pezita rekirasi");
@@ -534,11 +831,23 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
 
   std::vector<std::unique_ptr<FunctionAST>> Methods;
   std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> Members;
+  std::set<std::string> PrivateNames;
 
 
   while (CurTok != '}' && CurTok != tok_eof) {
+      // Members and methods are public unless declared 'private'.
+      bool IsPrivate = false;
+      if (CurTok == tok_public || CurTok == tok_private) {
+          IsPrivate = CurTok == tok_private;
+          getNextToken(); // eat 'public' / 'private'
+          if (CurTok != tok_def && CurTok != tok_globalvar)
+              return LogErrorC("Panotarisirwa 'basa' kana 'zita' mushure me 'public' kana 'private'");
+      }
+
       if (CurTok == tok_def) {
           if (auto Fn = ParseDefinition()) {
+              if (IsPrivate)
+                  PrivateNames.insert(Fn->getName());
               Methods.push_back(std::move(Fn));
           } else {
               return nullptr;
@@ -555,11 +864,19 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
         getNextToken();
         
         std::unique_ptr<ExprAST> Init = nullptr;
+        std::string MemberClass;
+        if (CurTok == ':') {
+            if (!ParseClassAnnotation(MemberClass))
+                return nullptr;
+            Init = std::make_unique<NullObjectExprAST>(MemberClass);
+        }
         if (CurTok == '=') {
             getNextToken();
             Init = ParseExpression();
         }
         
+        if (IsPrivate)
+            PrivateNames.insert(VarName);
         Members.emplace_back(VarName, std::move(Init));
     }
 
@@ -573,7 +890,8 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
   }
   getNextToken(); // eat '}'
 
-  return std::make_unique<ClassAST>(ClassName, std::move(Methods),std::move(Members));
+  return std::make_unique<ClassAST>(ClassName, std::move(Methods),std::move(Members),
+                                    BaseName, std::move(PrivateNames));
 }
 
  
@@ -622,8 +940,20 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
      return LogErrorP("Panotarisirwa '('");
  
    std::vector<std::string> ArgNames;
-   while (getNextToken() == tok_identifier)
+   std::vector<std::string> ArgClasses;
+   getNextToken(); // eat '('.
+   while (CurTok == tok_identifier) {
      ArgNames.push_back(IdentifierStr);
+     getNextToken();
+     // An object argument names its class: basa f(p: Point)
+     std::string ArgClass;
+     if (CurTok == ':' && !ParseClassAnnotation(ArgClass))
+       return nullptr;
+     ArgClasses.push_back(ArgClass);
+     // Arguments may be separated by commas: basa f(a, b)
+     if (CurTok == ',')
+       getNextToken();
+   }
    if (CurTok != ')')
       return LogErrorP("Panotarisirwa ')'");
  
@@ -634,8 +964,10 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
    if (Kind && ArgNames.size() != Kind)
      return LogErrorP("Invalid number of operands for operator");
  
-   return std::make_unique<PrototypeAST>(FnName, ArgNames, Kind != 0,
-                                         BinaryPrecedence);
+   auto Proto = std::make_unique<PrototypeAST>(FnName, ArgNames, Kind != 0,
+                                               BinaryPrecedence);
+   Proto->setArgClasses(std::move(ArgClasses));
+   return Proto;
  }
  
  /// definition ::= 'def' prototype expression
@@ -648,10 +980,12 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
      auto Proto = ParsePrototype();
      if (!Proto)
          return nullptr;
+     Proto->setInternal();
  
      if (CurTok != '{')
          return LogErrorF("Panotarisirwa '{' kutanga muviri we 'basa'");
      getNextToken(); // Eat '{'
+     BodyScope Scope;
  
      std::vector<std::unique_ptr<ExprAST>> BodyExpressions;
  
@@ -710,8 +1044,100 @@ static std::unique_ptr<ExprAST> ParseNumberExpr()
 }
  
  /// external ::= 'extern' prototype
+/// externattrs ::= '[' identifier (',' identifier)* ']'
+static bool ParseExternAttrs(unsigned &Attrs)
+{
+  static const std::map<std::string, unsigned> Names = {
+      {"pure", FA_NoMemory},         {"readonly", FA_ReadOnly},
+      {"nounwind", FA_NoUnwind},     {"willreturn", FA_WillReturn},
+      {"nofree", FA_NoFree}};
+
+  getNextToken(); // eat '['.
+  while (CurTok == tok_identifier)
+  {
+    auto It = Names.find(IdentifierStr);
+    if (It == Names.end())
+    {
+      LogError(("Hunhu uhu hahuzivikanwi pa 'extern': " + IdentifierStr).c_str());
+      return false;
+    }
+    Attrs |= It->second;
+    if (getNextToken() == ',')
+      getNextToken();
+  }
+  if (CurTok != ']')
+  {
+    LogError("Panotarisirwa ']'");
+    return false;
+  }
+  getNextToken(); // eat ']'.
+  return true;
+}
+
+/// external ::= 'extern' externattrs? prototype
+///   extern [pure, nounwind, willreturn] hypot(x, y)
   std::unique_ptr<PrototypeAST> ParseExtern()
  {
    getNextToken(); // eat extern.
-   return ParsePrototype();
- }
\ No newline at end of file
+   unsigned Attrs = FA_None;
+   if (CurTok == '[' && !ParseExternAttrs(Attrs))
+     return nullptr;
+   auto Proto = ParsePrototype();
+   if (Proto)
+     Proto->addAttrs(Attrs);
+   return Proto;
+ }
+
+/// program ::= (definition | class | extern | globalvar | expression)*
+std::unique_ptr<ProgramAST> ParseProgram()
+{
+  auto Program = std::make_unique<ProgramAST>();
+
+  while (CurTok != tok_eof)
+  {
+    switch (CurTok)
+    {
+    case ';':
+      getNextToken(); // Skip empty statement
+      break;
+
+    case tok_def:
+      if (auto Fn = ParseDefinition())
+        Program->Functions.push_back(std::move(Fn));
+      else
+        getNextToken(); // Skip token for error recovery.
+      break;
+
+    case tok_class:
+      getNextToken(); // eat 'kirasi'
+      if (auto Class = ParseClass())
+        Program->Classes.push_back(std::move(Class));
+      else
+        getNextToken();
+      break;
+
+    case tok_extern:
+      if (auto Proto = ParseExtern())
+        Program->Externs.push_back(std::move(Proto));
+      else
+        getNextToken();
+      break;
+
+    case tok_globalvar:
+      if (auto Global = ParseGlobalVarExpr())
+        Program->TopLevel.push_back(std::move(Global));
+      else
+        getNextToken();
+      break;
+
+    default:
+      if (auto E = ParseExpression())
+        Program->TopLevel.push_back(std::move(E));
+      else
+        getNextToken();
+      break;
+    }
+  }
+
+  return Program;
+}
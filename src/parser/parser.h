@@ -45,6 +45,8 @@ std::unique_ptr<PrototypeAST> ParseExtern();
 std::unique_ptr<FunctionAST> ParseTopLevelExpr();
 std::unique_ptr<ExprAST> ParseMemberAccess(std::unique_ptr<ExprAST> Object);
 std::unique_ptr<ExprAST> ParseNewExpr() ;
+std::unique_ptr<ExprAST> ParseArrayExpr();
+std::unique_ptr<ProgramAST> ParseProgram();
 
 
 #endif // PARSER_H
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "arrays.h"
+#include "memory.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t ArrayAlign = 64;
+
+static size_t roundUp(size_t N, size_t Align)
+{
+  return (N + Align - 1) / Align * Align;
+}
+
+/// allocateAligned - With --huge-pages, an array of 2 MiB or more gets a
+/// large region of its own (see memory.h), so walking it doesn't miss in
+/// the TLB every 4 KiB. Arrays are never freed, like objects.
+static void *allocateAligned(size_t Size)
+{
+  void *P;
+  if (HugePagesEnabled() && Size >= HugePageSize)
+    P = AllocateLargeRegion(Size, false);
+  else
+#ifdef _WIN32
+    P = _aligned_malloc(Size, ArrayAlign);
+#else
+    P = aligned_alloc(ArrayAlign, Size);
+#endif
+  if (!P)
+  {
+    fputs("Kukanganisa: ndangariro yapera\n", stderr); // Out of memory
+    abort();
+  }
+  return P;
+}
+
+/// tooLarge - End the script over an array whose size in bytes doesn't fit
+/// in a size_t.
+[[noreturn]] static void tooLarge(int64_t Length)
+{
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: array ine urefu %lld yakakura zvakanyanya\n",
+          (long long)Length);
+  exit(1);
+}
+
+// The most elements one column of an array can hold: its bytes, rounded up
+// to a cache line, plus the header (or padding) line still fit in a size_t.
+static const size_t MaxElements = (SIZE_MAX - 2 * ArrayAlign) / sizeof(double);
+
+extern "C" DLLEXPORT TinoArray *tino_array_new(int64_t Length)
+{
+  if (Length < 0)
+    Length = 0;
+  if (uint64_t(Length) > MaxElements)
+    tooLarge(Length);
+
+  // One allocation: the header in the first cache line, the elements from
+  // the second on.
+  size_t DataSize = roundUp(size_t(Length) * sizeof(double), ArrayAlign);
+  char *Block = static_cast<char *>(allocateAligned(ArrayAlign + DataSize));
+  memset(Block + ArrayAlign, 0, DataSize);
+
+  auto *Array = reinterpret_cast<TinoArray *>(Block);
+  Array->Data = Block + ArrayAlign;
+  Array->Length = Length;
+  return Array;
+}
+
+extern "C" DLLEXPORT TinoArray *tino_records_new(int64_t Columns, int64_t Length,
+                                                 const double *Defaults)
+{
+  if (Length < 0)
+    Length = 0;
+  // Columns is the record class's field count, never near overflowing the
+  // table; Length is checked like an array's, then against all the columns.
+  if (uint64_t(Length) > MaxElements)
+    tooLarge(Length);
+
+  // The header, the column table, then the columns. Each column is padded
+  // by an extra cache line so that columns walked in step don't all map to
+  // the same cache sets when their size is a multiple of the page size.
+  size_t TableSize = roundUp(size_t(Columns) * sizeof(void *), ArrayAlign);
+  size_t ColumnStride =
+      roundUp(size_t(Length) * sizeof(double), ArrayAlign) + ArrayAlign;
+  if (size_t(Columns) > (SIZE_MAX - ArrayAlign - TableSize) / ColumnStride)
+    tooLarge(Length);
+  char *Block = static_cast<char *>(
+      allocateAligned(ArrayAlign + TableSize + size_t(Columns) * ColumnStride));
+
+  auto *Records = reinterpret_cast<TinoArray *>(Block);
+  void **Table = reinterpret_cast<void **>(Block + ArrayAlign);
+  Records->Data = Table;
+  Records->Length = Length;
+  for (int64_t c = 0; c < Columns; ++c)
+  {
+    char *Column = Block + ArrayAlign + TableSize + size_t(c) * ColumnStride;
+    Table[c] = Column;
+    if (Defaults)
+      std::fill_n(reinterpret_cast<double *>(Column), Length, Defaults[c]);
+    else
+      memset(Column, 0, size_t(Length) * sizeof(double));
+  }
+  return Records;
+}
+
+extern "C" DLLEXPORT void tino_array_bounds_error(int64_t Index, int64_t Length)
+{
+  fflush(stdout);
+  fprintf(stderr,
+          "Kukanganisa: index %lld iri kunze kwe mutsara une urefu %lld\n",
+          (long long)Index, (long long)Length);
+  exit(1);
+}
+
+// Through tino_printf, so an array printed inside a parallel loop comes out
+// in order too.
+extern "C" DLLEXPORT void tino_array_print(const TinoArray *Array, int64_t Kind)
+{
+  tino_printf("[");
+  for (int64_t i = 0; i < Array->Length; ++i)
+  {
+    if (i)
+      tino_printf(", ");
+    if (Kind == TinoArrayInt)
+      tino_printf("%lld", (long long)static_cast<const int64_t *>(Array->Data)[i]);
+    else
+      tino_printf("%.5f", static_cast<const double *>(Array->Data)[i]);
+  }
+  tino_printf("]\n");
+}
@@ -0,0 +1,52 @@
+// Arrays.h
+#ifndef RUNTIME_ARRAYS_H
+#define RUNTIME_ARRAYS_H
+
+#include "runtime.h"
+#include <cstdint>
+
+// Arrays of numbers. An array is a fixed-length run of 8-byte elements,
+// either doubles ([double]) or 64-bit integers ([int]), behind a small
+// header. Generated code reads the header fields directly (see
+// codegen.cpp), so this layout is part of the ABI between the two.
+//
+// The elements start on a 64-byte boundary, a cache line and the widest
+// vector register, so vectorized loops over an array never split a load.
+//
+// A collection of kirasi records ([Point]) has the same header, but stores
+// its records column by column: every member has its own array-like run of
+// elements, so a loop over one member touches only that member's memory.
+
+struct TinoArray
+{
+  void *Data;     // First element, 64-byte aligned.
+  int64_t Length; // Number of elements; never changes.
+};
+
+enum TinoArrayKind : int64_t
+{
+  TinoArrayDouble = 0,
+  TinoArrayInt = 1,
+};
+
+extern "C"
+{
+  // Returns a zero-filled array of Length elements. Never returns null.
+  DLLEXPORT TinoArray *tino_array_new(int64_t Length);
+
+  // Returns a collection of Length records with Columns members each, laid
+  // out as columns: the header's Data points at a table of Columns column
+  // pointers, and column c holds member c of every record, 64-byte aligned.
+  // Column c starts filled with Defaults[c], or with zeros if Defaults is
+  // null. Never returns null.
+  DLLEXPORT TinoArray *tino_records_new(int64_t Columns, int64_t Length,
+                                        const double *Defaults);
+
+  // Reports an index outside [0, Length) and ends the script.
+  DLLEXPORT void tino_array_bounds_error(int64_t Index, int64_t Length);
+
+  // Prints the elements of an array of the given TinoArrayKind, as 'nyora' does.
+  DLLEXPORT void tino_array_print(const TinoArray *Array, int64_t Kind);
+}
+
+#endif // RUNTIME_ARRAYS_H
@@ -0,0 +1,367 @@
+#include "channels.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define TINO_SPIN_PAUSE() _mm_pause()
+#else
+#define TINO_SPIN_PAUSE() ((void)0)
+#endif
+
+// The largest capacity a channel can be given.
+static const int64_t MaxChannelCapacity = int64_t(1) << 30;
+
+// How a blocked end waits: this many spins, then yields until
+// YieldMicroseconds have gone by, then naps of NapMicroseconds.
+static const unsigned SpinsBeforeYield = 128;
+static const int64_t YieldMicroseconds = 200;
+static const int64_t NapMicroseconds = 50;
+
+// How often a blocked end asks the pool for another worker.
+static const int64_t StuckCheckMicroseconds = 1000;
+
+/// TinoChannel - What the two kinds of channel share. trySend and
+/// tryReceive move as many of N numbers as they can without waiting, and
+/// return how many that was.
+struct TinoChannel
+{
+  int64_t Capacity; // A power of two.
+  int64_t Mask;     // Capacity - 1.
+  std::atomic<bool> Closed{false};
+
+  explicit TinoChannel(int64_t Capacity) : Capacity(Capacity), Mask(Capacity - 1) {}
+  virtual ~TinoChannel() = default;
+
+  virtual int64_t trySend(const double *X, int64_t N) = 0;
+  virtual int64_t tryReceive(double *X, int64_t N) = 0;
+};
+
+namespace {
+
+/// SpscChannel - Lamport's ring buffer for one sender and one receiver. Tail
+/// is written only by the sender and Head only by the receiver, each on its
+/// own cache line; each end keeps its last look at the other's index and
+/// reads the shared one again only when that look says it must wait.
+class alignas(64) SpscChannel : public TinoChannel
+{
+  std::unique_ptr<double[]> Slots;
+
+  alignas(64) std::atomic<int64_t> Tail{0}; // Next slot to write.
+  int64_t SeenHead = 0;                     // The sender's.
+
+  alignas(64) std::atomic<int64_t> Head{0}; // Next slot to read.
+  int64_t SeenTail = 0;                     // The receiver's.
+
+public:
+  explicit SpscChannel(int64_t Capacity)
+      : TinoChannel(Capacity), Slots(new double[Capacity]) {}
+
+  int64_t trySend(const double *X, int64_t N) override
+  {
+    int64_t T = Tail.load(std::memory_order_relaxed);
+    if (T + N - SeenHead > Capacity)
+      SeenHead = Head.load(std::memory_order_acquire);
+    int64_t K = std::min(N, Capacity - (T - SeenHead));
+    for (int64_t i = 0; i < K; ++i)
+      Slots[(T + i) & Mask] = X[i];
+    if (K)
+      Tail.store(T + K, std::memory_order_release);
+    return K;
+  }
+
+  int64_t tryReceive(double *X, int64_t N) override
+  {
+    int64_t H = Head.load(std::memory_order_relaxed);
+    if (SeenTail - H < N)
+      SeenTail = Tail.load(std::memory_order_acquire);
+    int64_t K = std::min(N, SeenTail - H);
+    for (int64_t i = 0; i < K; ++i)
+      X[i] = Slots[(H + i) & Mask];
+    if (K)
+      Head.store(H + K, std::memory_order_release);
+    return K;
+  }
+};
+
+/// MpmcChannel - Vyukov's bounded MPMC queue. Every slot has a sequence
+/// number saying whose turn it is: slot p & Mask is free for the sender of
+/// message p when its sequence is p, and holds message p for its receiver
+/// when it is p + 1. A sender claims messages by moving SendPos on with a
+/// CAS, then fills the slots and hands each over by storing its sequence;
+/// receivers do the same with ReceivePos. A batch claims the run of slots
+/// that are ready with one CAS.
+class alignas(64) MpmcChannel : public TinoChannel
+{
+  struct Slot
+  {
+    std::atomic<int64_t> Seq;
+    double X;
+  };
+
+  std::unique_ptr<Slot[]> Slots;
+
+  alignas(64) std::atomic<int64_t> SendPos{0};
+  alignas(64) std::atomic<int64_t> ReceivePos{0};
+
+  /// ready - How many slots from Pos on, up to N, have sequence Pos + i +
+  /// Ahead; -1 if the first has an older one (the buffer is full, for a
+  /// sender, or empty, for a receiver), 0 if a newer (someone else took it).
+  int64_t ready(int64_t Pos, int64_t N, int64_t Ahead) const
+  {
+    int64_t K = 0;
+    while (K < N)
+    {
+      int64_t Diff = Slots[(Pos + K) & Mask].Seq.load(std::memory_order_acquire) -
+                     (Pos + K + Ahead);
+      if (Diff != 0)
+        return K ? K : (Diff < 0 ? -1 : 0);
+      ++K;
+    }
+    return K;
+  }
+
+public:
+  explicit MpmcChannel(int64_t Capacity) : TinoChannel(Capacity), Slots(new Slot[Capacity])
+  {
+    for (int64_t i = 0; i < Capacity; ++i)
+      Slots[i].Seq.store(i, std::memory_order_relaxed);
+  }
+
+  int64_t trySend(const double *X, int64_t N) override
+  {
+    int64_t Pos = SendPos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      int64_t K = ready(Pos, N, 0);
+      if (K < 0)
+        return 0;
+      if (K == 0)
+        Pos = SendPos.load(std::memory_order_relaxed);
+      else if (SendPos.compare_exchange_weak(Pos, Pos + K, std::memory_order_relaxed))
+      {
+        for (int64_t i = 0; i < K; ++i)
+        {
+          Slot &S = Slots[(Pos + i) & Mask];
+          S.X = X[i];
+          S.Seq.store(Pos + i + 1, std::memory_order_release);
+        }
+        return K;
+      }
+    }
+  }
+
+  int64_t tryReceive(double *X, int64_t N) override
+  {
+    int64_t Pos = ReceivePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      int64_t K = ready(Pos, N, 1);
+      if (K < 0)
+        return 0;
+      if (K == 0)
+        Pos = ReceivePos.load(std::memory_order_relaxed);
+      else if (ReceivePos.compare_exchange_weak(Pos, Pos + K, std::memory_order_relaxed))
+      {
+        for (int64_t i = 0; i < K; ++i)
+        {
+          Slot &S = Slots[(Pos + i) & Mask];
+          X[i] = S.X;
+          S.Seq.store(Pos + i + Capacity, std::memory_order_release);
+        }
+        return K;
+      }
+    }
+  }
+};
+
+/// Backoff - One wait on a channel, called each time the channel still
+/// isn't ready. The other end is usually about to act, so it spins first;
+/// a long wait naps so as not to hold a core. Once it has gone on a while
+/// it counts as blocked, and now and then makes sure there's a worker free
+/// to run the task it is waiting for.
+class Backoff
+{
+  typedef std::chrono::steady_clock Clock;
+
+  unsigned Spins = 0;
+  bool Blocking = false;
+  Clock::time_point Started, NextCheck;
+
+public:
+  ~Backoff()
+  {
+    if (Blocking)
+      EndBlockingWait();
+  }
+
+  void wait()
+  {
+    if (Spins < SpinsBeforeYield)
+    {
+      ++Spins;
+      TINO_SPIN_PAUSE();
+      return;
+    }
+
+    Clock::time_point Now = Clock::now();
+    if (!Blocking)
+    {
+      Blocking = true;
+      Started = Now;
+      NextCheck = Now + std::chrono::microseconds(StuckCheckMicroseconds);
+      BeginBlockingWait();
+    }
+    else if (Now >= NextCheck)
+    {
+      NextCheck = Now + std::chrono::microseconds(StuckCheckMicroseconds);
+      AddWorkerIfStuck();
+    }
+
+    if (Now - Started < std::chrono::microseconds(YieldMicroseconds))
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(NapMicroseconds));
+  }
+};
+
+} // end anonymous namespace
+
+/// A capacity or count given as a number: whole, and negative (or NaN) as 0.
+static int64_t toCount(double X)
+{
+  if (!(X > 0))
+    return 0;
+  return X < 9.0e15 ? int64_t(X) : int64_t(9.0e15);
+}
+
+static void channelError(const char *Builtin, const char *Problem)
+{
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: '%s' %s\n", Builtin, Problem);
+  exit(1);
+}
+
+static void CheckChannel(const char *Builtin, const TinoChannel *C)
+{
+  if (!C)
+    channelError(Builtin, "yapihwa channel isipo");
+}
+
+static int64_t roundCapacity(const char *Builtin, double Capacity)
+{
+  int64_t N = toCount(Capacity);
+  if (N > MaxChannelCapacity)
+    channelError(Builtin, "channel yakakura zvakanyanya");
+  int64_t Size = 1;
+  while (Size < N)
+    Size *= 2;
+  return Size;
+}
+
+/// CheckRange - A batch's elements must all be in the array.
+static void CheckRange(const char *Builtin, const TinoArray *A, int64_t Start, int64_t Count)
+{
+  if (!A)
+    channelError(Builtin, "yapihwa array isipo");
+  if (Start + Count > A->Length)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: '%s' %lld kusvika %lld iri kunze kwe mutsara une urefu %lld\n",
+            Builtin, (long long)Start, (long long)(Start + Count), (long long)A->Length);
+    exit(1);
+  }
+}
+
+/// sendAll - Send X[0, N), waiting whenever the channel is full.
+static void sendAll(const char *Builtin, TinoChannel *C, const double *X, int64_t N)
+{
+  if (C->Closed.load(std::memory_order_relaxed))
+    channelError(Builtin, "yatumira channel yakavharwa");
+  Backoff B;
+  while (N)
+  {
+    int64_t K = C->trySend(X, N);
+    X += K;
+    N -= K;
+    if (N && !K)
+      B.wait();
+  }
+}
+
+/// receiveSome - Receive up to N numbers into X once there is one; 0 once
+/// the channel is closed and empty.
+static int64_t receiveSome(TinoChannel *C, double *X, int64_t N)
+{
+  Backoff B;
+  for (;;)
+  {
+    if (int64_t K = C->tryReceive(X, N))
+      return K;
+    // Everything sent before the close is in the buffer by the time the
+    // close is seen.
+    if (C->Closed.load(std::memory_order_acquire))
+      return C->tryReceive(X, N);
+    B.wait();
+  }
+}
+
+extern "C" DLLEXPORT TinoChannel *channel(double Capacity)
+{
+  return new MpmcChannel(roundCapacity("channel", Capacity));
+}
+
+extern "C" DLLEXPORT TinoChannel *channelSpsc(double Capacity)
+{
+  return new SpscChannel(roundCapacity("channelSpsc", Capacity));
+}
+
+extern "C" DLLEXPORT double channelSend(TinoChannel *C, double X)
+{
+  CheckChannel("channelSend", C);
+  // Most sends find room straight away.
+  if (C->Closed.load(std::memory_order_relaxed) || !C->trySend(&X, 1))
+    sendAll("channelSend", C, &X, 1);
+  return 0;
+}
+
+extern "C" DLLEXPORT double channelReceive(TinoChannel *C, double AtEnd)
+{
+  CheckChannel("channelReceive", C);
+  double X;
+  return receiveSome(C, &X, 1) ? X : AtEnd;
+}
+
+extern "C" DLLEXPORT double channelClose(TinoChannel *C)
+{
+  CheckChannel("channelClose", C);
+  C->Closed.store(true, std::memory_order_release);
+  return 0;
+}
+
+extern "C" DLLEXPORT double channelSendBatch(TinoChannel *C, const TinoArray *A,
+                                             double Start, double Count)
+{
+  CheckChannel("channelSendBatch", C);
+  int64_t First = toCount(Start), N = toCount(Count);
+  CheckRange("channelSendBatch", A, First, N);
+  sendAll("channelSendBatch", C, static_cast<const double *>(A->Data) + First, N);
+  return 0;
+}
+
+extern "C" DLLEXPORT double channelReceiveBatch(TinoChannel *C, TinoArray *A, double Start,
+                                                double Count)
+{
+  CheckChannel("channelReceiveBatch", C);
+  int64_t First = toCount(Start), N = toCount(Count);
+  CheckRange("channelReceiveBatch", A, First, N);
+  if (!N)
+    return 0;
+  return double(receiveSome(C, static_cast<double *>(A->Data) + First, N));
+}
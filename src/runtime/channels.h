@@ -0,0 +1,62 @@
+// Channels.h
+#ifndef RUNTIME_CHANNELS_H
+#define RUNTIME_CHANNELS_H
+
+#include "runtime.h"
+#include "arrays.h"
+#include <cstdint>
+
+// Bounded channels of numbers, for passing work between 'tanga' tasks: a
+// reader task sends what it reads, worker tasks receive it, and so on down a
+// pipeline. A channel is a ring buffer whose capacity is rounded up to a
+// power of two; neither end ever takes a lock.
+//
+//   channel(n)      any number of senders and receivers, each slot carrying
+//                   a sequence number (Vyukov's bounded MPMC queue)
+//   channelSpsc(n)  one sending task and one receiving task at a time,
+//                   which is cheaper still: each end owns its index and only
+//                   looks at the other's when the buffer seems full (or empty)
+//
+// Sending to a full channel, or receiving from an empty one, waits: spinning
+// briefly, then yielding, then napping. A thread of the pool that waits
+// counts as blocked, and while tasks are queued and too few workers are free
+// to start them, the pool starts more (see AddWorkerIfStuck), so a pipeline
+// runs whatever --threads is.
+//
+// The batch builtins move a run of an array's elements with one update of
+// the shared indices, rather than one per number.
+//
+// Channels, like objects, are never freed.
+
+struct TinoChannel;
+
+extern "C"
+{
+  // A channel for up to Capacity numbers at a time.
+  DLLEXPORT TinoChannel *channel(double Capacity);
+  DLLEXPORT TinoChannel *channelSpsc(double Capacity);
+
+  // Sends X, waiting while the channel is full. Returns 0. Sending to a
+  // closed channel ends the script.
+  DLLEXPORT double channelSend(TinoChannel *C, double X);
+
+  // The oldest number in the channel, waiting while it is empty; AtEnd once
+  // the channel is closed and empty.
+  DLLEXPORT double channelReceive(TinoChannel *C, double AtEnd);
+
+  // No more numbers will be sent; receivers get what is left, then their
+  // AtEnd. Returns 0.
+  DLLEXPORT double channelClose(TinoChannel *C);
+
+  // Sends A[Start], ..., A[Start + Count - 1], in order. Returns 0.
+  DLLEXPORT double channelSendBatch(TinoChannel *C, const TinoArray *A, double Start,
+                                    double Count);
+
+  // Receives up to Count numbers into A[Start], A[Start + 1], ...: whatever
+  // is there once at least one is. Returns how many it received, 0 once the
+  // channel is closed and empty.
+  DLLEXPORT double channelReceiveBatch(TinoChannel *C, TinoArray *A, double Start,
+                                       double Count);
+}
+
+#endif // RUNTIME_CHANNELS_H
@@ -0,0 +1,211 @@
+#include "kernels_impl.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(TINO_X86_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+/// Scalar - One double at a time, for CPUs without one of the vector sets
+/// (and --simd=scalar).
+struct Scalar
+{
+  using Reg = double;
+  using Mask = bool;
+  static constexpr int Width = 1;
+  // 4 x 4 doubles, in sixteen scalar registers.
+  static constexpr int GemmRows = 4;
+  static constexpr int GemmVectors = 4;
+
+  static uint64_t bits(double X)
+  {
+    uint64_t B;
+    memcpy(&B, &X, sizeof(B));
+    return B;
+  }
+  static double fromBits(uint64_t B)
+  {
+    double X;
+    memcpy(&X, &B, sizeof(X));
+    return X;
+  }
+
+  static Reg load(const double *P) { return *P; }
+  static void store(double *P, Reg X) { *P = X; }
+  static Reg set1(double X) { return X; }
+  static Reg add(Reg A, Reg B) { return A + B; }
+  static Reg sub(Reg A, Reg B) { return A - B; }
+  static Reg mul(Reg A, Reg B) { return A * B; }
+  static Reg div(Reg A, Reg B) { return A / B; }
+  static Reg fmadd(Reg A, Reg B, Reg C) { return A * B + C; }
+  static Reg min(Reg A, Reg B) { return A < B ? A : B; }
+  static Reg max(Reg A, Reg B) { return A > B ? A : B; }
+  static Reg floor(Reg X) { return std::floor(X); }
+
+  static Reg bitAnd(Reg A, Reg B) { return fromBits(bits(A) & bits(B)); }
+  static Reg bitOr(Reg A, Reg B) { return fromBits(bits(A) | bits(B)); }
+  static Reg bitXor(Reg A, Reg B) { return fromBits(bits(A) ^ bits(B)); }
+  static Reg shiftLeft52(Reg X) { return fromBits(bits(X) << 52); }
+  static Reg shiftRight52(Reg X) { return fromBits(bits(X) >> 52); }
+
+  static Mask lt(Reg A, Reg B) { return A < B; }
+  static Mask le(Reg A, Reg B) { return A <= B; }
+  static Mask ge(Reg A, Reg B) { return A >= B; }
+  static Mask eq(Reg A, Reg B) { return A == B; }
+  static Mask both(Mask A, Mask B) { return A && B; }
+  static bool all(Mask M) { return M; }
+  static Reg select(Mask M, Reg A, Reg B) { return M ? A : B; }
+
+  static double hsum(Reg X) { return X; }
+  static double hmin(Reg X) { return X; }
+  static double hmax(Reg X) { return X; }
+};
+
+} // end anonymous namespace
+
+static const KernelSet ScalarKernels = MakeKernelSet<Scalar>("scalar");
+
+// Until SelectArrayKernels runs, the builtins work one element at a time.
+static const KernelSet *ActiveKernels = &ScalarKernels;
+
+#ifdef TINO_X86_KERNELS
+// The CPU must have the instructions, and the OS must save the wider
+// registers on a context switch (the XCR0 bits).
+
+static bool CpuHasAvx2()
+{
+#ifdef _MSC_VER
+  int R[4];
+  __cpuid(R, 1);
+  bool Fma = R[2] & (1 << 12), OsXSave = R[2] & (1 << 27), Avx = R[2] & (1 << 28);
+  if (!Fma || !OsXSave || !Avx || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+  __cpuidex(R, 7, 0);
+  return R[1] & (1 << 5);
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+static bool CpuHasAvx512()
+{
+#ifdef _MSC_VER
+  if (!CpuHasAvx2())
+    return false;
+  int R[4];
+  __cpuidex(R, 7, 0);
+  return (R[1] & (1 << 16)) && (_xgetbv(0) & 0xE6) == 0xE6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif
+
+bool SelectArrayKernels(const char *Name)
+{
+  struct Candidate
+  {
+    const KernelSet *Set;
+    bool Supported;
+  };
+  // Widest first, so an empty name picks the best the CPU has.
+  const Candidate Candidates[] = {
+#ifdef TINO_X86_KERNELS
+      {&Avx512Kernels, CpuHasAvx512()},
+      {&Avx2Kernels, CpuHasAvx2()},
+      {&Sse2Kernels, true},
+#endif
+      {&ScalarKernels, true},
+  };
+
+  for (const Candidate &C : Candidates)
+    if (C.Supported && (!*Name || strcmp(Name, C.Set->Name) == 0))
+    {
+      ActiveKernels = C.Set;
+      return true;
+    }
+  return false;
+}
+
+const char *ArrayKernelsName() { return ActiveKernels->Name; }
+
+const KernelSet &ArrayKernels() { return *ActiveKernels; }
+
+static double *Elements(const TinoArray *A) { return static_cast<double *>(A->Data); }
+
+/// CheckSameLength - The two-array builtins work element by element, so the
+/// arrays must line up; like an index out of bounds, anything else ends the
+/// script.
+static void CheckSameLength(const char *Builtin, const TinoArray *A, const TinoArray *B)
+{
+  if (A->Length == B->Length)
+    return;
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: '%s' inoda arrays dzine urefu hwakaenzana (%lld ne %lld)\n",
+          Builtin, (long long)A->Length, (long long)B->Length);
+  exit(1);
+}
+
+extern "C" DLLEXPORT double arraySum(const TinoArray *A)
+{
+  return ActiveKernels->Sum(Elements(A), A->Length);
+}
+
+extern "C" DLLEXPORT double arrayDot(const TinoArray *A, const TinoArray *B)
+{
+  CheckSameLength("arrayDot", A, B);
+  return ActiveKernels->Dot(Elements(A), Elements(B), A->Length);
+}
+
+extern "C" DLLEXPORT double arrayMin(const TinoArray *A)
+{
+  return ActiveKernels->Min(Elements(A), A->Length);
+}
+
+extern "C" DLLEXPORT double arrayMax(const TinoArray *A)
+{
+  return ActiveKernels->Max(Elements(A), A->Length);
+}
+
+extern "C" DLLEXPORT double arrayScale(TinoArray *A, double K)
+{
+  ActiveKernels->Scale(Elements(A), A->Length, K);
+  return 0;
+}
+
+extern "C" DLLEXPORT double arrayAxpy(double K, const TinoArray *X, TinoArray *Y)
+{
+  CheckSameLength("arrayAxpy", X, Y);
+  ActiveKernels->Axpy(K, Elements(X), Elements(Y), Y->Length);
+  return 0;
+}
+
+extern "C" DLLEXPORT double arraySaini(TinoArray *A)
+{
+  ActiveKernels->Sin(Elements(A), A->Length);
+  return 0;
+}
+
+extern "C" DLLEXPORT double arrayCosi(TinoArray *A)
+{
+  ActiveKernels->Cos(Elements(A), A->Length);
+  return 0;
+}
+
+extern "C" DLLEXPORT double arrayExpo(TinoArray *A)
+{
+  ActiveKernels->Exp(Elements(A), A->Length);
+  return 0;
+}
+
+extern "C" DLLEXPORT double arrayLogarithm(TinoArray *A)
+{
+  ActiveKernels->Log(Elements(A), A->Length);
+  return 0;
+}
@@ -0,0 +1,77 @@
+// Kernels.h
+#ifndef RUNTIME_KERNELS_H
+#define RUNTIME_KERNELS_H
+
+#include "arrays.h"
+#include <cstdint>
+
+// Whole-array numeric builtins. Each one is a single call that runs a SIMD
+// loop over the array, instead of one call (or one scalar iteration) per
+// element.
+//
+// The loops are compiled once per instruction set, in kernels_sse2.cpp,
+// kernels_avx2.cpp and kernels_avx512.cpp, from the templates in
+// kernels_impl.h. At startup SelectArrayKernels picks the widest set the CPU
+// (and the OS) supports; the builtins call through it.
+
+extern "C"
+{
+  // Reductions. Sums are accumulated in several partial sums at once, so the
+  // last bits may differ from adding the elements one by one in order.
+  DLLEXPORT double arraySum(const TinoArray *A);
+  DLLEXPORT double arrayDot(const TinoArray *A, const TinoArray *B);
+  DLLEXPORT double arrayMin(const TinoArray *A); // +inf for an empty array
+  DLLEXPORT double arrayMax(const TinoArray *A); // -inf for an empty array
+
+  // In place: A = A * K, and Y = Y + K * X. Return 0.
+  DLLEXPORT double arrayScale(TinoArray *A, double K);
+  DLLEXPORT double arrayAxpy(double K, const TinoArray *X, TinoArray *Y);
+
+  // In place, element by element, the same as saini, cosi, expo and
+  // logarithm (including logarithm's diagnostic). Return 0.
+  DLLEXPORT double arraySaini(TinoArray *A);
+  DLLEXPORT double arrayCosi(TinoArray *A);
+  DLLEXPORT double arrayExpo(TinoArray *A);
+  DLLEXPORT double arrayLogarithm(TinoArray *A);
+}
+
+/// KernelSet - The loops behind the builtins, for one instruction set.
+struct KernelSet
+{
+  const char *Name;
+  double (*Sum)(const double *A, int64_t N);
+  double (*Dot)(const double *A, const double *B, int64_t N);
+  double (*Min)(const double *A, int64_t N);
+  double (*Max)(const double *A, int64_t N);
+  void (*Scale)(double *A, int64_t N, double K);
+  void (*Axpy)(double K, const double *X, double *Y, int64_t N);
+  void (*Sin)(double *A, int64_t N);
+  void (*Cos)(double *A, int64_t N);
+  void (*Exp)(double *A, int64_t N);
+  void (*Log)(double *A, int64_t N);
+
+  // C += A * B for one GemmRows x GemmCols tile of C, from panels of A and B
+  // packed as matrix.cpp does.
+  int GemmRows;
+  int GemmCols;
+  void (*GemmTile)(int64_t K, const double *A, const double *B, double *C, int64_t Ldc);
+};
+
+#ifdef TINO_X86_KERNELS
+extern const KernelSet Sse2Kernels;
+extern const KernelSet Avx2Kernels;
+extern const KernelSet Avx512Kernels;
+#endif
+
+// Use the kernels for the named instruction set ("scalar", "sse2", "avx2" or
+// "avx512"), or the widest supported one if Name is empty. Returns false,
+// leaving the choice alone, if the name is unknown or the CPU lacks it.
+bool SelectArrayKernels(const char *Name);
+
+// The name of the instruction set the builtins currently use.
+const char *ArrayKernelsName();
+
+// The kernels the builtins currently use.
+const KernelSet &ArrayKernels();
+
+#endif // RUNTIME_KERNELS_H
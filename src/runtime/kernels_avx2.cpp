@@ -0,0 +1,72 @@
+#include "kernels_impl.h"
+#include <immintrin.h>
+
+// The array kernels for AVX2 with FMA. This file is compiled with those
+// instructions enabled (see CMakeLists.txt); nothing in it runs unless
+// SelectArrayKernels found them on the CPU.
+
+namespace {
+
+struct Avx2
+{
+  using Reg = __m256d;
+  using Mask = __m256d;
+  static constexpr int Width = 4;
+  // 6 x 8 doubles: twelve accumulators, two rows of B and a broadcast of A
+  // fill fifteen of the sixteen ymm registers.
+  static constexpr int GemmRows = 6;
+  static constexpr int GemmVectors = 2;
+
+  static Reg load(const double *P) { return _mm256_loadu_pd(P); }
+  static void store(double *P, Reg X) { _mm256_storeu_pd(P, X); }
+  static Reg set1(double X) { return _mm256_set1_pd(X); }
+  static Reg add(Reg A, Reg B) { return _mm256_add_pd(A, B); }
+  static Reg sub(Reg A, Reg B) { return _mm256_sub_pd(A, B); }
+  static Reg mul(Reg A, Reg B) { return _mm256_mul_pd(A, B); }
+  static Reg div(Reg A, Reg B) { return _mm256_div_pd(A, B); }
+  static Reg fmadd(Reg A, Reg B, Reg C) { return _mm256_fmadd_pd(A, B, C); }
+  static Reg min(Reg A, Reg B) { return _mm256_min_pd(A, B); }
+  static Reg max(Reg A, Reg B) { return _mm256_max_pd(A, B); }
+  static Reg floor(Reg X) { return _mm256_floor_pd(X); }
+
+  static Reg bitAnd(Reg A, Reg B) { return _mm256_and_pd(A, B); }
+  static Reg bitOr(Reg A, Reg B) { return _mm256_or_pd(A, B); }
+  static Reg bitXor(Reg A, Reg B) { return _mm256_xor_pd(A, B); }
+  static Reg shiftLeft52(Reg X)
+  {
+    return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(X), 52));
+  }
+  static Reg shiftRight52(Reg X)
+  {
+    return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(X), 52));
+  }
+
+  static Mask lt(Reg A, Reg B) { return _mm256_cmp_pd(A, B, _CMP_LT_OQ); }
+  static Mask le(Reg A, Reg B) { return _mm256_cmp_pd(A, B, _CMP_LE_OQ); }
+  static Mask ge(Reg A, Reg B) { return _mm256_cmp_pd(A, B, _CMP_GE_OQ); }
+  static Mask eq(Reg A, Reg B) { return _mm256_cmp_pd(A, B, _CMP_EQ_OQ); }
+  static Mask both(Mask A, Mask B) { return _mm256_and_pd(A, B); }
+  static bool all(Mask M) { return _mm256_movemask_pd(M) == 0xF; }
+  static Reg select(Mask M, Reg A, Reg B) { return _mm256_blendv_pd(B, A, M); }
+
+  // Fold the upper half onto the lower, then the upper lane onto the lower.
+  static double hsum(Reg X)
+  {
+    __m128d H = _mm_add_pd(_mm256_castpd256_pd128(X), _mm256_extractf128_pd(X, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(H, _mm_unpackhi_pd(H, H)));
+  }
+  static double hmin(Reg X)
+  {
+    __m128d H = _mm_min_pd(_mm256_castpd256_pd128(X), _mm256_extractf128_pd(X, 1));
+    return _mm_cvtsd_f64(_mm_min_sd(H, _mm_unpackhi_pd(H, H)));
+  }
+  static double hmax(Reg X)
+  {
+    __m128d H = _mm_max_pd(_mm256_castpd256_pd128(X), _mm256_extractf128_pd(X, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(H, _mm_unpackhi_pd(H, H)));
+  }
+};
+
+} // end anonymous namespace
+
+extern const KernelSet Avx2Kernels = MakeKernelSet<Avx2>("avx2");
@@ -0,0 +1,72 @@
+#include "kernels_impl.h"
+#include <immintrin.h>
+
+// The array kernels for AVX-512F. This file is compiled with those
+// instructions enabled (see CMakeLists.txt); nothing in it runs unless
+// SelectArrayKernels found them on the CPU.
+
+namespace {
+
+struct Avx512
+{
+  using Reg = __m512d;
+  using Mask = __mmask8;
+  static constexpr int Width = 8;
+  // 8 x 24 doubles: twenty-four accumulators of the thirty-two zmm
+  // registers.
+  static constexpr int GemmRows = 8;
+  static constexpr int GemmVectors = 3;
+
+  static Reg load(const double *P) { return _mm512_loadu_pd(P); }
+  static void store(double *P, Reg X) { _mm512_storeu_pd(P, X); }
+  static Reg set1(double X) { return _mm512_set1_pd(X); }
+  static Reg add(Reg A, Reg B) { return _mm512_add_pd(A, B); }
+  static Reg sub(Reg A, Reg B) { return _mm512_sub_pd(A, B); }
+  static Reg mul(Reg A, Reg B) { return _mm512_mul_pd(A, B); }
+  static Reg div(Reg A, Reg B) { return _mm512_div_pd(A, B); }
+  static Reg fmadd(Reg A, Reg B, Reg C) { return _mm512_fmadd_pd(A, B, C); }
+  static Reg min(Reg A, Reg B) { return _mm512_min_pd(A, B); }
+  static Reg max(Reg A, Reg B) { return _mm512_max_pd(A, B); }
+  static Reg floor(Reg X)
+  {
+    return _mm512_roundscale_pd(X, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+
+  // AVX-512F only has the bitwise operations on integer vectors.
+  static Reg bitAnd(Reg A, Reg B)
+  {
+    return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(A), _mm512_castpd_si512(B)));
+  }
+  static Reg bitOr(Reg A, Reg B)
+  {
+    return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(A), _mm512_castpd_si512(B)));
+  }
+  static Reg bitXor(Reg A, Reg B)
+  {
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(A), _mm512_castpd_si512(B)));
+  }
+  static Reg shiftLeft52(Reg X)
+  {
+    return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(X), 52));
+  }
+  static Reg shiftRight52(Reg X)
+  {
+    return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(X), 52));
+  }
+
+  static Mask lt(Reg A, Reg B) { return _mm512_cmp_pd_mask(A, B, _CMP_LT_OQ); }
+  static Mask le(Reg A, Reg B) { return _mm512_cmp_pd_mask(A, B, _CMP_LE_OQ); }
+  static Mask ge(Reg A, Reg B) { return _mm512_cmp_pd_mask(A, B, _CMP_GE_OQ); }
+  static Mask eq(Reg A, Reg B) { return _mm512_cmp_pd_mask(A, B, _CMP_EQ_OQ); }
+  static Mask both(Mask A, Mask B) { return A & B; }
+  static bool all(Mask M) { return M == 0xFF; }
+  static Reg select(Mask M, Reg A, Reg B) { return _mm512_mask_blend_pd(M, B, A); }
+
+  static double hsum(Reg X) { return _mm512_reduce_add_pd(X); }
+  static double hmin(Reg X) { return _mm512_reduce_min_pd(X); }
+  static double hmax(Reg X) { return _mm512_reduce_max_pd(X); }
+};
+
+} // end anonymous namespace
+
+extern const KernelSet Avx512Kernels = MakeKernelSet<Avx512>("avx512");
@@ -0,0 +1,363 @@
+// Kernels_impl.h
+#ifndef RUNTIME_KERNELS_IMPL_H
+#define RUNTIME_KERNELS_IMPL_H
+
+#include "kernels.h"
+#include "runtime.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// The array kernels, written once against a vector type V and instantiated
+// by each kernels_<isa>.cpp with its own V, compiled for that instruction
+// set. Everything here is a member of Kernels<V>, so instantiations for
+// different instruction sets never share (and the linker never merges) a
+// definition. For the same reason nothing here calls an inline function
+// from the standard library; lanes the vector code can't handle go to the
+// runtime's own scalar builtins instead.
+//
+// V provides, for a register Reg of Width doubles and a lane mask Mask:
+//   load, store, set1, add, sub, mul, div, fmadd (a * b + c), min, max,
+//   floor (of values below 2^51 in magnitude), bitAnd, bitOr, bitXor,
+//   shiftLeft52 and shiftRight52 (of the 64-bit patterns), lt, le, ge, eq,
+//   both (mask and), all (every lane set), select (m ? a : b), and the
+//   horizontal hsum, hmin and hmax; and the shape of its matrix multiply
+//   register tile, GemmRows rows of GemmVectors registers each.
+//
+// exp, sin and cos use the Cephes library's approximations and log fdlibm's;
+// all are within about one and a half units in the last place of the C
+// library over the inputs they are used for here.
+
+template <class V> struct Kernels
+{
+  using Reg = typename V::Reg;
+  static constexpr int W = V::Width;
+  static constexpr double Inf = std::numeric_limits<double>::infinity();
+  static constexpr double MinNormal = std::numeric_limits<double>::min();
+  static constexpr double MaxFinite = std::numeric_limits<double>::max();
+
+  static Reg Bits(uint64_t Pattern)
+  {
+    double D;
+    memcpy(&D, &Pattern, sizeof(D));
+    return V::set1(D);
+  }
+
+  /// Horner's rule with the coefficients highest power first; with
+  /// LeadingOne, the highest coefficient is an implicit 1.
+  template <bool LeadingOne = false, int K>
+  static Reg Poly(Reg X, const double (&C)[K])
+  {
+    Reg R = LeadingOne ? V::add(X, V::set1(C[0])) : V::set1(C[0]);
+    for (int i = 1; i < K; ++i)
+      R = V::fmadd(R, X, V::set1(C[i]));
+    return R;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Reductions
+  //===--------------------------------------------------------------------===//
+
+  // Four independent accumulators, so each add doesn't wait on the last.
+
+  static double Sum(const double *A, int64_t N)
+  {
+    Reg S0 = V::set1(0.0), S1 = S0, S2 = S0, S3 = S0;
+    int64_t i = 0;
+    for (; i + 4 * W <= N; i += 4 * W)
+    {
+      S0 = V::add(S0, V::load(A + i));
+      S1 = V::add(S1, V::load(A + i + W));
+      S2 = V::add(S2, V::load(A + i + 2 * W));
+      S3 = V::add(S3, V::load(A + i + 3 * W));
+    }
+    for (; i + W <= N; i += W)
+      S0 = V::add(S0, V::load(A + i));
+    double S = V::hsum(V::add(V::add(S0, S1), V::add(S2, S3)));
+    for (; i < N; ++i)
+      S += A[i];
+    return S;
+  }
+
+  static double Dot(const double *A, const double *B, int64_t N)
+  {
+    Reg S0 = V::set1(0.0), S1 = S0, S2 = S0, S3 = S0;
+    int64_t i = 0;
+    for (; i + 4 * W <= N; i += 4 * W)
+    {
+      S0 = V::fmadd(V::load(A + i), V::load(B + i), S0);
+      S1 = V::fmadd(V::load(A + i + W), V::load(B + i + W), S1);
+      S2 = V::fmadd(V::load(A + i + 2 * W), V::load(B + i + 2 * W), S2);
+      S3 = V::fmadd(V::load(A + i + 3 * W), V::load(B + i + 3 * W), S3);
+    }
+    for (; i + W <= N; i += W)
+      S0 = V::fmadd(V::load(A + i), V::load(B + i), S0);
+    double S = V::hsum(V::add(V::add(S0, S1), V::add(S2, S3)));
+    for (; i < N; ++i)
+      S += A[i] * B[i];
+    return S;
+  }
+
+  static double Min(const double *A, int64_t N)
+  {
+    Reg M0 = V::set1(Inf), M1 = M0;
+    int64_t i = 0;
+    for (; i + 2 * W <= N; i += 2 * W)
+    {
+      M0 = V::min(M0, V::load(A + i));
+      M1 = V::min(M1, V::load(A + i + W));
+    }
+    for (; i + W <= N; i += W)
+      M0 = V::min(M0, V::load(A + i));
+    double M = V::hmin(V::min(M0, M1));
+    for (; i < N; ++i)
+      M = A[i] < M ? A[i] : M;
+    return M;
+  }
+
+  static double Max(const double *A, int64_t N)
+  {
+    Reg M0 = V::set1(-Inf), M1 = M0;
+    int64_t i = 0;
+    for (; i + 2 * W <= N; i += 2 * W)
+    {
+      M0 = V::max(M0, V::load(A + i));
+      M1 = V::max(M1, V::load(A + i + W));
+    }
+    for (; i + W <= N; i += W)
+      M0 = V::max(M0, V::load(A + i));
+    double M = V::hmax(V::max(M0, M1));
+    for (; i < N; ++i)
+      M = A[i] > M ? A[i] : M;
+    return M;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // In-place arithmetic
+  //===--------------------------------------------------------------------===//
+
+  static void Scale(double *A, int64_t N, double K)
+  {
+    Reg KV = V::set1(K);
+    int64_t i = 0;
+    for (; i + W <= N; i += W)
+      V::store(A + i, V::mul(V::load(A + i), KV));
+    for (; i < N; ++i)
+      A[i] *= K;
+  }
+
+  static void Axpy(double K, const double *X, double *Y, int64_t N)
+  {
+    Reg KV = V::set1(K);
+    int64_t i = 0;
+    for (; i + W <= N; i += W)
+      V::store(Y + i, V::fmadd(KV, V::load(X + i), V::load(Y + i)));
+    for (; i < N; ++i)
+      Y[i] += K * X[i];
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Matrix multiply
+  //===--------------------------------------------------------------------===//
+
+  static constexpr int TileRows = V::GemmRows;
+  static constexpr int TileVectors = V::GemmVectors;
+
+  /// GemmTile - C += A * B for one TileRows x (TileVectors * W) block of C,
+  /// held in registers for the whole of K. A is packed column by column
+  /// (TileRows values per k) and B row by row (TileVectors * W values per k);
+  /// see matrix.cpp for the packing.
+  static void GemmTile(int64_t K, const double *A, const double *B, double *C,
+                       int64_t Ldc)
+  {
+    Reg Acc[TileRows][TileVectors];
+    for (int i = 0; i < TileRows; ++i)
+      for (int j = 0; j < TileVectors; ++j)
+        Acc[i][j] = V::set1(0.0);
+
+    for (int64_t k = 0; k < K; ++k, A += TileRows, B += TileVectors * W)
+    {
+      Reg Bk[TileVectors];
+      for (int j = 0; j < TileVectors; ++j)
+        Bk[j] = V::load(B + j * W);
+      for (int i = 0; i < TileRows; ++i)
+      {
+        Reg Ai = V::set1(A[i]);
+        for (int j = 0; j < TileVectors; ++j)
+          Acc[i][j] = V::fmadd(Ai, Bk[j], Acc[i][j]);
+      }
+    }
+
+    for (int i = 0; i < TileRows; ++i)
+      for (int j = 0; j < TileVectors; ++j)
+      {
+        double *P = C + i * Ldc + j * W;
+        V::store(P, V::add(V::load(P), Acc[i][j]));
+      }
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Elementwise math
+  //===--------------------------------------------------------------------===//
+
+  /// Map - Replace each element x with f(x): a vector at a time with Fast
+  /// when InRange holds for every lane, and otherwise (and for the tail) an
+  /// element at a time with Scalar, the builtin itself.
+  template <class FastFn, class RangeFn>
+  static void Map(double *A, int64_t N, FastFn Fast, RangeFn InRange,
+                  double (*Scalar)(double))
+  {
+    int64_t i = 0;
+    for (; i + W <= N; i += W)
+    {
+      Reg X = V::load(A + i);
+      if (V::all(InRange(X)))
+        V::store(A + i, Fast(X));
+      else
+        for (int j = 0; j < W; ++j)
+          A[i + j] = Scalar(A[i + j]);
+    }
+    for (; i < N; ++i)
+      A[i] = Scalar(A[i]);
+  }
+
+  /// ExpVec - e^x for |x| <= 708, where neither the result nor 2^n
+  /// below is subnormal or infinite.
+  static Reg ExpVec(Reg X)
+  {
+    static constexpr double P[] = {1.26177193074810590878e-4,
+                                   3.02994407707441961300e-2,
+                                   9.99999999999999999910e-1};
+    static constexpr double Q[] = {3.00198505138664455042e-6,
+                                   2.52448340349684104192e-3,
+                                   2.27265548208155028766e-1,
+                                   2.00000000000000000009e0};
+
+    // x = n ln2 + r with |r| <= ln2 / 2; ln2 is split in two so n ln2 is
+    // exact enough.
+    Reg N = V::floor(V::fmadd(X, V::set1(1.4426950408889634073599), V::set1(0.5)));
+    Reg R = V::fmadd(N, V::set1(-6.93145751953125e-1), X);
+    R = V::fmadd(N, V::set1(-1.42860682030941723212e-6), R);
+
+    // e^r = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2))
+    Reg RR = V::mul(R, R);
+    Reg PR = V::mul(R, Poly(RR, P));
+    Reg E = V::fmadd(V::set1(2.0), V::div(PR, V::sub(Poly(RR, Q), PR)), V::set1(1.0));
+
+    // 2^n: adding 2^52 puts the whole number n + 1023 in the low bits of
+    // the mantissa, and the shift moves it into the exponent.
+    Reg Pow2 = V::shiftLeft52(V::add(N, V::set1(4503599627370496.0 + 1023.0)));
+    return V::mul(E, Pow2);
+  }
+
+  /// LogVec - ln x for normal, finite x > 0.
+  static Reg LogVec(Reg X)
+  {
+    static constexpr double Lg[] = {6.666666666666735130e-01, 3.999999999940941908e-01,
+                                    2.857142874366239149e-01, 2.222219843214978396e-01,
+                                    1.818357216161805012e-01, 1.531383769920937332e-01,
+                                    1.479819860511658591e-01};
+    Reg One = V::set1(1.0);
+
+    // x = m 2^e with m in [0.5, 1), as frexp splits it.
+    Reg E = V::sub(V::bitOr(V::shiftRight52(X), Bits(0x4330000000000000)),
+                   V::set1(4503599627370496.0 + 1022.0));
+    Reg M = V::bitOr(V::bitAnd(X, Bits(0x000FFFFFFFFFFFFF)), Bits(0x3FE0000000000000));
+
+    // Bring m into [sqrt(1/2), sqrt(2)) and take f = m - 1.
+    auto Small = V::lt(M, V::set1(0.70710678118654752440));
+    E = V::select(Small, V::sub(E, One), E);
+    Reg F = V::sub(V::select(Small, V::add(M, M), M), One);
+
+    // ln(1 + f) = f - (f^2 / 2 - s (f^2 / 2 + R(s^2))) with s = f / (2 + f),
+    // plus e ln2 in two parts.
+    Reg S = V::div(F, V::add(V::set1(2.0), F));
+    Reg Z = V::mul(S, S);
+    Reg W2 = V::mul(Z, Z);
+    Reg R = V::add(V::mul(W2, V::fmadd(W2, V::fmadd(W2, V::set1(Lg[5]), V::set1(Lg[3])),
+                                       V::set1(Lg[1]))),
+                   V::mul(Z, V::fmadd(W2, V::fmadd(W2, V::fmadd(W2, V::set1(Lg[6]),
+                                                                  V::set1(Lg[4])),
+                                                   V::set1(Lg[2])),
+                                      V::set1(Lg[0]))));
+    Reg HalfF2 = V::mul(V::set1(0.5), V::mul(F, F));
+    Reg Lo = V::fmadd(S, V::add(HalfF2, R), V::mul(E, V::set1(1.90821492927058770002e-10)));
+    return V::fmadd(E, V::set1(6.93147180369123816490e-01), V::sub(F, V::sub(HalfF2, Lo)));
+  }
+
+  /// SinCosVec - sin x (or with Cosine, cos x) for |x| <= 2^20.
+  template <bool Cosine> static Reg SinCosVec(Reg X)
+  {
+    static constexpr double SinC[] = {1.58962301576546568060e-10, -2.50507477628578072866e-8,
+                                      2.75573136213857245213e-6,  -1.98412698295895385996e-4,
+                                      8.33333333332211858878e-3,  -1.66666666666666307295e-1};
+    static constexpr double CosC[] = {-1.13585365213876817300e-11, 2.08757008419747316778e-9,
+                                      -2.75573141792967388112e-7,  2.48015872888517045348e-5,
+                                      -1.38888888888730564116e-3,  4.16666666666665929218e-2};
+    Reg SignBit = V::set1(-0.0);
+    Reg Zero = V::set1(0.0);
+
+    // sin is odd and cos even: work on |x| and put the sign back at the end.
+    Reg Sign = Cosine ? Zero : V::bitAnd(X, SignBit);
+    X = V::bitAnd(X, Bits(0x7FFFFFFFFFFFFFFF));
+
+    // The octant, rounded up to an even one: x = j pi/4 + z, |z| <= pi/4.
+    Reg J = V::floor(V::mul(X, V::set1(1.27323954473516268615)));
+    J = V::add(J, V::sub(J, V::mul(V::set1(2.0), V::floor(V::mul(J, V::set1(0.5))))));
+    Reg Z = V::fmadd(J, V::set1(-7.85398125648498535156e-1), X);
+    Z = V::fmadd(J, V::set1(-3.77489470793079817668e-8), Z);
+    Z = V::fmadd(J, V::set1(-2.69515142907905952645e-15), Z);
+
+    // Octants 4 and 6 are octants 0 and 2 with the sign flipped; for cos,
+    // octant 2 is too.
+    J = V::sub(J, V::mul(V::set1(8.0), V::floor(V::mul(J, V::set1(0.125)))));
+    auto Upper = V::ge(J, V::set1(4.0));
+    J = V::select(Upper, V::sub(J, V::set1(4.0)), J);
+    Sign = V::bitXor(Sign, V::select(Upper, SignBit, Zero));
+    auto Two = V::eq(J, V::set1(2.0));
+    if (Cosine)
+      Sign = V::bitXor(Sign, V::select(Two, SignBit, Zero));
+
+    Reg ZZ = V::mul(Z, Z);
+    Reg SinZ = V::fmadd(V::mul(Z, ZZ), Poly(ZZ, SinC), Z);
+    Reg CosZ = V::fmadd(V::mul(ZZ, ZZ), Poly(ZZ, CosC), V::fmadd(ZZ, V::set1(-0.5), V::set1(1.0)));
+    Reg R = Cosine ? V::select(Two, SinZ, CosZ) : V::select(Two, CosZ, SinZ);
+    return V::bitXor(R, Sign);
+  }
+
+  static void Exp(double *A, int64_t N)
+  {
+    Map(A, N, ExpVec,
+        [](Reg X) { return V::both(V::ge(X, V::set1(-708.0)), V::le(X, V::set1(708.0))); },
+        expo);
+  }
+
+  static void Log(double *A, int64_t N)
+  {
+    Map(A, N, LogVec,
+        [](Reg X) {
+          return V::both(V::ge(X, V::set1(MinNormal)), V::le(X, V::set1(MaxFinite)));
+        },
+        logarithm);
+  }
+
+  static auto SinCosRange()
+  {
+    return [](Reg X) {
+      return V::le(V::bitAnd(X, Bits(0x7FFFFFFFFFFFFFFF)), V::set1(1048576.0));
+    };
+  }
+
+  static void Sin(double *A, int64_t N) { Map(A, N, SinCosVec<false>, SinCosRange(), saini); }
+  static void Cos(double *A, int64_t N) { Map(A, N, SinCosVec<true>, SinCosRange(), cosi); }
+};
+
+template <class V> constexpr KernelSet MakeKernelSet(const char *Name)
+{
+  using K = Kernels<V>;
+  return {Name,   K::Sum, K::Dot, K::Min, K::Max,
+          K::Scale, K::Axpy, K::Sin, K::Cos, K::Exp,
+          K::Log,   K::TileRows, K::TileVectors * K::W, K::GemmTile};
+}
+
+#endif // RUNTIME_KERNELS_IMPL_H
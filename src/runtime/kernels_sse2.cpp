@@ -0,0 +1,67 @@
+#include "kernels_impl.h"
+#include <emmintrin.h>
+
+// The array kernels for SSE2, which every x86-64 CPU has.
+
+namespace {
+
+struct Sse2
+{
+  using Reg = __m128d;
+  using Mask = __m128d;
+  static constexpr int Width = 2;
+  // 4 x 4 doubles: eight accumulators of the sixteen xmm registers.
+  static constexpr int GemmRows = 4;
+  static constexpr int GemmVectors = 2;
+
+  static Reg load(const double *P) { return _mm_loadu_pd(P); }
+  static void store(double *P, Reg X) { _mm_storeu_pd(P, X); }
+  static Reg set1(double X) { return _mm_set1_pd(X); }
+  static Reg add(Reg A, Reg B) { return _mm_add_pd(A, B); }
+  static Reg sub(Reg A, Reg B) { return _mm_sub_pd(A, B); }
+  static Reg mul(Reg A, Reg B) { return _mm_mul_pd(A, B); }
+  static Reg div(Reg A, Reg B) { return _mm_div_pd(A, B); }
+  static Reg fmadd(Reg A, Reg B, Reg C) { return _mm_add_pd(_mm_mul_pd(A, B), C); }
+  static Reg min(Reg A, Reg B) { return _mm_min_pd(A, B); }
+  static Reg max(Reg A, Reg B) { return _mm_max_pd(A, B); }
+
+  // SSE2 has no rounding instruction. Adding and subtracting 1.5 * 2^52
+  // rounds to the nearest whole number; step down where that rounded up.
+  static Reg floor(Reg X)
+  {
+    const Reg Magic = _mm_set1_pd(6755399441055744.0);
+    Reg R = _mm_sub_pd(_mm_add_pd(X, Magic), Magic);
+    return _mm_sub_pd(R, _mm_and_pd(_mm_cmpgt_pd(R, X), _mm_set1_pd(1.0)));
+  }
+
+  static Reg bitAnd(Reg A, Reg B) { return _mm_and_pd(A, B); }
+  static Reg bitOr(Reg A, Reg B) { return _mm_or_pd(A, B); }
+  static Reg bitXor(Reg A, Reg B) { return _mm_xor_pd(A, B); }
+  static Reg shiftLeft52(Reg X)
+  {
+    return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(X), 52));
+  }
+  static Reg shiftRight52(Reg X)
+  {
+    return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(X), 52));
+  }
+
+  static Mask lt(Reg A, Reg B) { return _mm_cmplt_pd(A, B); }
+  static Mask le(Reg A, Reg B) { return _mm_cmple_pd(A, B); }
+  static Mask ge(Reg A, Reg B) { return _mm_cmpge_pd(A, B); }
+  static Mask eq(Reg A, Reg B) { return _mm_cmpeq_pd(A, B); }
+  static Mask both(Mask A, Mask B) { return _mm_and_pd(A, B); }
+  static bool all(Mask M) { return _mm_movemask_pd(M) == 0x3; }
+  static Reg select(Mask M, Reg A, Reg B)
+  {
+    return _mm_or_pd(_mm_and_pd(M, A), _mm_andnot_pd(M, B));
+  }
+
+  static double hsum(Reg X) { return _mm_cvtsd_f64(_mm_add_sd(X, _mm_unpackhi_pd(X, X))); }
+  static double hmin(Reg X) { return _mm_cvtsd_f64(_mm_min_sd(X, _mm_unpackhi_pd(X, X))); }
+  static double hmax(Reg X) { return _mm_cvtsd_f64(_mm_max_sd(X, _mm_unpackhi_pd(X, X))); }
+};
+
+} // end anonymous namespace
+
+extern const KernelSet Sse2Kernels = MakeKernelSet<Sse2>("sse2");
@@ -0,0 +1,500 @@
+#include "matrix.h"
+#include "kernels.h"
+#include "memory.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t MatrixAlign = 64;
+
+/// isLarge - Whether a block of Size bytes gets a large region of its own:
+/// with --huge-pages, a matrix (or scratch space) of 2 MiB or more, so
+/// walking it doesn't miss in the TLB every 4 KiB.
+static bool isLarge(size_t Size)
+{
+  return HugePagesEnabled() && Size >= HugePageSize;
+}
+
+static void *allocateAligned(size_t Size)
+{
+  Size = (Size + MatrixAlign - 1) / MatrixAlign * MatrixAlign;
+  void *P;
+  if (isLarge(Size))
+    P = AllocateLargeRegion(Size, false);
+  else
+#ifdef _WIN32
+    P = _aligned_malloc(Size, MatrixAlign);
+#else
+    P = aligned_alloc(MatrixAlign, Size);
+#endif
+  if (!P)
+  {
+    fputs("Kukanganisa: ndangariro yapera\n", stderr); // Out of memory
+    abort();
+  }
+  return P;
+}
+
+/// freeAligned - Free what allocateAligned(Size) returned.
+static void freeAligned(void *P, size_t Size)
+{
+  Size = (Size + MatrixAlign - 1) / MatrixAlign * MatrixAlign;
+  if (isLarge(Size))
+  {
+    // With huge pages on, every region is rounded up to a whole 2 MiB.
+    ReleaseLargeRegion(P, (Size + HugePageSize - 1) / HugePageSize * HugePageSize);
+    return;
+  }
+#ifdef _WIN32
+  _aligned_free(P);
+#else
+  free(P);
+#endif
+}
+
+/// A size or index given as a number: whole, and negative (or NaN) as 0.
+static int64_t toCount(double X)
+{
+  if (!(X > 0))
+    return 0;
+  return X < 9.0e15 ? int64_t(X) : int64_t(9.0e15);
+}
+
+static TinoMatrix *newMatrix(int64_t Rows, int64_t Cols)
+{
+  // One allocation, like an array: the header in the first cache line and
+  // the rows from the second on.
+  int64_t Stride = (Cols + 7) / 8 * 8;
+  // allocateAligned rounds up, so leave it a cache line besides the header's.
+  if (Stride > 0 &&
+      size_t(Rows) > (SIZE_MAX - 2 * MatrixAlign) / sizeof(double) / size_t(Stride))
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: matrix ye %lldx%lld yakakura zvakanyanya\n",
+            (long long)Rows, (long long)Cols);
+    exit(1);
+  }
+  size_t DataSize = size_t(Rows) * size_t(Stride) * sizeof(double);
+  char *Block = static_cast<char *>(allocateAligned(MatrixAlign + DataSize));
+  memset(Block + MatrixAlign, 0, DataSize);
+
+  auto *M = reinterpret_cast<TinoMatrix *>(Block);
+  M->Data = reinterpret_cast<double *>(Block + MatrixAlign);
+  M->Rows = Rows;
+  M->Cols = Cols;
+  M->Stride = Stride;
+  return M;
+}
+
+static void freeMatrix(TinoMatrix *M)
+{
+  freeAligned(M, MatrixAlign + size_t(M->Rows) * size_t(M->Stride) * sizeof(double));
+}
+
+static TinoMatrix *copyMatrix(const TinoMatrix *A)
+{
+  TinoMatrix *M = newMatrix(A->Rows, A->Cols);
+  memcpy(M->Data, A->Data, size_t(A->Rows) * size_t(A->Stride) * sizeof(double));
+  return M;
+}
+
+static double *row(const TinoMatrix *M, int64_t I) { return M->Data + I * M->Stride; }
+
+static void matrixError(const char *Builtin, const char *Problem, const TinoMatrix *A,
+                        const TinoMatrix *B)
+{
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: '%s' %s (%lldx%lld", Builtin, Problem,
+          (long long)A->Rows, (long long)A->Cols);
+  if (B)
+    fprintf(stderr, " ne %lldx%lld", (long long)B->Rows, (long long)B->Cols);
+  fputs(")\n", stderr);
+  exit(1);
+}
+
+/// CheckSameShape - The elementwise builtins need matrices of one size.
+static void CheckSameShape(const char *Builtin, const TinoMatrix *A, const TinoMatrix *B)
+{
+  if (A->Rows != B->Rows || A->Cols != B->Cols)
+    matrixError(Builtin, "inoda matrix dzakaenzana", A, B);
+}
+
+static void CheckIndex(const TinoMatrix *M, double I, double J)
+{
+  if (I >= 0 && I < double(M->Rows) && J >= 0 && J < double(M->Cols))
+    return;
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: (%g, %g) iri kunze kwe matrix ine %lldx%lld\n", I, J,
+          (long long)M->Rows, (long long)M->Cols);
+  exit(1);
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrix(double Rows, double Cols)
+{
+  return newMatrix(toCount(Rows), toCount(Cols));
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixIdentity(double N)
+{
+  TinoMatrix *M = newMatrix(toCount(N), toCount(N));
+  for (int64_t i = 0; i < M->Rows; ++i)
+    row(M, i)[i] = 1;
+  return M;
+}
+
+extern "C" DLLEXPORT double matrixRows(const TinoMatrix *M) { return double(M->Rows); }
+
+extern "C" DLLEXPORT double matrixCols(const TinoMatrix *M) { return double(M->Cols); }
+
+extern "C" DLLEXPORT double matrixGet(const TinoMatrix *M, double I, double J)
+{
+  CheckIndex(M, I, J);
+  return row(M, int64_t(I))[int64_t(J)];
+}
+
+extern "C" DLLEXPORT double matrixSet(TinoMatrix *M, double I, double J, double X)
+{
+  CheckIndex(M, I, J);
+  row(M, int64_t(I))[int64_t(J)] = X;
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Multiply
+//===----------------------------------------------------------------------===//
+
+// C = A * B is computed in blocks sized for the caches: a GemmKC x GemmNC
+// panel of B is copied ("packed") once and reused from the last-level cache
+// by every GemmMC x GemmKC panel of A, which in turn stays in L2 while the
+// kernels' GemmTile runs over it, one register tile of C at a time. The
+// packed panels are laid out in exactly the order GemmTile reads them.
+//
+// GemmMC is a multiple of every kernel set's GemmRows (4, 6 and 8), and
+// GemmNC of every GemmCols (4, 8 and 24), so only the matrix's own edges
+// give partial tiles.
+static const int64_t GemmKC = 256;
+static const int64_t GemmMC = 96;
+static const int64_t GemmNC = 1536;
+
+// The largest GemmRows * GemmCols of any kernel set.
+static const int GemmMaxTile = 8 * 24;
+
+// Work below this many floating-point operations per thread isn't worth
+// handing to another thread.
+static const double GemmFlopsPerThread = 1 << 26;
+
+/// PackA - Rows [I, I + M) and columns [P, P + K) of A as panels of MR rows,
+/// each stored column by column; rows past the end of A are zeros.
+static void PackA(const TinoMatrix *A, int64_t I, int64_t M, int64_t P, int64_t K, int MR,
+                  double *Out)
+{
+  for (int64_t i0 = 0; i0 < M; i0 += MR, Out += MR * K)
+    for (int r = 0; r < MR; ++r)
+    {
+      if (i0 + r >= M)
+      {
+        for (int64_t k = 0; k < K; ++k)
+          Out[k * MR + r] = 0;
+        continue;
+      }
+      const double *Src = row(A, I + i0 + r) + P;
+      for (int64_t k = 0; k < K; ++k)
+        Out[k * MR + r] = Src[k];
+    }
+}
+
+/// PackB - Rows [P, P + K) and columns [J, J + N) of B as panels of NR
+/// columns, each stored row by row; columns past the end of B are zeros.
+static void PackB(const TinoMatrix *B, int64_t P, int64_t K, int64_t J, int64_t N, int NR,
+                  double *Out)
+{
+  for (int64_t j0 = 0; j0 < N; j0 += NR)
+  {
+    int64_t Cols = std::min<int64_t>(NR, N - j0);
+    for (int64_t k = 0; k < K; ++k, Out += NR)
+    {
+      memcpy(Out, row(B, P + k) + J + j0, size_t(Cols) * sizeof(double));
+      std::fill(Out + Cols, Out + NR, 0.0);
+    }
+  }
+}
+
+/// GemmBlock - C += A * B for rows [R0, R1) and columns [C0, C1) of C.
+static void GemmBlock(const KernelSet &Ks, const TinoMatrix *A, const TinoMatrix *B,
+                      TinoMatrix *C, int64_t R0, int64_t R1, int64_t C0, int64_t C1)
+{
+  const int MR = Ks.GemmRows, NR = Ks.GemmCols;
+  const int64_t K = A->Cols;
+  double *PackedA = static_cast<double *>(allocateAligned(GemmMC * GemmKC * sizeof(double)));
+  double *PackedB = static_cast<double *>(allocateAligned(GemmKC * GemmNC * sizeof(double)));
+  alignas(64) double Edge[GemmMaxTile];
+
+  for (int64_t jc = C0; jc < C1; jc += GemmNC)
+  {
+    int64_t NC = std::min(GemmNC, C1 - jc);
+    for (int64_t pc = 0; pc < K; pc += GemmKC)
+    {
+      int64_t KC = std::min(GemmKC, K - pc);
+      PackB(B, pc, KC, jc, NC, NR, PackedB);
+      for (int64_t ic = R0; ic < R1; ic += GemmMC)
+      {
+        int64_t MC = std::min(GemmMC, R1 - ic);
+        PackA(A, ic, MC, pc, KC, MR, PackedA);
+        for (int64_t jr = 0; jr < NC; jr += NR)
+          for (int64_t ir = 0; ir < MC; ir += MR)
+          {
+            const double *TileA = PackedA + ir * KC;
+            const double *TileB = PackedB + jr * KC;
+            double *TileC = row(C, ic + ir) + jc + jr;
+            if (ir + MR <= MC && jr + NR <= NC)
+            {
+              Ks.GemmTile(KC, TileA, TileB, TileC, C->Stride);
+              continue;
+            }
+
+            // A tile hanging over the edge of C: compute all of it on the
+            // side and add in the part that exists.
+            std::fill(Edge, Edge + MR * NR, 0.0);
+            Ks.GemmTile(KC, TileA, TileB, Edge, NR);
+            int64_t Rows = std::min<int64_t>(MR, MC - ir);
+            int64_t Cols = std::min<int64_t>(NR, NC - jr);
+            for (int64_t i = 0; i < Rows; ++i)
+              for (int64_t j = 0; j < Cols; ++j)
+                TileC[i * C->Stride + j] += Edge[i * NR + j];
+          }
+      }
+    }
+  }
+
+  freeAligned(PackedA, GemmMC * GemmKC * sizeof(double));
+  freeAligned(PackedB, GemmKC * GemmNC * sizeof(double));
+}
+
+namespace {
+
+/// GemmStrips - C split into strips of Strip rows (or columns) for
+/// matrixMul, run as the iterations of a parallel loop.
+struct GemmStrips
+{
+  const KernelSet *Ks;
+  const TinoMatrix *A, *B;
+  TinoMatrix *C;
+  bool ByRows;
+  int64_t Strip, Extent;
+};
+
+} // end anonymous namespace
+
+static void RunGemmStrips(void *Env, int64_t Begin, int64_t End, double * /*Partials*/)
+{
+  const GemmStrips &S = *static_cast<const GemmStrips *>(Env);
+  for (int64_t k = Begin; k < End; ++k)
+  {
+    int64_t From = k * S.Strip, To = std::min(S.Extent, From + S.Strip);
+    if (S.ByRows)
+      GemmBlock(*S.Ks, S.A, S.B, S.C, From, To, 0, S.C->Cols);
+    else
+      GemmBlock(*S.Ks, S.A, S.B, S.C, 0, S.C->Rows, From, To);
+  }
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixMul(const TinoMatrix *A, const TinoMatrix *B)
+{
+  if (A->Cols != B->Rows)
+    matrixError("matrixMul", "inoda makoramu e yekutanga akaenzana nemitsara ye yechipiri",
+                A, B);
+  TinoMatrix *C = newMatrix(A->Rows, B->Cols);
+  const KernelSet &Ks = ArrayKernels();
+  int64_t M = C->Rows, N = C->Cols;
+  if (!M || !N || !A->Cols)
+    return C;
+
+  // Split C into strips along its longer side, at most one per pool thread
+  // since each packs its own panels, and each a whole number of register
+  // tiles. The strips run as a loop on the pool, so --threads bounds them,
+  // and inside a 'pakati pamwe' body (or with the pool busy) they run one
+  // after another on the caller.
+  double Flops = 2.0 * double(M) * double(N) * double(A->Cols);
+  bool ByRows = M >= N;
+  int64_t Extent = ByRows ? M : N;
+  int64_t Unit = ByRows ? Ks.GemmRows : Ks.GemmCols;
+  int64_t Strips = std::max<int64_t>(1, int64_t(Flops / GemmFlopsPerThread));
+  Strips = std::min<int64_t>(Strips, ParallelThreads());
+  Strips = std::min<int64_t>(Strips, (Extent + Unit - 1) / Unit);
+  if (Strips == 1)
+  {
+    GemmBlock(Ks, A, B, C, 0, M, 0, N);
+    return C;
+  }
+
+  GemmStrips S;
+  S.Ks = &Ks;
+  S.A = A;
+  S.B = B;
+  S.C = C;
+  S.ByRows = ByRows;
+  S.Strip = ((Extent + Strips - 1) / Strips + Unit - 1) / Unit * Unit;
+  S.Extent = Extent;
+  tino_parallel_for(RunGemmStrips, &S, 0, double((Extent + S.Strip - 1) / S.Strip), 1,
+                    /*MinIterations=*/2, 0, nullptr, nullptr);
+  return C;
+}
+
+//===----------------------------------------------------------------------===//
+// Transpose and solve
+//===----------------------------------------------------------------------===//
+
+extern "C" DLLEXPORT TinoMatrix *matrixTranspose(const TinoMatrix *A)
+{
+  // In 32 x 32 blocks, so both the rows read and the rows written stay in
+  // L1 while a block is copied.
+  const int64_t Block = 32;
+  TinoMatrix *T = newMatrix(A->Cols, A->Rows);
+  for (int64_t i0 = 0; i0 < A->Rows; i0 += Block)
+    for (int64_t j0 = 0; j0 < A->Cols; j0 += Block)
+    {
+      int64_t I1 = std::min(A->Rows, i0 + Block), J1 = std::min(A->Cols, j0 + Block);
+      for (int64_t i = i0; i < I1; ++i)
+        for (int64_t j = j0; j < J1; ++j)
+          row(T, j)[i] = row(A, i)[j];
+    }
+  return T;
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixSolve(const TinoMatrix *A, const TinoMatrix *B)
+{
+  if (A->Rows != A->Cols || B->Rows != A->Rows)
+    matrixError("matrixSolve", "inoda matrix ine mitsara nemakoramu akaenzana", A, B);
+
+  // Eliminate on copies, applying every row operation on A to B as well, so
+  // B ends up as the solution once U is back-substituted.
+  const int64_t N = A->Rows, Width = B->Stride;
+  TinoMatrix *U = copyMatrix(A);
+  TinoMatrix *X = copyMatrix(B);
+
+  double Largest = 0;
+  for (int64_t i = 0; i < N; ++i)
+    for (int64_t j = 0; j < N; ++j)
+      Largest = std::max(Largest, std::fabs(row(A, i)[j]));
+  // A pivot this small is rounding error left from a column that is a
+  // combination of the others.
+  double Tolerance = double(N) * DBL_EPSILON * Largest;
+
+  for (int64_t k = 0; k < N; ++k)
+  {
+    int64_t Pivot = k;
+    for (int64_t i = k + 1; i < N; ++i)
+      if (std::fabs(row(U, i)[k]) > std::fabs(row(U, Pivot)[k]))
+        Pivot = i;
+    if (!(std::fabs(row(U, Pivot)[k]) > Tolerance))
+    {
+      freeMatrix(U);
+      freeMatrix(X);
+      matrixError("matrixSolve", "haina mhinduro imwe chete: matrix iyi ndeye singular", A,
+                  nullptr);
+    }
+    if (Pivot != k)
+    {
+      std::swap_ranges(row(U, k) + k, row(U, k) + N, row(U, Pivot) + k);
+      std::swap_ranges(row(X, k), row(X, k) + Width, row(X, Pivot));
+    }
+
+    const double *UK = row(U, k), *XK = row(X, k);
+    for (int64_t i = k + 1; i < N; ++i)
+    {
+      double *UI = row(U, i), *XI = row(X, i);
+      double F = UI[k] / UK[k];
+      if (F == 0)
+        continue;
+      for (int64_t j = k + 1; j < N; ++j)
+        UI[j] -= F * UK[j];
+      for (int64_t j = 0; j < Width; ++j)
+        XI[j] -= F * XK[j];
+    }
+  }
+
+  for (int64_t k = N - 1; k >= 0; --k)
+  {
+    double *XK = row(X, k);
+    const double *UK = row(U, k);
+    for (int64_t i = k + 1; i < N; ++i)
+    {
+      const double *XI = row(X, i);
+      for (int64_t j = 0; j < Width; ++j)
+        XK[j] -= UK[i] * XI[j];
+    }
+    double Inverse = 1 / UK[k];
+    for (int64_t j = 0; j < Width; ++j)
+      XK[j] *= Inverse;
+  }
+
+  freeMatrix(U);
+  return X;
+}
+
+//===----------------------------------------------------------------------===//
+// Elementwise
+//===----------------------------------------------------------------------===//
+
+// The padding at the end of each row is zero in every matrix, so these run
+// over all the storage as one flat loop, which the compiler vectorizes.
+
+template <class Fn>
+static TinoMatrix *Elementwise(const char *Builtin, const TinoMatrix *A, const TinoMatrix *B,
+                               Fn F)
+{
+  CheckSameShape(Builtin, A, B);
+  TinoMatrix *C = newMatrix(A->Rows, A->Cols);
+  const double *PA = A->Data, *PB = B->Data;
+  double *PC = C->Data;
+  for (int64_t i = 0, e = A->Rows * A->Stride; i < e; ++i)
+    PC[i] = F(PA[i], PB[i]);
+  return C;
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixAdd(const TinoMatrix *A, const TinoMatrix *B)
+{
+  return Elementwise("matrixAdd", A, B, [](double X, double Y) { return X + Y; });
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixSub(const TinoMatrix *A, const TinoMatrix *B)
+{
+  return Elementwise("matrixSub", A, B, [](double X, double Y) { return X - Y; });
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixMulElements(const TinoMatrix *A, const TinoMatrix *B)
+{
+  return Elementwise("matrixMulElements", A, B, [](double X, double Y) { return X * Y; });
+}
+
+extern "C" DLLEXPORT TinoMatrix *matrixScale(const TinoMatrix *A, double K)
+{
+  TinoMatrix *C = newMatrix(A->Rows, A->Cols);
+  for (int64_t i = 0; i < A->Rows; ++i)
+  {
+    const double *Src = row(A, i);
+    double *Dst = row(C, i);
+    for (int64_t j = 0; j < A->Cols; ++j)
+      Dst[j] = Src[j] * K;
+  }
+  return C;
+}
+
+extern "C" DLLEXPORT void tino_matrix_print(const TinoMatrix *M)
+{
+  for (int64_t i = 0; i < M->Rows; ++i)
+  {
+    tino_printf("[");
+    for (int64_t j = 0; j < M->Cols; ++j)
+    {
+      if (j)
+        tino_printf(", ");
+      tino_printf("%.5f", row(M, i)[j]);
+    }
+    tino_printf("]\n");
+  }
+}
@@ -0,0 +1,59 @@
+// Matrix.h
+#ifndef RUNTIME_MATRIX_H
+#define RUNTIME_MATRIX_H
+
+#include "runtime.h"
+#include <cstdint>
+
+// Dense matrices of doubles. A Matrix is stored row by row; every row starts
+// on a 64-byte boundary, so a row is padded with zeros out to a multiple of
+// eight elements (Stride). Scripts only ever see a Matrix through the
+// builtins below, which take indices and sizes as numbers like every other
+// builtin.
+//
+// The builtins that compute a matrix return a new one and leave their
+// arguments alone. Mismatched sizes, indices outside the matrix and
+// singular systems end the script with a diagnostic, as an index outside an
+// array does.
+
+struct TinoMatrix
+{
+  double *Data;   // Row 0, 64-byte aligned; row i starts at Data + i * Stride.
+  int64_t Rows;
+  int64_t Cols;
+  int64_t Stride; // Elements from one row to the next; Cols rounded up to 8.
+};
+
+extern "C"
+{
+  // A Rows x Cols matrix of zeros, and the N x N identity.
+  DLLEXPORT TinoMatrix *matrix(double Rows, double Cols);
+  DLLEXPORT TinoMatrix *matrixIdentity(double N);
+
+  DLLEXPORT double matrixRows(const TinoMatrix *M);
+  DLLEXPORT double matrixCols(const TinoMatrix *M);
+
+  // Element (I, J), counting from 0. matrixSet returns 0.
+  DLLEXPORT double matrixGet(const TinoMatrix *M, double I, double J);
+  DLLEXPORT double matrixSet(TinoMatrix *M, double I, double J, double X);
+
+  // The product A * B, cache-blocked and vectorized with the array kernels'
+  // instruction set, and spread over the CPU's cores when it is large.
+  DLLEXPORT TinoMatrix *matrixMul(const TinoMatrix *A, const TinoMatrix *B);
+  DLLEXPORT TinoMatrix *matrixTranspose(const TinoMatrix *A);
+
+  // X such that A * X = B, for a square A, by LU decomposition with partial
+  // pivoting. B may have any number of columns.
+  DLLEXPORT TinoMatrix *matrixSolve(const TinoMatrix *A, const TinoMatrix *B);
+
+  // Element by element: A + B, A - B, A * B and A * K.
+  DLLEXPORT TinoMatrix *matrixAdd(const TinoMatrix *A, const TinoMatrix *B);
+  DLLEXPORT TinoMatrix *matrixSub(const TinoMatrix *A, const TinoMatrix *B);
+  DLLEXPORT TinoMatrix *matrixMulElements(const TinoMatrix *A, const TinoMatrix *B);
+  DLLEXPORT TinoMatrix *matrixScale(const TinoMatrix *A, double K);
+
+  // Prints the matrix a row per line, as 'nyora' does.
+  DLLEXPORT void tino_matrix_print(const TinoMatrix *M);
+}
+
+#endif // RUNTIME_MATRIX_H
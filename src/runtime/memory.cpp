@@ -0,0 +1,98 @@
+#include "memory.h"
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+static bool UseHugePages = false;
+
+void SetHugePagesEnabled(bool Enabled) { UseHugePages = Enabled; }
+bool HugePagesEnabled() { return UseHugePages; }
+
+static size_t roundUp(size_t N, size_t Align)
+{
+  return (N + Align - 1) / Align * Align;
+}
+
+#ifdef _WIN32
+
+void *AllocateLargeRegion(size_t &Size, bool Executable)
+{
+  DWORD Protect = Executable ? PAGE_EXECUTE_READWRITE : PAGE_READWRITE;
+
+  // Large pages need SeLockMemoryPrivilege; without it this simply fails.
+  if (UseHugePages)
+  {
+    if (SIZE_T LargePage = GetLargePageMinimum())
+    {
+      size_t Rounded = roundUp(Size, LargePage);
+      if (void *P = VirtualAlloc(nullptr, Rounded,
+                                 MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, Protect))
+      {
+        Size = Rounded;
+        return P;
+      }
+    }
+  }
+
+  return VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT, Protect);
+}
+
+void ReleaseLargeRegion(void *Ptr, size_t)
+{
+  VirtualFree(Ptr, 0, MEM_RELEASE);
+}
+
+#else
+
+void *AllocateLargeRegion(size_t &Size, bool Executable)
+{
+  int Prot = PROT_READ | PROT_WRITE | (Executable ? PROT_EXEC : 0);
+
+  if (UseHugePages)
+  {
+    size_t Rounded = roundUp(Size, HugePageSize);
+#ifdef MAP_HUGETLB
+    void *P = mmap(nullptr, Rounded, Prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (P != MAP_FAILED)
+    {
+      Size = Rounded;
+      return P;
+    }
+#endif
+
+    // No reserved huge pages: over-map, trim to a 2 MiB boundary and ask the
+    // kernel to back the region with transparent huge pages.
+    size_t Padded = Rounded + HugePageSize;
+    void *Raw = mmap(nullptr, Padded, Prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (Raw == MAP_FAILED)
+      return nullptr;
+
+    char *Begin = static_cast<char *>(Raw);
+    char *Aligned = reinterpret_cast<char *>(
+        roundUp(reinterpret_cast<uintptr_t>(Begin), HugePageSize));
+    if (Aligned != Begin)
+      munmap(Begin, Aligned - Begin);
+    size_t Tail = (Begin + Padded) - (Aligned + Rounded);
+    if (Tail)
+      munmap(Aligned + Rounded, Tail);
+#ifdef MADV_HUGEPAGE
+    madvise(Aligned, Rounded, MADV_HUGEPAGE);
+#endif
+    Size = Rounded;
+    return Aligned;
+  }
+
+  void *P = mmap(nullptr, Size, Prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return P == MAP_FAILED ? nullptr : P;
+}
+
+void ReleaseLargeRegion(void *Ptr, size_t Size)
+{
+  munmap(Ptr, Size);
+}
+
+#endif
@@ -0,0 +1,27 @@
+// Memory.h
+#ifndef RUNTIME_MEMORY_H
+#define RUNTIME_MEMORY_H
+
+#include <cstddef>
+
+// Large memory regions for JIT code and data and for the runtime's arenas.
+//
+// With huge pages enabled, regions are rounded up to 2 MiB and backed by
+// explicit huge pages (MAP_HUGETLB / MEM_LARGE_PAGES) when the system has them
+// reserved, and otherwise by 2 MiB-aligned memory marked for transparent huge
+// pages. Without them, regions are ordinary page-granular mappings.
+
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+void SetHugePagesEnabled(bool Enabled);
+bool HugePagesEnabled();
+
+// Maps at least Size bytes of zeroed memory and updates Size to the mapped
+// length. Executable regions are mapped read/write/execute. Returns nullptr if
+// the mapping fails.
+void *AllocateLargeRegion(size_t &Size, bool Executable);
+
+// Unmaps a region returned by AllocateLargeRegion, using the updated Size.
+void ReleaseLargeRegion(void *Ptr, size_t Size);
+
+#endif // RUNTIME_MEMORY_H
@@ -0,0 +1,72 @@
+#include "objects.h"
+#include "memory.h"
+#include <cstdio>
+#include <cstdlib>
+
+static const size_t ObjectAlign = 16;
+// Larger objects are rare enough that calloc is good enough for them.
+static const size_t MaxPooledSize = 512;
+static const size_t NumSizeClasses = MaxPooledSize / ObjectAlign;
+static const size_t SlabSize = 1024 * 1024;
+
+namespace {
+
+/// SizeClassPool - Bump allocation from the current slab of one size class.
+struct SizeClassPool
+{
+  char *Next = nullptr;
+  char *End = nullptr;
+};
+
+} // end anonymous namespace
+
+// Each thread fills its own slabs, so 'new' never takes a lock.
+static thread_local SizeClassPool Pools[NumSizeClasses];
+
+static void *allocateSlow(SizeClassPool &Pool, size_t Size)
+{
+  // With huge pages the region is rounded up to 2 MiB anyway; use all of it.
+  size_t Length = HugePagesEnabled() ? HugePageSize : SlabSize;
+  char *Slab = static_cast<char *>(AllocateLargeRegion(Length, false));
+  if (!Slab)
+  {
+    fputs("Kukanganisa: ndangariro yapera\n", stderr); // Out of memory
+    abort();
+  }
+  Pool.Next = Slab + Size;
+  Pool.End = Slab + Length - Length % Size;
+  return Slab;
+}
+
+extern "C" DLLEXPORT void *tino_object_alloc(uint64_t Size)
+{
+  if (Size > MaxPooledSize)
+  {
+    void *P = calloc(1, Size);
+    if (!P)
+    {
+      fputs("Kukanganisa: ndangariro yapera\n", stderr);
+      abort();
+    }
+    return P;
+  }
+
+  size_t Class = Size ? (Size - 1) / ObjectAlign : 0;
+  size_t Rounded = (Class + 1) * ObjectAlign;
+  SizeClassPool &Pool = Pools[Class];
+  if (Pool.Next == Pool.End)
+    return allocateSlow(Pool, Rounded);
+
+  // Slab memory comes straight from the OS and is never reused, so it is
+  // still zero.
+  void *P = Pool.Next;
+  Pool.Next += Rounded;
+  return P;
+}
+
+extern "C" DLLEXPORT void tino_null_object_error(const char *Class, const char *Member)
+{
+  fflush(stdout);
+  fprintf(stderr, "Kukanganisa: '%s' yapihwa %s isipo\n", Member, Class);
+  exit(1);
+}
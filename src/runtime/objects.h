@@ -0,0 +1,27 @@
+// Objects.h
+#ifndef RUNTIME_OBJECTS_H
+#define RUNTIME_OBJECTS_H
+
+#include "runtime.h"
+#include <cstdint>
+
+// Storage for 'kirasi' instances.
+//
+// 'new' compiles to a call to tino_object_alloc with the size of the class's
+// struct. Objects are carved out of per-thread slabs, one slab chain per
+// 16-byte size class, so instances of one class (and of classes of the same
+// size) sit next to each other in memory in allocation order. The language
+// has no way to free an object, so slabs are only ever bump-allocated.
+
+extern "C"
+{
+  // Returns Size bytes of zeroed, 16-byte aligned memory. Never returns null:
+  // running out of memory ends the script.
+  DLLEXPORT void *tino_object_alloc(uint64_t Size);
+
+  // Reports Member (a field or method) used on a variable of Class that
+  // holds no object, and ends the script.
+  DLLEXPORT void tino_null_object_error(const char *Class, const char *Member);
+}
+
+#endif // RUNTIME_OBJECTS_H
@@ -0,0 +1,788 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// LoopReduction::Kind, as codegen passes it in Ops.
+enum ReductionOp : int64_t
+{
+  ReduceAdd = 0,
+  ReduceMul = 1,
+  ReduceMin = 2,
+  ReduceMax = 3,
+};
+
+// A loop is cut into at least this many grains per worker, so the pieces
+// left over at the end are small enough for the workers to even out.
+static const int64_t GrainsPerWorker = 32;
+
+// Rounds an idle worker looks for work, yielding in between, before it goes
+// to sleep; waking a thread costs far more than a few yields.
+static const unsigned IdleRoundsBeforeSleep = 64;
+
+// Slots a worker's deque starts with; it doubles whenever it fills up.
+static const int64_t InitialDequeSize = 256;
+
+// Workers AddWorkerIfStuck may start beyond the number asked for.
+static const unsigned MaxExtraWorkers = 64;
+
+typedef void (*LoopBody)(void *Env, int64_t Begin, int64_t End, double *Partials);
+typedef double (*TaskFn)(void *Env);
+
+/// Task - Work on a deque: a range of a loop's iterations, or a future.
+struct Task
+{
+  virtual ~Task() = default;
+
+  /// run - Called on worker Id by whichever thread took the task off a
+  /// deque.
+  virtual void run(unsigned Id) = 0;
+};
+
+/// TinoFuture - A 'tanga' call. It is pushed as a task, but whoever claims
+/// it first runs it: the worker that takes it off a deque, or a thread in
+/// 'mirira' that gets to it before any worker does. The copy left on the
+/// deque then does nothing. The arguments (Env) follow the struct.
+///
+/// It is freed once both the deque and the script are done with it: Refs
+/// counts the copy on the deque, until some thread takes it off, and the
+/// script's, until 'mirira' returns.
+struct alignas(64) TinoFuture : Task
+{
+  enum : int
+  {
+    Waiting,
+    Running,
+    Done,
+  };
+
+  TaskFn Fn;
+  std::atomic<int> State{Waiting};
+  std::atomic<int> Refs{2};
+  double Result = 0;
+
+  void *env() { return this + 1; }
+
+  bool claim()
+  {
+    int Expected = Waiting;
+    return State.load(std::memory_order_relaxed) == Waiting &&
+           State.compare_exchange_strong(Expected, Running, std::memory_order_acquire);
+  }
+
+  void release()
+  {
+    if (Refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      this->~TinoFuture();
+      ::operator delete(this, std::align_val_t(alignof(TinoFuture)));
+    }
+  }
+
+  void execute();
+  void run(unsigned /*Id*/) override
+  {
+    if (claim())
+      execute();
+    release();
+  }
+};
+
+namespace {
+
+/// TaskDeque - Chase and Lev's work-stealing deque ("Dynamic Circular
+/// Work-Stealing Deque", SPAA 2005), with the C11 memory orders of Lê et
+/// al. ("Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP
+/// 2013). Only the owner pushes and pops, at Bottom; any thread may steal,
+/// at Top.
+class TaskDeque
+{
+  struct Buffer
+  {
+    int64_t Size; // A power of two.
+    std::unique_ptr<std::atomic<Task *>[]> Slots;
+
+    explicit Buffer(int64_t Size) : Size(Size), Slots(new std::atomic<Task *>[Size]) {}
+    Task *get(int64_t i) const { return Slots[i & (Size - 1)].load(std::memory_order_relaxed); }
+    void put(int64_t i, Task *T) { Slots[i & (Size - 1)].store(T, std::memory_order_relaxed); }
+  };
+
+  alignas(64) std::atomic<int64_t> Top{0};
+  alignas(64) std::atomic<int64_t> Bottom{0};
+  std::atomic<Buffer *> Current;
+  // Buffers the deque has grown out of. A thief may still be reading one,
+  // so they go only with the deque.
+  std::vector<std::unique_ptr<Buffer>> Retired;
+
+  Buffer *grow(Buffer *Old, int64_t T, int64_t B)
+  {
+    Buffer *New = new Buffer(Old->Size * 2);
+    for (int64_t i = T; i != B; ++i)
+      New->put(i, Old->get(i));
+    Retired.emplace_back(Old);
+    Current.store(New, std::memory_order_release);
+    return New;
+  }
+
+public:
+  TaskDeque() : Current(new Buffer(InitialDequeSize)) {}
+  ~TaskDeque() { delete Current.load(std::memory_order_relaxed); }
+
+  void push(Task *T)
+  {
+    int64_t B = Bottom.load(std::memory_order_relaxed);
+    int64_t Tp = Top.load(std::memory_order_acquire);
+    Buffer *Buf = Current.load(std::memory_order_relaxed);
+    if (B - Tp > Buf->Size - 1)
+      Buf = grow(Buf, Tp, B);
+    Buf->put(B, T);
+    Bottom.store(B + 1, std::memory_order_release);
+  }
+
+  Task *pop()
+  {
+    int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+    Buffer *Buf = Current.load(std::memory_order_relaxed);
+    Bottom.store(B, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t Tp = Top.load(std::memory_order_relaxed);
+    if (Tp > B)
+    {
+      Bottom.store(B + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task *T = Buf->get(B);
+    if (Tp == B)
+    {
+      // The last task: race the thieves for it.
+      if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        T = nullptr;
+      Bottom.store(B + 1, std::memory_order_relaxed);
+    }
+    return T;
+  }
+
+  /// popIf - Pop the task at the bottom if it is T.
+  bool popIf(Task *T)
+  {
+    int64_t B = Bottom.load(std::memory_order_relaxed);
+    if (B <= Top.load(std::memory_order_relaxed) ||
+        Current.load(std::memory_order_relaxed)->get(B - 1) != T)
+      return false;
+    // Thieves take from the top, so pop gives T, or nothing if one took it.
+    return pop() == T;
+  }
+
+  /// steal - The task at the top, or null if there is none or another
+  /// thread took it first.
+  Task *steal()
+  {
+    int64_t Tp = Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t B = Bottom.load(std::memory_order_acquire);
+    if (Tp >= B)
+      return nullptr;
+    Task *T = Current.load(std::memory_order_acquire)->get(Tp);
+    if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+      return nullptr;
+    return T;
+  }
+
+  /// empty - As the owner sees it.
+  bool empty() const
+  {
+    return Bottom.load(std::memory_order_relaxed) <= Top.load(std::memory_order_relaxed);
+  }
+};
+
+struct alignas(64) Worker
+{
+  TaskDeque Tasks;
+  bool InUse = false; // For an extra worker's slot; under Pool::GrowLock.
+};
+
+/// CacheLine - Reduction copies are kept a whole number of lines apart, so
+/// two workers never write to the same one.
+struct alignas(64) CacheLine
+{
+  double X[8];
+};
+
+/// Loop - One call to tino_parallel_for running on the pool.
+struct Loop
+{
+  LoopBody Body;
+  void *Env;
+  int64_t Grain;
+  int64_t NumReductions;
+  const int64_t *Ops;
+  int64_t PartialStride;          // Doubles from one worker's copies to the next.
+  std::vector<CacheLine> Partials;
+  std::atomic<int64_t> Remaining; // Iterations not run yet.
+
+  // Output of ranges that finished before an earlier range did, by Begin.
+  std::mutex OutputLock;
+  int64_t NextOutput = 0;
+  std::map<int64_t, std::pair<int64_t, std::string>> PendingOutput;
+
+  double *partials(unsigned Id)
+  {
+    return reinterpret_cast<double *>(Partials.data()) + Id * PartialStride;
+  }
+};
+
+/// RangeTask - Iterations [Begin, End) of a loop.
+struct RangeTask : Task
+{
+  Loop &L;
+  int64_t Begin, End;
+
+  RangeTask(Loop &L, int64_t Begin, int64_t End) : L(L), Begin(Begin), End(End) {}
+  void run(unsigned Id) override;
+};
+
+/// Pool - A deque per thread. Worker 0 is the thread that started the pool
+/// (the script's); the others run tasks until the process ends, sleeping
+/// while there are none. NumWorkers start with the pool; up to
+/// MaxExtraWorkers more may join for threads blocked on channels, and leave
+/// again once they run out of work. The deques are all made up front, and
+/// NumThreads counts those ever used, which is where thieves look.
+///
+/// A worker going to sleep counts itself in Sleepers and then looks for
+/// work once more; a thread pushing a task checks Sleepers after the push.
+/// One of the two sees the other, and Epoch (moved on under Lock) tells a
+/// sleeper that something was pushed after it last looked.
+struct Pool
+{
+  unsigned NumWorkers;
+  unsigned MaxWorkers;                 // NumWorkers + MaxExtraWorkers.
+  std::atomic<unsigned> NumThreads{0}; // Deques used so far.
+  std::atomic<unsigned> Extra{0};      // Extra workers running now.
+  std::atomic<unsigned> Blocked{0};    // Workers in a blocking wait.
+  std::unique_ptr<Worker[]> Workers;
+  std::mutex GrowLock;
+  std::mutex Lock;
+  std::condition_variable Wake;
+  std::atomic<uint64_t> Epoch{0};
+  std::atomic<unsigned> Sleepers{0};
+  std::atomic<int64_t> Unfinished{0}; // Futures not done yet.
+};
+
+} // end anonymous namespace
+
+static unsigned RequestedThreads = 0;
+
+// Never destroyed, and its threads never joined: exit() can end the script
+// at any point, with the workers asleep or not.
+static Pool *ThePool = nullptr;
+
+// One loop runs on the pool at a time; a loop started while it is busy runs
+// on its caller alone.
+static std::atomic<bool> LoopBusy{false};
+
+// This thread's worker number, or -1 for a thread outside the pool.
+static thread_local int WorkerId = -1;
+
+// Set while this thread runs iterations of a loop; tino_printf appends to
+// RangeOutput.
+static thread_local bool InLoop = false;
+static thread_local std::string *RangeOutput = nullptr;
+
+// Whether this thread counted itself in Pool::Blocked.
+static thread_local bool CountedBlocked = false;
+
+void SetParallelThreads(unsigned Threads) { RequestedThreads = Threads; }
+
+unsigned ParallelThreads()
+{
+  return RequestedThreads ? RequestedThreads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+static double identity(int64_t Op)
+{
+  switch (Op)
+  {
+  case ReduceAdd:
+    return 0;
+  case ReduceMul:
+    return 1;
+  case ReduceMin:
+    return INFINITY;
+  default:
+    return -INFINITY;
+  }
+}
+
+static double combine(int64_t Op, double A, double B)
+{
+  switch (Op)
+  {
+  case ReduceAdd:
+    return A + B;
+  case ReduceMul:
+    return A * B;
+  case ReduceMin:
+    return B < A ? B : A;
+  default:
+    return B > A ? B : A;
+  }
+}
+
+/// wake - Something was pushed; wake a sleeping worker to take it (or all
+/// of them, for a whole loop).
+static void wake(bool All)
+{
+  Pool &P = *ThePool;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!P.Sleepers.load(std::memory_order_relaxed))
+    return;
+  {
+    std::lock_guard<std::mutex> Lock(P.Lock);
+    P.Epoch.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (All)
+    P.Wake.notify_all();
+  else
+    P.Wake.notify_one();
+}
+
+static void push(unsigned Id, Task *T, bool WakeAll = false)
+{
+  ThePool->Workers[Id].Tasks.push(T);
+  wake(WakeAll);
+}
+
+/// findTask - A task from this worker's own deque, or else one stolen from
+/// the others, trying them all from a random one on.
+static Task *findTask(unsigned Id, uint64_t &Seed)
+{
+  Pool &P = *ThePool;
+  if (Task *T = P.Workers[Id].Tasks.pop())
+    return T;
+  unsigned N = P.NumThreads.load(std::memory_order_acquire);
+  Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  unsigned First = unsigned(Seed >> 33) % N;
+  for (unsigned i = 0; i != N; ++i)
+  {
+    unsigned Victim = (First + i) % N;
+    if (Victim == Id)
+      continue;
+    if (Task *T = P.Workers[Victim].Tasks.steal())
+      return T;
+  }
+  return nullptr;
+}
+
+/// runTask - Run T outside of whatever loop range this thread is in the
+/// middle of (it may be waiting on a future there).
+static void runTask(Task *T, unsigned Id)
+{
+  bool SavedInLoop = InLoop;
+  std::string *SavedOutput = RangeOutput;
+  InLoop = false;
+  RangeOutput = nullptr;
+  T->run(Id);
+  InLoop = SavedInLoop;
+  RangeOutput = SavedOutput;
+}
+
+/// helpUntil - Run tasks on worker Id until Done() holds.
+template <typename Predicate> static void helpUntil(unsigned Id, Predicate Done)
+{
+  uint64_t Seed = Id + 1;
+  while (!Done())
+  {
+    if (Task *T = findTask(Id, Seed))
+      runTask(T, Id);
+    else
+      std::this_thread::yield();
+  }
+}
+
+/// writeInOrder - Write the output of iterations [Begin, End), and of any
+/// later ranges that were waiting for it, once everything before Begin has
+/// been written.
+static void writeInOrder(Loop &L, int64_t Begin, int64_t End, std::string &Text)
+{
+  std::lock_guard<std::mutex> Lock(L.OutputLock);
+  if (Begin != L.NextOutput)
+  {
+    L.PendingOutput.emplace(Begin, std::make_pair(End, std::move(Text)));
+    return;
+  }
+
+  fwrite(Text.data(), 1, Text.size(), stdout);
+  L.NextOutput = End;
+  for (auto It = L.PendingOutput.begin();
+       It != L.PendingOutput.end() && It->first == L.NextOutput;
+       It = L.PendingOutput.erase(It))
+  {
+    fwrite(It->second.second.data(), 1, It->second.second.size(), stdout);
+    L.NextOutput = It->second.first;
+  }
+}
+
+/// runGrain - Run iterations [Begin, End). The grain has reduction copies
+/// of its own: its body may wait on a future, and this thread run another
+/// grain of the loop meanwhile.
+static void runGrain(Loop &L, unsigned Id, int64_t Begin, int64_t End)
+{
+  double Small[8];
+  std::vector<double> Large;
+  double *Partials = Small;
+  if (L.NumReductions > 8)
+  {
+    Large.resize(L.NumReductions);
+    Partials = Large.data();
+  }
+  for (int64_t r = 0; r < L.NumReductions; ++r)
+    Partials[r] = identity(L.Ops[r]);
+
+  std::string Output;
+  bool SavedInLoop = InLoop;
+  std::string *SavedOutput = RangeOutput;
+  RangeOutput = &Output;
+  InLoop = true;
+  L.Body(L.Env, Begin, End, Partials);
+  InLoop = SavedInLoop;
+  RangeOutput = SavedOutput;
+
+  double *Mine = L.partials(Id);
+  for (int64_t r = 0; r < L.NumReductions; ++r)
+    Mine[r] = combine(L.Ops[r], Mine[r], Partials[r]);
+  writeInOrder(L, Begin, End, Output);
+  // The last iteration done lets tino_parallel_for return, and L go.
+  L.Remaining.fetch_sub(End - Begin, std::memory_order_acq_rel);
+}
+
+/// runRange - Run [Begin, End) a grain at a time. Whenever this worker's
+/// deque runs dry, the upper half of what is left goes onto it, where an
+/// idle worker can steal it; with nobody idle the halves come straight
+/// back.
+static void runRange(Loop &L, unsigned Id, int64_t Begin, int64_t End)
+{
+  TaskDeque &Own = ThePool->Workers[Id].Tasks;
+  while (Begin < End)
+  {
+    if (End - Begin > L.Grain && Own.empty())
+    {
+      int64_t Mid = Begin + (End - Begin) / 2;
+      push(Id, new RangeTask(L, Mid, End));
+      End = Mid;
+    }
+
+    int64_t GrainEnd = std::min(End, Begin + L.Grain);
+    runGrain(L, Id, Begin, GrainEnd);
+    Begin = GrainEnd;
+  }
+}
+
+void RangeTask::run(unsigned Id)
+{
+  runRange(L, Id, Begin, End);
+  delete this;
+}
+
+void TinoFuture::execute()
+{
+  Result = Fn(env());
+  State.store(Done, std::memory_order_release);
+  ThePool->Unfinished.fetch_sub(1, std::memory_order_release);
+}
+
+static void workerMain(unsigned Id)
+{
+  Pool &P = *ThePool;
+  WorkerId = Id;
+  uint64_t Seed = Id + 1;
+  unsigned Idle = 0;
+  for (;;)
+  {
+    if (Task *T = findTask(Id, Seed))
+    {
+      runTask(T, Id);
+      Idle = 0;
+      continue;
+    }
+    if (++Idle < IdleRoundsBeforeSleep)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // An extra worker leaves instead, with its deque empty; AddWorkerIfStuck
+    // starts another if a blocked thread needs one again.
+    if (Id >= P.NumWorkers)
+    {
+      std::lock_guard<std::mutex> Lock(P.GrowLock);
+      P.Workers[Id].InUse = false;
+      P.Extra.fetch_sub(1, std::memory_order_release);
+      return;
+    }
+
+    uint64_t Seen = P.Epoch.load(std::memory_order_relaxed);
+    P.Sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Task *T = findTask(Id, Seed);
+    if (!T)
+    {
+      std::unique_lock<std::mutex> Lock(P.Lock);
+      P.Wake.wait(Lock, [&] { return P.Epoch.load(std::memory_order_relaxed) != Seen; });
+    }
+    P.Sleepers.fetch_sub(1, std::memory_order_relaxed);
+    if (T)
+      runTask(T, Id);
+    Idle = 0;
+  }
+}
+
+/// startPool - Called by the first thread to use the pool, which becomes
+/// worker 0.
+static void startPool()
+{
+  ThePool = new Pool;
+  ThePool->NumWorkers = ParallelThreads();
+  ThePool->MaxWorkers = ThePool->NumWorkers + MaxExtraWorkers;
+  ThePool->NumThreads.store(ThePool->NumWorkers, std::memory_order_relaxed);
+  ThePool->Workers.reset(new Worker[ThePool->MaxWorkers]);
+  WorkerId = 0;
+  for (unsigned Id = 1; Id < ThePool->NumWorkers; ++Id)
+    std::thread(workerMain, Id).detach();
+}
+
+extern "C" DLLEXPORT void tino_parallel_for(LoopBody Body, void *Env, double Start,
+                                            double End, double Step, int64_t MinIterations,
+                                            int64_t NumReductions, const int64_t *Ops,
+                                            double *Results)
+{
+  if (!(Step > 0))
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: nhanho ye 'pakati pamwe' inofanira kuva yakakura kupfuura 0 (%g)\n",
+            Step);
+    exit(1);
+  }
+
+  // As in the serial loop, the first iteration runs whatever End is.
+  double Trip = std::ceil((End - Start) / Step);
+  if (Trip >= 4611686018427387904.0)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: 'pakati pamwe' ine ma iterations akawandisa (%g)\n", Trip);
+    exit(1);
+  }
+  int64_t Count = Trip > 1 ? int64_t(Trip) : 1;
+
+  for (int64_t r = 0; r < NumReductions; ++r)
+    Results[r] = identity(Ops[r]);
+
+  // Short loops aren't worth waking the pool for. Inside another loop's
+  // iterations (or another thread's loop) it is already busy.
+  if (Count < MinIterations || InLoop || LoopBusy.exchange(true, std::memory_order_acquire))
+  {
+    Body(Env, 0, Count, Results);
+    return;
+  }
+  if (!ThePool)
+    startPool();
+  Pool &P = *ThePool;
+  if (P.NumWorkers == 1 || Count == 1 || WorkerId < 0)
+  {
+    LoopBusy.store(false, std::memory_order_release);
+    Body(Env, 0, Count, Results);
+    return;
+  }
+  unsigned Id = WorkerId;
+
+  Loop L;
+  L.Body = Body;
+  L.Env = Env;
+  L.Grain = std::max<int64_t>(1, Count / (GrainsPerWorker * P.NumWorkers));
+  L.NumReductions = NumReductions;
+  L.Ops = Ops;
+  L.PartialStride = (NumReductions + 7) / 8 * 8;
+  // A worker started while the loop runs may take part in it too.
+  L.Partials.resize(L.PartialStride / 8 * P.MaxWorkers);
+  for (unsigned W = 0; W != P.MaxWorkers; ++W)
+    for (int64_t r = 0; r < NumReductions; ++r)
+      L.partials(W)[r] = identity(Ops[r]);
+  L.Remaining.store(Count, std::memory_order_relaxed);
+
+  // The whole range starts on this thread's deque; the workers steal their
+  // way in. Once every iteration has run, no task refers to L any more.
+  push(Id, new RangeTask(L, 0, Count), /*WakeAll=*/true);
+  helpUntil(Id, [&] { return L.Remaining.load(std::memory_order_acquire) == 0; });
+  LoopBusy.store(false, std::memory_order_release);
+
+  for (unsigned W = 0, N = P.NumThreads.load(std::memory_order_acquire); W != N; ++W)
+    for (int64_t r = 0; r < NumReductions; ++r)
+      Results[r] = combine(Ops[r], Results[r], L.partials(W)[r]);
+}
+
+extern "C" DLLEXPORT TinoFuture *tino_spawn(TaskFn Fn, const void *Env, int64_t EnvSize)
+{
+  if (!ThePool)
+    startPool();
+  void *Memory = ::operator new(sizeof(TinoFuture) + EnvSize, std::align_val_t(alignof(TinoFuture)));
+  TinoFuture *F = new (Memory) TinoFuture;
+  F->Fn = Fn;
+  memcpy(F->env(), Env, EnvSize);
+  ThePool->Unfinished.fetch_add(1, std::memory_order_relaxed);
+
+  // A thread outside the pool has no deque to push to; it runs the task as
+  // if it took it off one.
+  if (WorkerId < 0)
+  {
+    F->run(0);
+    return F;
+  }
+  push(WorkerId, F);
+  return F;
+}
+
+extern "C" DLLEXPORT double mirira(TinoFuture *F)
+{
+  if (!F)
+  {
+    fflush(stdout);
+    fprintf(stderr, "Kukanganisa: 'mirira' yapihwa future isipo\n");
+    exit(1);
+  }
+
+  // Not taken yet: it's cheapest to run it right here, as a plain call.
+  // Spawned just before, it is still at the bottom of this thread's deque,
+  // and comes off it too, so it needn't wait there to be freed.
+  if (WorkerId >= 0 && ThePool->Workers[WorkerId].Tasks.popIf(F))
+    F->run(WorkerId);
+  else if (F->claim())
+    F->execute();
+  else if (F->State.load(std::memory_order_acquire) != TinoFuture::Done)
+  {
+    auto Done = [&] { return F->State.load(std::memory_order_acquire) == TinoFuture::Done; };
+    if (WorkerId >= 0)
+      helpUntil(WorkerId, Done);
+    else
+      while (!Done())
+        std::this_thread::yield();
+  }
+  double Result = F->Result;
+  F->release();
+  return Result;
+}
+
+void WaitForTasks()
+{
+  if (!ThePool)
+    return;
+  auto Done = [] { return ThePool->Unfinished.load(std::memory_order_acquire) == 0; };
+  if (WorkerId >= 0)
+    helpUntil(WorkerId, Done);
+  else
+    while (!Done())
+      std::this_thread::yield();
+}
+
+void BeginBlockingWait()
+{
+  if (!ThePool || WorkerId < 0)
+    return;
+  ThePool->Blocked.fetch_add(1, std::memory_order_relaxed);
+  CountedBlocked = true;
+  AddWorkerIfStuck();
+}
+
+void EndBlockingWait()
+{
+  if (!CountedBlocked)
+    return;
+  ThePool->Blocked.fetch_sub(1, std::memory_order_relaxed);
+  CountedBlocked = false;
+}
+
+void AddWorkerIfStuck()
+{
+  if (!ThePool)
+    return;
+  Pool &P = *ThePool;
+
+  // A sleeping worker will be woken for anything queued, and while there
+  // are as many extra workers as blocked ones, NumWorkers are free.
+  if (P.Sleepers.load(std::memory_order_relaxed))
+    return;
+  unsigned Blocked = P.Blocked.load(std::memory_order_relaxed);
+  if (P.Extra.load(std::memory_order_acquire) >= Blocked)
+    return;
+  unsigned N = P.NumThreads.load(std::memory_order_acquire);
+  bool Queued = false;
+  for (unsigned Id = 0; Id != N && !Queued; ++Id)
+    Queued = !P.Workers[Id].Tasks.empty();
+  if (!Queued)
+    return;
+
+  std::lock_guard<std::mutex> Lock(P.GrowLock);
+  if (P.Extra.load(std::memory_order_relaxed) == MaxExtraWorkers)
+  {
+    // Every thread of the pool waits on a channel, and the tasks that could
+    // end the waits are queued with nobody left to run them.
+    if (Blocked >= P.NumWorkers + MaxExtraWorkers)
+    {
+      fflush(stdout);
+      fprintf(stderr,
+              "Kukanganisa: ma thread ose %u akamirira channel, hapana "
+              "asara kuti amhanye ma tasks akamirirwa\n",
+              P.NumWorkers + MaxExtraWorkers);
+      exit(1);
+    }
+    return;
+  }
+  unsigned Id = P.NumWorkers;
+  while (P.Workers[Id].InUse)
+    ++Id;
+  P.Workers[Id].InUse = true;
+  P.Extra.fetch_add(1, std::memory_order_relaxed);
+  if (Id >= P.NumThreads.load(std::memory_order_relaxed))
+    P.NumThreads.store(Id + 1, std::memory_order_release);
+  std::thread(workerMain, Id).detach();
+}
+
+extern "C" DLLEXPORT int tino_printf(const char *Format, ...)
+{
+  va_list Args;
+  va_start(Args, Format);
+  int N;
+  if (!RangeOutput)
+    N = vprintf(Format, Args);
+  else
+  {
+    va_list Again;
+    va_copy(Again, Args);
+    char Small[256];
+    N = vsnprintf(Small, sizeof(Small), Format, Args);
+    if (N >= 0 && size_t(N) < sizeof(Small))
+      RangeOutput->append(Small, N);
+    else if (N >= 0)
+    {
+      size_t Old = RangeOutput->size();
+      RangeOutput->resize(Old + N + 1);
+      vsnprintf(&(*RangeOutput)[Old], N + 1, Format, Again);
+      RangeOutput->resize(Old + N);
+    }
+    va_end(Again);
+  }
+  va_end(Args);
+  return N;
+}
@@ -0,0 +1,96 @@
+// Parallel.h
+#ifndef RUNTIME_PARALLEL_H
+#define RUNTIME_PARALLEL_H
+
+#include "runtime.h"
+#include <cstdint>
+
+// The thread pool behind 'pakati pamwe' loops and 'tanga' tasks.
+//
+// Every worker thread owns a Chase-Lev deque of tasks: it pushes and pops at
+// the bottom without locking, and idle workers steal from the top, where the
+// oldest (and for divide and conquer, the largest) tasks are. Workers with
+// nothing to run or steal sleep until something is pushed.
+//
+// Codegen outlines the body of a parallel loop into a function that runs
+// iterations [Begin, End) of the loop; tino_parallel_for pushes the whole
+// range as one task. A worker running a range larger than the grain splits
+// off the upper half onto its deque whenever the deque is empty, so the
+// range is only cut up as far as there are idle workers to take the pieces.
+//
+// Each range starts the loop's reduction variables from the operator's
+// identity; its results are combined into its worker's copy, and when the
+// loop is done the copies are combined into Results.
+//
+// 'nyora' inside the loop goes through tino_printf, which collects a range's
+// output and writes it only once everything before the range has been
+// written, so a parallel loop prints what the serial loop would, in the same
+// order.
+//
+// 'tanga f(x)' copies the arguments into a future and pushes it as a task;
+// 'mirira' runs the future itself if no worker has taken it yet, and
+// otherwise runs other tasks (its own first, then stolen ones) until it is
+// done, so a thread waiting on a future is never idle while there is work.
+// That is why a future can't be passed to 'tanga': a task waiting on it
+// might be run by the very thread whose task it waits for, underneath it.
+//
+// Workers past the number asked for are only started for threads blocked
+// on a channel (see BeginBlockingWait), so there is always a worker free to
+// run the task they wait for.
+
+struct TinoFuture;
+
+extern "C"
+{
+  // Runs Body over the iterations of 'pakati pamwe (i = Start, End, Step)':
+  // at least one, and as many more as Start + k * Step < End allows. Step
+  // must be positive. A loop of fewer than MinIterations runs on the caller
+  // alone. Ops[r] is a LoopReduction::Kind, and Results[r] receives the r'th
+  // reduction combined over every iteration.
+  DLLEXPORT void tino_parallel_for(void (*Body)(void *Env, int64_t Begin, int64_t End,
+                                                double *Partials),
+                                   void *Env, double Start, double End, double Step,
+                                   int64_t MinIterations, int64_t NumReductions,
+                                   const int64_t *Ops, double *Results);
+
+  // Runs Fn(Env) on the pool, with a copy of the EnvSize bytes at Env, and
+  // returns its future. The future is freed once it has been waited for;
+  // one nothing waits for is kept until the script ends.
+  DLLEXPORT TinoFuture *tino_spawn(double (*Fn)(void *Env), const void *Env,
+                                   int64_t EnvSize);
+
+  // Waits for Future's task to finish and returns what it returned. A
+  // future can be waited for only once.
+  DLLEXPORT double mirira(TinoFuture *Future);
+
+  // printf, but inside a parallel loop the text is held back until the
+  // iterations before it have printed theirs.
+  DLLEXPORT int tino_printf(const char *Format, ...);
+}
+
+// The number of threads loops and tasks use, the caller included; 0 (the
+// default) for one per hardware thread. Must be set before the pool starts.
+void SetParallelThreads(unsigned Threads);
+
+// The number of threads the pool runs loops on, the caller included: what
+// SetParallelThreads asked for, or one per hardware thread.
+unsigned ParallelThreads();
+
+// Returns once every task started with tino_spawn has finished, running
+// tasks meanwhile. Code must stay in the JIT until its tasks are done.
+void WaitForTasks();
+
+// For waits that only another task can end, such as on a full channel,
+// which must not run tasks meanwhile (the task run might be the one that
+// waits for this one). A thread calls BeginBlockingWait before such a wait,
+// AddWorkerIfStuck every millisecond or so while it lasts, and
+// EndBlockingWait after. While tasks are queued and fewer workers than
+// SetParallelThreads asked for are free to run them, AddWorkerIfStuck
+// starts another one, which leaves the pool once it runs out of work. If
+// every thread is blocked that way with tasks queued and no more workers
+// may be started, it ends the script rather than let it hang.
+void BeginBlockingWait();
+void AddWorkerIfStuck();
+void EndBlockingWait();
+
+#endif // RUNTIME_PARALLEL_H
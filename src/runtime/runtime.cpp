@@ -0,0 +1,122 @@
+#include "runtime.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// Nothing in here may need static initialization (iostreams and the like):
+// the bitcode copy is linked into every script module.
+
+#ifdef _MSC_VER
+#define COLD __declspec(noinline)
+#else
+#define COLD __attribute__((cold, noinline))
+#endif
+
+/// ReportRuntimeError - Print a builtin's diagnostic. Kept out of line and
+/// marked cold so the error text stays away from the builtins' hot paths.
+static COLD void ReportRuntimeError(const char *Msg)
+{
+  fputs(Msg, stderr);
+}
+
+extern "C" DLLEXPORT double wedzera(double a, double b) // Addition
+{  
+    double result = a+b;
+    return result;
+}
+
+extern "C" DLLEXPORT double bvisaNamba(double a, double b) // Subtraction
+{
+    double result = a-b;
+    return result;
+}
+
+extern "C" DLLEXPORT double wedzeranisa(double a, double b) // Multiplication
+{
+  double result = a*b;
+  return result;
+}
+
+extern "C" DLLEXPORT double govana(double a, double b) // Division
+{
+    if (b == 0)
+    {
+        ReportRuntimeError("Kukanganisa: Haugone kupatsanura ne zero!\n"); // Error: Cannot divide by zero
+        
+    }
+    double result = a/b;
+    return result;
+    
+}
+extern "C" DLLEXPORT double nambaInosara(double a, double b) // Modulus (Remainder)
+{
+  double result = int(a)%int(b);
+  return result;
+  
+}
+
+extern "C" DLLEXPORT double simba(double base, double exponent) // Power
+{
+  double result = pow(base,exponent);
+  return result;
+}
+
+extern "C" DLLEXPORT double tsvagaMudzi(double value) // Square Root
+{
+    if (value < 0)
+    {
+        ReportRuntimeError("Kukanganisa: Haugone kutora mudzi wesikweya we nhamba isina kugadzikana!\n");
+     
+    }
+    double result = sqrt(value);
+    return result;
+   
+}
+
+extern "C" DLLEXPORT double logarithm(double value) // Natural Logarithm (ln)
+{
+    if (value <= 0)
+    {
+        ReportRuntimeError("Kukanganisa: Logarithm inoshanda pane nhamba huru kupfuura zero chete!\n");
+      
+    }
+    double result = log(value);
+    return result;
+    
+}
+
+extern "C" DLLEXPORT double expo(double value) // Exponential (e^x)
+{
+  double result = exp(value);
+  return result;
+   
+}
+
+// Trigonometric Functions
+extern "C" DLLEXPORT double  saini(double angle) // Sine
+{
+  double result = sin(angle);
+  return result;
+  
+}
+
+extern "C" DLLEXPORT double cosi(double angle) // Cosine
+{
+  double result = cos(angle);
+  return result;
+  
+}
+
+extern "C" DLLEXPORT double tanhi(double angle) // Tangent
+
+{
+  double result = tan(angle);
+  return result;
+
+}
+
+extern "C" DLLEXPORT double nguva() // Time
+{
+  auto Now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(Now).count();
+}
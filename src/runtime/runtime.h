@@ -0,0 +1,36 @@
+// Runtime.h
+#ifndef RUNTIME_RUNTIME_H
+#define RUNTIME_RUNTIME_H
+
+// The numeric builtins scripts call by name. runtime.cpp is compiled twice:
+// into tino itself, so the JIT can always resolve calls to these symbols, and
+// to LLVM bitcode that is embedded in tino and linked into script modules
+// (see codegen/runtimelink.cpp) so the small ones can be inlined.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C"
+{
+  DLLEXPORT double wedzera(double a, double b);
+  DLLEXPORT double bvisaNamba(double a, double b);
+  DLLEXPORT double wedzeranisa(double a, double b);
+  DLLEXPORT double govana(double a, double b);
+  DLLEXPORT double nambaInosara(double a, double b);
+  DLLEXPORT double simba(double base, double exponent);
+  DLLEXPORT double tsvagaMudzi(double value);
+  DLLEXPORT double logarithm(double value);
+  DLLEXPORT double expo(double value);
+  DLLEXPORT double saini(double angle);
+  DLLEXPORT double cosi(double angle);
+  DLLEXPORT double tanhi(double angle);
+
+  // Seconds since some fixed point in the past, from a clock that never
+  // goes backwards; for timing parts of a script.
+  DLLEXPORT double nguva();
+}
+
+#endif // RUNTIME_RUNTIME_H